@@ -19,12 +19,22 @@
 
 #include "common/mm_io_x.h"
 
+/** \brief Reads individual bits and bit fields from a memory buffer
+
+   Up to 64 bits are kept in a cache whose most significant bit is
+   the next bit to read. The cache is refilled with eight bytes at a
+   time as long as enough data is left which is also the only point
+   where the end of the data is checked. Exp-Golomb codes are decoded
+   by counting the leading zeros of the cache instead of reading them
+   one bit at a time.
+*/
 class bit_reader_c {
 private:
   const unsigned char *m_end_of_data;
-  const unsigned char *m_byte_position;
+  const unsigned char *m_next_byte;
   const unsigned char *m_start_of_data;
-  std::size_t m_bits_valid;
+  uint64_t m_cache;
+  std::size_t m_cache_bits;
   bool m_out_of_data;
 
 public:
@@ -34,10 +44,11 @@ public:
 
   void init(const unsigned char *data, std::size_t len) {
     m_end_of_data   = data + len;
-    m_byte_position = data;
+    m_next_byte     = data;
     m_start_of_data = data;
-    m_bits_valid    = len ? 8 : 0;
-    m_out_of_data   = m_byte_position >= m_end_of_data;
+    m_cache         = 0;
+    m_cache_bits    = 0;
+    m_out_of_data   = m_next_byte >= m_end_of_data;
   }
 
   bool eof() {
@@ -45,39 +56,34 @@ public:
   }
 
   uint64_t get_bits(std::size_t n) {
-    uint64_t r = 0;
-
-    while (n > 0) {
-      if (m_byte_position >= m_end_of_data) {
-        m_out_of_data = true;
-        throw mtx::mm_io::end_of_file_x();
-      }
+    if (n <= m_cache_bits)
+      return consume(n);
 
-      std::size_t b = 8; // number of bits to extract from the current byte
-      if (b > n)
-        b = n;
-      if (b > m_bits_valid)
-        b = m_bits_valid;
+    refill();
 
-      std::size_t rshift = m_bits_valid - b;
+    if (n <= m_cache_bits)
+      return consume(n);
 
-      r <<= b;
-      r  |= ((*m_byte_position) >> rshift) & (0xff >> (8 - b));
+    if (static_cast<int>(n) > get_remaining_bits())
+      throw_end_of_file();
 
-      m_bits_valid -= b;
-      if (0 == m_bits_valid) {
-        m_bits_valid     = 8;
-        m_byte_position += 1;
-      }
-
-      n -= b;
-    }
+    // More than 56 bits requested and the cache couldn't be filled
+    // completely due to the data's alignment.
+    auto high_bits = n - 32;
+    auto value     = consume(high_bits) << 32;
+    refill();
 
-    return r;
+    return value | consume(32);
   }
 
   inline int get_bit() {
-    return get_bits(1);
+    if (!m_cache_bits) {
+      refill();
+      if (!m_cache_bits)
+        throw_end_of_file();
+    }
+
+    return consume(1);
   }
 
   inline int get_unary(bool stop,
@@ -97,14 +103,42 @@ public:
   }
 
   inline uint64_t get_unsigned_golomb() {
-    int n = 0;
+    if (m_cache_bits < 32)
+      refill();
+
+    // Common case: the whole code is in the cache. Read as a number
+    // the 2n+1 bits of a code with n leading zeros are 2^n + suffix.
+    auto zeros = count_leading_zeros(m_cache);
+    if ((zeros * 2) < m_cache_bits)
+      return consume(zeros * 2 + 1) - 1;
+
+    std::size_t n = 0;
+
+    while (true) {
+      if (!m_cache_bits) {
+        refill();
+        if (!m_cache_bits)
+          throw_end_of_file();
+      }
 
-    while (get_bit() == 0)
-      ++n;
+      // Bits following the valid ones may be set, therefore the number
+      // of leading zeros found must be checked against m_cache_bits.
+      zeros = count_leading_zeros(m_cache);
+      if (zeros < m_cache_bits) {
+        n += zeros;
+        consume(zeros + 1);
+        break;
+      }
+
+      n            += m_cache_bits;
+      m_cache       = 0;
+      m_cache_bits  = 0;
+    }
 
-    auto bits = get_bits(n);
+    if (n > 63)
+      throw_end_of_file();
 
-    return (1u << n) - 1 + bits;
+    return (uint64_t{1} << n) - 1 + get_bits(n);
   }
 
   inline int64_t get_signed_golomb() {
@@ -113,39 +147,12 @@ public:
   }
 
   uint64_t peek_bits(std::size_t n) {
-    uint64_t r                             = 0;
-    const unsigned char *tmp_byte_position = m_byte_position;
-    std::size_t tmp_bits_valid                  = m_bits_valid;
-
-    while (0 < n) {
-      if (tmp_byte_position >= m_end_of_data)
-        throw mtx::mm_io::end_of_file_x();
-
-      std::size_t b = 8; // number of bits to extract from the current byte
-      if (b > n)
-        b = n;
-      if (b > tmp_bits_valid)
-        b = tmp_bits_valid;
-
-      std::size_t rshift = tmp_bits_valid - b;
-
-      r <<= b;
-      r  |= ((*tmp_byte_position) >> rshift) & (0xff >> (8 - b));
-
-      tmp_bits_valid -= b;
-      if (0 == tmp_bits_valid) {
-        tmp_bits_valid     = 8;
-        tmp_byte_position += 1;
-      }
-
-      n -= b;
-    }
-
-    return r;
+    auto copy = *this;
+    return copy.get_bits(n);
   }
 
   void get_bytes(unsigned char *buf, std::size_t n) {
-    if (8 == m_bits_valid) {
+    if (!(m_cache_bits % 8)) {
       get_bytes_byte_aligned(buf, n);
       return;
     }
@@ -155,36 +162,47 @@ public:
   }
 
   void byte_align() {
-    if (8 != m_bits_valid)
-      skip_bits(m_bits_valid);
+    // The cache is always filled with whole bytes.
+    consume(m_cache_bits % 8);
   }
 
   void set_bit_position(std::size_t pos) {
     if (pos > (static_cast<std::size_t>(m_end_of_data - m_start_of_data) * 8)) {
-      m_byte_position = m_end_of_data;
-      m_out_of_data   = true;
+      m_next_byte    = m_end_of_data;
+      m_cache        = 0;
+      m_cache_bits   = 0;
+      m_out_of_data  = true;
 
       throw mtx::mm_io::end_of_file_x();
     }
 
-    m_byte_position = m_start_of_data + (pos / 8);
-    m_bits_valid    = 8 - (pos % 8);
+    m_next_byte  = m_start_of_data + (pos / 8);
+    m_cache      = 0;
+    m_cache_bits = 0;
+
+    if (pos % 8) {
+      refill();
+      consume(pos % 8);
+    }
   }
 
   int get_bit_position() const {
-    return (m_byte_position - m_start_of_data) * 8 + 8 - m_bits_valid;
+    return (m_next_byte - m_start_of_data) * 8 - m_cache_bits;
   }
 
   int get_remaining_bits() const {
-    return (m_end_of_data - m_byte_position) * 8 - 8 + m_bits_valid;
+    return (m_end_of_data - m_next_byte) * 8 + m_cache_bits;
   }
 
   void skip_bits(std::size_t num) {
-    set_bit_position(get_bit_position() + num);
+    if (num <= m_cache_bits)
+      consume(num);
+    else
+      set_bit_position(get_bit_position() + num);
   }
 
   void skip_bit() {
-    set_bit_position(get_bit_position() + 1);
+    skip_bits(1);
   }
 
   uint64_t skip_get_bits(std::size_t to_skip,
@@ -194,17 +212,87 @@ public:
   }
 
 protected:
-  void get_bytes_byte_aligned(unsigned char *buf, std::size_t n) {
-    auto bytes_to_copy = std::min<std::size_t>(n, m_end_of_data - m_byte_position);
-    std::memcpy(buf, m_byte_position, bytes_to_copy);
+  // Returns the n most significant bits of the cache; n <= m_cache_bits.
+  uint64_t consume(std::size_t n) {
+    if (!n)
+      return 0;
 
-    m_byte_position += bytes_to_copy;
+    auto value     = m_cache >> (64 - n);
+    m_cache        = n < 64 ? m_cache << n : 0;
+    m_cache_bits  -= n;
 
-    if (bytes_to_copy < n) {
-      m_out_of_data = true;
-      throw mtx::mm_io::end_of_file_x();
+    return value;
+  }
+
+  void refill() {
+    if (m_cache_bits > 56)
+      return;
+
+    if ((m_end_of_data - m_next_byte) >= 8) {
+      auto num_bytes = (64 - m_cache_bits) / 8;
+      m_cache       |= load_uint64_be(m_next_byte) >> m_cache_bits;
+      m_next_byte   += num_bytes;
+      m_cache_bits  += num_bytes * 8;
+      return;
+    }
+
+    // Near the end the remaining bytes are added one at a time. The
+    // bits following the valid ones have to be cleared first as they
+    // may contain data from an earlier eight byte load.
+    m_cache &= m_cache_bits ? ~uint64_t{0} << (64 - m_cache_bits) : 0;
+
+    while ((m_cache_bits <= 56) && (m_next_byte < m_end_of_data)) {
+      m_cache      |= static_cast<uint64_t>(*m_next_byte) << (56 - m_cache_bits);
+      m_cache_bits += 8;
+      ++m_next_byte;
     }
   }
+
+  [[noreturn]] void throw_end_of_file() {
+    m_next_byte   = m_end_of_data;
+    m_cache       = 0;
+    m_cache_bits  = 0;
+    m_out_of_data = true;
+
+    throw mtx::mm_io::end_of_file_x();
+  }
+
+  void get_bytes_byte_aligned(unsigned char *buf, std::size_t n) {
+    auto byte_position = m_next_byte - m_cache_bits / 8;
+    auto bytes_to_copy = std::min<std::size_t>(n, m_end_of_data - byte_position);
+    std::memcpy(buf, byte_position, bytes_to_copy);
+
+    if (bytes_to_copy < n)
+      throw_end_of_file();
+
+    set_bit_position((byte_position + bytes_to_copy - m_start_of_data) * 8);
+  }
+
+  static uint64_t load_uint64_be(unsigned char const *p) {
+#if defined(__GNUC__) && defined(ARCH_LITTLEENDIAN)
+    uint64_t value;
+    std::memcpy(&value, p, 8);
+    return __builtin_bswap64(value);
+#else
+    uint64_t value = 0;
+    for (auto idx = 0; idx < 8; ++idx)
+      value = (value << 8) | p[idx];
+    return value;
+#endif
+  }
+
+  static std::size_t count_leading_zeros(uint64_t value) {
+    if (!value)
+      return 64;
+#if defined(__GNUC__)
+    return __builtin_clzll(value);
+#else
+    std::size_t zeros = 0;
+    for (auto mask = uint64_t{1} << 63; !(value & mask); mask >>= 1)
+      ++zeros;
+    return zeros;
+#endif
+  }
 };
 using bit_reader_cptr = std::shared_ptr<bit_reader_c>;
 
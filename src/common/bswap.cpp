@@ -14,10 +14,186 @@
 #include <stdexcept>
 
 #include "common/bswap.h"
+#include "common/cpu_features.h"
 #include "common/endian.h"
 
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#endif
+
 namespace mtx {
 
+namespace {
+
+// All scalar implementations work in place as well as they read each
+// word completely before writing it.
+
+void
+bswap_buffer_16(unsigned char const *src,
+                unsigned char *dst,
+                std::size_t num_bytes) {
+  for (std::size_t idx = 0; idx < num_bytes; idx += 2) {
+    uint16_t word;
+    std::memcpy(&word, &src[idx], 2);
+    word = bswap_16(word);
+    std::memcpy(&dst[idx], &word, 2);
+  }
+}
+
+void
+bswap_buffer_24(unsigned char const *src,
+                unsigned char *dst,
+                std::size_t num_bytes) {
+  for (std::size_t idx = 0; idx < num_bytes; idx += 3) {
+    auto first   = src[idx];
+    dst[idx + 1] = src[idx + 1];
+    dst[idx]     = src[idx + 2];
+    dst[idx + 2] = first;
+  }
+}
+
+void
+bswap_buffer_32(unsigned char const *src,
+                unsigned char *dst,
+                std::size_t num_bytes) {
+  for (std::size_t idx = 0; idx < num_bytes; idx += 4) {
+    uint32_t word;
+    std::memcpy(&word, &src[idx], 4);
+    word = bswap_32(word);
+    std::memcpy(&dst[idx], &word, 4);
+  }
+}
+
+void
+bswap_buffer_64(unsigned char const *src,
+                unsigned char *dst,
+                std::size_t num_bytes) {
+  for (std::size_t idx = 0; idx < num_bytes; idx += 8) {
+    uint64_t word;
+    std::memcpy(&word, &src[idx], 8);
+    word = bswap_64(word);
+    std::memcpy(&dst[idx], &word, 8);
+  }
+}
+
+void
+bswap_buffer_scalar(unsigned char const *src,
+                    unsigned char *dst,
+                    std::size_t num_bytes,
+                    std::size_t word_length) {
+  if (2 == word_length)
+    bswap_buffer_16(src, dst, num_bytes);
+
+  else if (3 == word_length)
+    bswap_buffer_24(src, dst, num_bytes);
+
+  else if (4 == word_length)
+    bswap_buffer_32(src, dst, num_bytes);
+
+  else if (8 == word_length)
+    bswap_buffer_64(src, dst, num_bytes);
+
+  else
+    for (std::size_t idx = 0; idx < num_bytes; idx += word_length)
+      put_uint_le(&dst[idx], get_uint_be(&src[idx], word_length), word_length);
+}
+
+#if defined(MTX_CPU_X86)
+
+// Each vector is loaded completely before it's stored. The kernels
+// therefore work in place as well.
+
+__attribute__((target("ssse3")))
+__m128i
+get_shuffle_mask_ssse3(std::size_t word_length) {
+  return 2 == word_length ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+       : 4 == word_length ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+       :                    _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+}
+
+__attribute__((target("ssse3")))
+std::size_t
+bswap_buffer_ssse3(unsigned char const *src,
+                   unsigned char *dst,
+                   std::size_t num_bytes,
+                   std::size_t word_length) {
+  auto mask = get_shuffle_mask_ssse3(word_length);
+  auto idx  = std::size_t{};
+
+  for (; (idx + 32) <= num_bytes; idx += 32) {
+    auto data_1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx]));
+    auto data_2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx + 16]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx]),      _mm_shuffle_epi8(data_1, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx + 16]), _mm_shuffle_epi8(data_2, mask));
+  }
+
+  for (; (idx + 16) <= num_bytes; idx += 16)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx]), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx])), mask));
+
+  return idx;
+}
+
+__attribute__((target("avx2")))
+std::size_t
+bswap_buffer_avx2(unsigned char const *src,
+                  unsigned char *dst,
+                  std::size_t num_bytes,
+                  std::size_t word_length) {
+  auto mask = _mm256_broadcastsi128_si256(get_shuffle_mask_ssse3(word_length));
+  auto idx  = std::size_t{};
+
+  for (; (idx + 64) <= num_bytes; idx += 64) {
+    auto data_1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&src[idx]));
+    auto data_2 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&src[idx + 32]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst[idx]),      _mm256_shuffle_epi8(data_1, mask));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst[idx + 32]), _mm256_shuffle_epi8(data_2, mask));
+  }
+
+  return idx + bswap_buffer_ssse3(&src[idx], &dst[idx], num_bytes - idx, word_length);
+}
+
+/* 24-bit words don't fit evenly into vectors. Each shuffle swaps the
+   four words in the first twelve bytes of a vector and leaves the
+   last four bytes as they are. Stores happen in ascending order; the
+   swapped bytes of the following vector overwrite the unchanged ones
+   written by the previous store.
+*/
+__attribute__((target("ssse3")))
+std::size_t
+bswap_buffer_24_ssse3(unsigned char const *src,
+                      unsigned char *dst,
+                      std::size_t num_bytes) {
+  auto mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+  auto idx  = std::size_t{};
+
+  for (; (idx + 52) <= num_bytes; idx += 48) {
+    auto data_1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx]));
+    auto data_2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx + 12]));
+    auto data_3 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx + 24]));
+    auto data_4 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx + 36]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx]),      _mm_shuffle_epi8(data_1, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx + 12]), _mm_shuffle_epi8(data_2, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx + 24]), _mm_shuffle_epi8(data_3, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx + 36]), _mm_shuffle_epi8(data_4, mask));
+  }
+
+  for (; (idx + 16) <= num_bytes; idx += 12)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[idx]), _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(&src[idx])), mask));
+
+  return idx;
+}
+
+#endif  // MTX_CPU_X86
+
+}
+
+/** \brief Converts big endian words to little endian ones or vice versa
+
+   \c src and \c dst may point to the same buffer for swapping in
+   place. Other overlapping buffers are not supported. Words of 16, 24,
+   32 and 64 bits are swapped with SSSE3 or AVX2 if the CPU supports
+   it.
+*/
 void
 bswap_buffer(unsigned char const *src,
              unsigned char *dst,
@@ -26,8 +202,19 @@ bswap_buffer(unsigned char const *src,
   if ((num_bytes % word_length) != 0)
     throw std::invalid_argument((boost::format(Y("The number of bytes to swap isn't divisible by %1%.")) % word_length).str());
 
-  for (std::size_t idx = 0; idx < num_bytes; idx += word_length)
-    put_uint_le(&dst[idx], get_uint_be(&src[idx], word_length), word_length);
+  auto done = std::size_t{};
+
+#if defined(MTX_CPU_X86)
+  if (mtx::cpu::has_ssse3()) {
+    if (3 == word_length)
+      done = bswap_buffer_24_ssse3(src, dst, num_bytes);
+
+    else if ((2 == word_length) || (4 == word_length) || (8 == word_length))
+      done = mtx::cpu::has_avx2() ? bswap_buffer_avx2(src, dst, num_bytes, word_length) : bswap_buffer_ssse3(src, dst, num_bytes, word_length);
+  }
+#endif
+
+  bswap_buffer_scalar(&src[done], &dst[done], num_bytes - done, word_length);
 }
 
 }
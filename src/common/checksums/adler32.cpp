@@ -14,10 +14,103 @@
 #include "common/common_pch.h"
 
 #include "common/checksums/adler32.h"
+#include "common/cpu_features.h"
 #include "common/endian.h"
 
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#endif
+
 namespace mtx { namespace checksum {
 
+namespace {
+
+uint32_t const s_mod_adler = 65521;
+
+// The largest number of bytes that can be added before the sums have
+// to be reduced without b overflowing 32 bits.
+std::size_t const s_max_bytes_without_reduction = 5552;
+
+void
+adler32_scalar(uint32_t &a,
+               uint32_t &b,
+               unsigned char const *buffer,
+               size_t size) {
+  while (size) {
+    auto num_bytes  = std::min(size, s_max_bytes_without_reduction);
+    size           -= num_bytes;
+
+    for (; num_bytes; --num_bytes) {
+      a += *buffer++;
+      b += a;
+    }
+
+    a %= s_mod_adler;
+    b %= s_mod_adler;
+  }
+}
+
+#if defined(MTX_CPU_X86)
+
+/* Processes 32 bytes per iteration. Over a block the sum b grows by
+   32 times the value of a at the block's start plus each byte weighted
+   by its distance from the block's end (32 for the first byte down to
+   1 for the last one). The weighted sums are calculated with
+   PMADDUBSW, the plain sums with PSADBW.
+*/
+__attribute__((target("ssse3")))
+void
+adler32_ssse3(uint32_t &a,
+              uint32_t &b,
+              unsigned char const *buffer,
+              size_t size) {
+  auto const weights_1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  auto const weights_2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1);
+  auto const zero      = _mm_setzero_si128();
+  auto const ones      = _mm_set1_epi16(1);
+  auto num_blocks      = size / 32;
+
+  size -= num_blocks * 32;
+
+  while (num_blocks) {
+    auto num_blocks_here  = std::min<std::size_t>(num_blocks, s_max_bytes_without_reduction / 32);
+    num_blocks           -= num_blocks_here;
+
+    // v_prev_a collects the values of a at the start of each block.
+    auto v_prev_a = _mm_cvtsi32_si128(a * num_blocks_here);
+    auto v_b      = _mm_cvtsi32_si128(b);
+    auto v_a      = zero;
+
+    for (; num_blocks_here; --num_blocks_here, buffer += 32) {
+      auto bytes_1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer));
+      auto bytes_2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + 16));
+
+      v_prev_a = _mm_add_epi32(v_prev_a, v_a);
+
+      v_a      = _mm_add_epi32(v_a, _mm_sad_epu8(bytes_1, zero));
+      v_b      = _mm_add_epi32(v_b, _mm_madd_epi16(_mm_maddubs_epi16(bytes_1, weights_1), ones));
+      v_a      = _mm_add_epi32(v_a, _mm_sad_epu8(bytes_2, zero));
+      v_b      = _mm_add_epi32(v_b, _mm_madd_epi16(_mm_maddubs_epi16(bytes_2, weights_2), ones));
+    }
+
+    v_b = _mm_add_epi32(v_b, _mm_slli_epi32(v_prev_a, 5));
+
+    v_a = _mm_add_epi32(v_a, _mm_shuffle_epi32(v_a, _MM_SHUFFLE(2, 3, 0, 1)));
+    v_a = _mm_add_epi32(v_a, _mm_shuffle_epi32(v_a, _MM_SHUFFLE(1, 0, 3, 2)));
+    v_b = _mm_add_epi32(v_b, _mm_shuffle_epi32(v_b, _MM_SHUFFLE(2, 3, 0, 1)));
+    v_b = _mm_add_epi32(v_b, _mm_shuffle_epi32(v_b, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    a = (a + static_cast<uint32_t>(_mm_cvtsi128_si32(v_a))) % s_mod_adler;
+    b = static_cast<uint32_t>(_mm_cvtsi128_si32(v_b))       % s_mod_adler;
+  }
+
+  adler32_scalar(a, b, buffer, size);
+}
+
+#endif  // MTX_CPU_X86
+
+}
+
 adler32_c::adler32_c()
   : m_a{1}
   , m_b{0}
@@ -47,10 +140,14 @@ adler32_c::get_result_as_uint()
 void
 adler32_c::add_impl(unsigned char const *buffer,
                     size_t size) {
-  for (auto idx = 0u; idx < size; ++idx) {
-    m_a = (m_a + buffer[idx]) % msc_mod_adler;
-    m_b = (m_b + m_a)         % msc_mod_adler;
+#if defined(MTX_CPU_X86)
+  if ((size >= 32) && mtx::cpu::has_ssse3()) {
+    adler32_ssse3(m_a, m_b, buffer, size);
+    return;
   }
+#endif
+
+  adler32_scalar(m_a, m_b, buffer, size);
 }
 
 }} // namespace mtx { namespace checksum {
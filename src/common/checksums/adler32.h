@@ -22,7 +22,6 @@ namespace mtx { namespace checksum {
 
 class adler32_c: public base_c, public uint_result_c {
 protected:
-  static uint32_t const msc_mod_adler = 65521;
   uint32_t m_a, m_b;
 
 public:
@@ -18,10 +18,123 @@
 
 #include "common/bswap.h"
 #include "common/checksums/crc.h"
+#include "common/cpu_features.h"
 #include "common/endian.h"
 
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+# define MTX_CRC_ARM64_CRC32
+# include <arm_acle.h>
+#endif
+
 namespace mtx { namespace checksum {
 
+namespace {
+
+#if defined(MTX_CPU_X86)
+
+__attribute__((target("sse4.1,pclmul")))
+inline __m128i
+load_128(unsigned char const *buffer) {
+  return _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer));
+}
+
+// Multiplies both halves of x with the constants in k and adds next.
+__attribute__((target("sse4.1,pclmul")))
+inline __m128i
+fold_128(__m128i x,
+         __m128i next,
+         __m128i k) {
+  return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), next);
+}
+
+/* Folds the buffer with carry-less multiplications, 64 bytes per
+   iteration, and reduces the result to the CRC with a Barrett
+   reduction. This is the algorithm from Intel's paper "Fast CRC
+   Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+   with the constants for the bit-reflected CRC-32 IEEE polynomial.
+
+   size must be at least 64 and a multiple of 16.
+*/
+__attribute__((target("sse4.1,pclmul")))
+uint32_t
+crc32_ieee_le_pclmul(uint32_t crc,
+                     unsigned char const *buffer,
+                     size_t size) {
+  alignas(16) static uint64_t const s_k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+  alignas(16) static uint64_t const s_k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+  alignas(16) static uint64_t const s_k5k0[] = { 0x0163cd6124, 0x0000000000 };
+  alignas(16) static uint64_t const s_poly[] = { 0x01db710641, 0x01f7011641 };
+
+  auto x1 = _mm_xor_si128(load_128(buffer), _mm_cvtsi32_si128(crc));
+  auto x2 = load_128(buffer + 0x10);
+  auto x3 = load_128(buffer + 0x20);
+  auto x4 = load_128(buffer + 0x30);
+  auto x0 = _mm_load_si128(reinterpret_cast<__m128i const *>(s_k1k2));
+
+  buffer += 64;
+  size   -= 64;
+
+  // Fold four blocks of 16 bytes in parallel.
+  for (; size >= 64; buffer += 64, size -= 64) {
+    x1 = fold_128(x1, load_128(buffer),        x0);
+    x2 = fold_128(x2, load_128(buffer + 0x10), x0);
+    x3 = fold_128(x3, load_128(buffer + 0x20), x0);
+    x4 = fold_128(x4, load_128(buffer + 0x30), x0);
+  }
+
+  // Fold the four blocks into one and the remaining 16 byte blocks
+  // into that one.
+  x0 = _mm_load_si128(reinterpret_cast<__m128i const *>(s_k3k4));
+  x1 = fold_128(x1, x2, x0);
+  x1 = fold_128(x1, x3, x0);
+  x1 = fold_128(x1, x4, x0);
+
+  for (; size >= 16; buffer += 16, size -= 16)
+    x1 = fold_128(x1, load_128(buffer), x0);
+
+  // Fold 128 bits to 64 bits.
+  auto mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+  x0 = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(s_k5k0));
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x00), x2);
+
+  // Barrett reduction to 32 bits.
+  x0 = _mm_load_si128(reinterpret_cast<__m128i const *>(s_poly));
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x10);
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+#elif defined(MTX_CRC_ARM64_CRC32)
+
+uint32_t
+crc32_ieee_le_arm64(uint32_t crc,
+                    unsigned char const *buffer,
+                    size_t size) {
+  for (; size >= 8; buffer += 8, size -= 8) {
+    uint64_t value;
+    std::memcpy(&value, buffer, 8);
+    crc = __crc32d(crc, value);
+  }
+
+  while (size--)
+    crc = __crc32b(crc, *buffer++);
+
+  return crc;
+}
+
+#endif
+
+}
+
 crc_base_c::table_parameters_t const crc_base_c::ms_table_parameters[5] = {
   { 0,  8,       0x07 },
   { 0, 16,     0x8005 },
@@ -57,7 +170,7 @@ crc_base_c::init_table() {
   if ((parameters.bits < 8) || (parameters.bits > 32) || (parameters.poly >= (1LL<<parameters.bits)))
     throw std::domain_error{"Invalid CRC parameters"};
 
-  m_table.resize(256);
+  m_table.resize(8 * 256);
 
   for (auto i = 0u; i < 256u; i++) {
     if (parameters.le) {
@@ -74,6 +187,14 @@ crc_base_c::init_table() {
     }
   }
 
+  // Table n contains the CRC of a byte followed by n zero bytes. They
+  // allow processing eight bytes at once ("slicing-by-8").
+  for (auto n = 1u; n < 8u; ++n)
+    for (auto i = 0u; i < 256u; i++) {
+      auto previous        = m_table[(n - 1) * 256 + i];
+      m_table[n * 256 + i] = (previous >> 8) ^ m_table[previous & 0xff];
+    }
+
   // for (auto row = 0u; row < (256u / 4); ++row)
   //   mxinfo(boost::format("0x%|1$08x| 0x%|2$08x| 0x%|3$08x| 0x%|4$08x|\n")
   //          % m_table[row * 4 + 0] % m_table[row * 4 + 1] % m_table[row * 4 + 2] % m_table[row * 4 + 3]);
@@ -127,12 +248,27 @@ crc_base_c::set_result_in_le(bool result_in_le) {
 void
 crc_base_c::add_impl(unsigned char const *buffer,
                      size_t size) {
-  auto end = buffer + size;
-
-  while (buffer < end) {
-    m_crc = m_table[(m_crc & 0xff) ^ *buffer] ^ (m_crc >> 8);
-    ++buffer;
+  auto crc   = m_crc;
+  auto table = m_table.data();
+
+  for (; size >= 8; buffer += 8, size -= 8) {
+    auto one = crc ^ get_uint32_le(buffer);
+    auto two = get_uint32_le(buffer + 4);
+
+    crc = table[7 * 256 + ( one        & 0xff)]
+        ^ table[6 * 256 + ((one >>  8) & 0xff)]
+        ^ table[5 * 256 + ((one >> 16) & 0xff)]
+        ^ table[4 * 256 + ( one >> 24        )]
+        ^ table[3 * 256 + ( two        & 0xff)]
+        ^ table[2 * 256 + ((two >>  8) & 0xff)]
+        ^ table[1 * 256 + ((two >> 16) & 0xff)]
+        ^ table[0 * 256 + ( two >> 24        )];
   }
+
+  for (; size; ++buffer, --size)
+    crc = table[(crc & 0xff) ^ *buffer] ^ (crc >> 8);
+
+  m_crc = crc;
 }
 
 // ----------------------------------------------------------------------
@@ -195,4 +331,23 @@ crc32_ieee_le_c::crc32_ieee_le_c(uint32_t initial_value)
 crc32_ieee_le_c::~crc32_ieee_le_c() {
 }
 
+void
+crc32_ieee_le_c::add_impl(unsigned char const *buffer,
+                          size_t size) {
+#if defined(MTX_CPU_X86)
+  if ((size >= 64) && mtx::cpu::has_pclmul() && mtx::cpu::has_sse41()) {
+    auto num_folded  = size & ~static_cast<size_t>(15);
+    m_crc            = crc32_ieee_le_pclmul(m_crc, buffer, num_folded);
+    buffer          += num_folded;
+    size            -= num_folded;
+  }
+
+#elif defined(MTX_CRC_ARM64_CRC32)
+  m_crc = crc32_ieee_le_arm64(m_crc, buffer, size);
+  return;
+#endif
+
+  crc_base_c::add_impl(buffer, size);
+}
+
 }} // namespace mtx { namespace checksum {
@@ -111,6 +111,9 @@ protected:
 public:
   crc32_ieee_le_c(uint32_t initial_value = 0);
   virtual ~crc32_ieee_le_c();
+
+protected:
+  virtual void add_impl(unsigned char const *buffer, size_t size);
 };
 
 }} // namespace mtx { namespace checksum {
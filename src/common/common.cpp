@@ -81,6 +81,8 @@ static std::string s_program_name;
 
 static void
 mtx_common_cleanup() {
+  memory_pool_c::dump_statistics();
+
   // Make sure g_mm_stdio is closed before the global destruction
   // kicks in. If it's redirected to a file then this is an instance
   // of a buffered file. If it's only collected via global destruction
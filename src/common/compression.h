@@ -81,6 +81,13 @@ public:
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
+  // Whether or not compress() may be called from several threads at
+  // the same time. Such compressors must report errors by throwing
+  // mtx::compression_x instead of calling mxerror().
+  virtual bool is_thread_safe() const {
+    return false;
+  }
+
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
   static compressor_ptr create_from_file_name(std::string const &file_name);
@@ -70,7 +70,7 @@ zlib_compressor_c::do_compress(memory_cptr const &buffer) {
   int result      = deflateInit(&c_stream, 9);
 
   if (Z_OK != result)
-    mxerror(boost::format(Y("deflateInit() failed. Result: %1%\n")) % result);
+    throw mtx::compression_x(boost::format(Y("deflateInit() failed. Result: %1%\n")) % result);
 
   c_stream.next_in   = (Bytef *)buffer->get_buffer();
   c_stream.avail_in  = buffer->get_size();
@@ -85,7 +85,7 @@ zlib_compressor_c::do_compress(memory_cptr const &buffer) {
     result             = deflate(&c_stream, Z_FINISH);
 
     if ((Z_OK != result) && (Z_STREAM_END != result))
-      mxerror(boost::format(Y("Zlib decompression failed. Result: %1%\n")) % result);
+      throw mtx::compression_x(boost::format(Y("Zlib decompression failed. Result: %1%\n")) % result);
 
   } while ((c_stream.avail_out == 0) && (result != Z_STREAM_END));
 
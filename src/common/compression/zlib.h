@@ -25,6 +25,10 @@ public:
   zlib_compressor_c();
   virtual ~zlib_compressor_c();
 
+  virtual bool is_thread_safe() const {
+    return true;
+  }
+
 protected:
   virtual memory_cptr do_decompress(memory_cptr const &buffer);
   virtual memory_cptr do_compress(memory_cptr const &buffer);
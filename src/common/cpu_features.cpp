@@ -0,0 +1,91 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   detecting the instruction sets the CPU supports
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/cpu_features.h"
+#include "common/debugging.h"
+
+namespace mtx { namespace cpu {
+
+namespace {
+
+struct features_t {
+  bool sse2{}, ssse3{}, sse41{}, avx2{}, pclmul{};
+};
+
+features_t
+detect_features() {
+  static debugging_option_c s_debug{"cpu_features"};
+
+  features_t features;
+
+#if defined(MTX_CPU_X86)
+  __builtin_cpu_init();
+
+  features.sse2   = !!__builtin_cpu_supports("sse2");
+  features.ssse3  = !!__builtin_cpu_supports("ssse3");
+  features.sse41  = !!__builtin_cpu_supports("sse4.1");
+  features.avx2   = !!__builtin_cpu_supports("avx2");
+  features.pclmul = !!__builtin_cpu_supports("pclmul");
+#endif
+
+  if (s_debug) {
+    auto names = std::vector<std::string>{};
+
+    if (features.sse2)   names.emplace_back("SSE2");
+    if (features.ssse3)  names.emplace_back("SSSE3");
+    if (features.sse41)  names.emplace_back("SSE4.1");
+    if (features.avx2)   names.emplace_back("AVX2");
+    if (features.pclmul) names.emplace_back("PCLMULQDQ");
+
+    mxdebug(boost::format("mtx::cpu: supported instruction set extensions: %1%\n") % (names.empty() ? std::string{"none"} : boost::join(names, " ")));
+  }
+
+  return features;
+}
+
+features_t const &
+get_features() {
+  static auto s_features = detect_features();
+  return s_features;
+}
+
+}
+
+bool
+has_sse2() {
+  return get_features().sse2;
+}
+
+bool
+has_ssse3() {
+  return get_features().ssse3;
+}
+
+bool
+has_sse41() {
+  return get_features().sse41;
+}
+
+bool
+has_avx2() {
+  return get_features().avx2;
+}
+
+bool
+has_pclmul() {
+  return get_features().pclmul;
+}
+
+}}
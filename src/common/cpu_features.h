@@ -0,0 +1,36 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for detecting the instruction sets the CPU supports
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_CPU_FEATURES_H
+#define MTX_COMMON_CPU_FEATURES_H
+
+#include "common/common_pch.h"
+
+// Defined if kernels for x86 instruction set extensions can be
+// compiled with __attribute__((target(…))). Whether or not they can be
+// run is determined at runtime with the functions below.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define MTX_CPU_X86
+#endif
+
+namespace mtx { namespace cpu {
+
+bool has_sse2();
+bool has_ssse3();
+bool has_sse41();
+bool has_avx2();
+bool has_pclmul();
+
+}}
+
+#endif  // MTX_COMMON_CPU_FEATURES_H
@@ -155,23 +155,28 @@ debugging_c::hexdump(memory_c const &buffer_to_dump,
 
 // ------------------------------------------------------------
 
-std::vector<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
+std::deque<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
+std::mutex debugging_option_c::ms_mutex;
 
-size_t
+debugging_option_c::option_c &
 debugging_option_c::register_option(std::string const &option) {
+  std::lock_guard<std::mutex> lock{ms_mutex};
+
   auto itr = brng::find_if(ms_registered_options, [&option](option_c const &opt) { return opt.m_option == option; });
   if (itr != ms_registered_options.end())
-    return std::distance(ms_registered_options.begin(), itr);
+    return *itr;
 
   ms_registered_options.emplace_back(option);
 
-  return ms_registered_options.size() - 1;
+  return ms_registered_options.back();
 }
 
 void
 debugging_option_c::invalidate_cache() {
+  std::lock_guard<std::mutex> lock{ms_mutex};
+
   for (auto &opt : ms_registered_options)
-    opt.m_requested = boost::logic::indeterminate;
+    opt.m_requested.store(-1);
 }
 
 // ------------------------------------------------------------
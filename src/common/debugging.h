@@ -16,6 +16,9 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 
@@ -47,46 +50,73 @@ public:
 
 class debugging_option_c {
   struct option_c {
-    boost::tribool m_requested;
+    // -1: not determined yet; 0: not requested; 1: requested
+    std::atomic<int> m_requested;
     std::string m_option;
 
     option_c(std::string const &option)
-      : m_requested{boost::logic::indeterminate}
+      : m_requested{-1}
       , m_option{option}
     {
     }
 
     bool get() {
-      if (boost::logic::indeterminate(m_requested))
-        m_requested = debugging_c::requested(m_option);
+      auto requested = m_requested.load();
+      if (-1 == requested) {
+        requested = debugging_c::requested(m_option) ? 1 : 0;
+        m_requested.store(requested);
+      }
 
-      return m_requested;
+      return !!requested;
     }
   };
 
 protected:
-  mutable size_t m_registered_idx;
+  // Static options are evaluated by several threads, e.g. by file
+  // type probes running concurrently.
+  mutable std::atomic<option_c *> m_registered_option;
   std::string m_option;
 
 private:
-  static std::vector<option_c> ms_registered_options;
+  // A deque keeps references to existing entries valid while options
+  // are registered from other threads.
+  static std::deque<option_c> ms_registered_options;
+  static std::mutex ms_mutex;
 
 public:
   debugging_option_c(std::string const &option)
-    : m_registered_idx{std::numeric_limits<size_t>::max()}
+    : m_registered_option{}
     , m_option{option}
   {
   }
 
+  debugging_option_c(debugging_option_c const &other)
+    : m_registered_option{other.m_registered_option.load()}
+    , m_option{other.m_option}
+  {
+  }
+
+  debugging_option_c &operator =(debugging_option_c const &other) {
+    m_registered_option.store(other.m_registered_option.load());
+    m_option = other.m_option;
+
+    return *this;
+  }
+
   operator bool() const {
-    if (m_registered_idx == std::numeric_limits<size_t>::max())
-      m_registered_idx = register_option(m_option);
+    auto registered_option = m_registered_option.load();
+    if (!registered_option) {
+      registered_option = &register_option(m_option);
+      m_registered_option.store(registered_option);
+    }
 
-    return ms_registered_options.at(m_registered_idx).get();
+    return registered_option->get();
   }
 
+private:
+  static option_c &register_option(std::string const &option);
+
 public:
-  static size_t register_option(std::string const &option);
   static void invalidate_cache();
 };
 
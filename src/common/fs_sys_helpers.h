@@ -19,6 +19,8 @@ namespace mtx { namespace sys {
 
 int64_t get_current_time_millis();
 
+// Runs the command and returns its exit code or -1 if it could not be
+// run or didn't exit normally.
 int system(std::string const &command);
 
 void determine_path_to_current_executable(std::string const &argv0);
@@ -30,11 +32,10 @@ uint64_t get_memory_usage();
 bool is_installed();
 
 std::string get_environment_variable(const std::string &key);
+void set_environment_variable(const std::string &key, const std::string &value);
 
 #if defined(SYS_WINDOWS)
 
-void set_environment_variable(const std::string &key, const std::string &value);
-
 #define WINDOWS_VERSION_UNKNOWN      0x00000000
 #define WINDOWS_VERSION_2000         0x00050000
 #define WINDOWS_VERSION_XP           0x00050001
@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 
 #if defined(SYS_APPLE)
 # include <mach-o/dyld.h>
@@ -68,7 +69,17 @@ get_environment_variable(std::string const &key) {
 
 int
 system(std::string const &command) {
-  return ::system(command.c_str());
+  auto status = ::system(command.c_str());
+  if ((-1 == status) || !WIFEXITED(status))
+    return -1;
+
+  return WEXITSTATUS(status);
+}
+
+void
+set_environment_variable(std::string const &key,
+                         std::string const &value) {
+  setenv(key.c_str(), value.c_str(), 1);
 }
 
 bfs::path
@@ -108,14 +108,21 @@ system(std::string const &command) {
                                  &pi                                             // process info
                                  );
 
+  if (!result)
+    return -1;
+
   // Wait until child process exits.
   WaitForSingleObject(pi.hProcess, INFINITE);
 
+  DWORD exit_code = 0;
+  if (!GetExitCodeProcess(pi.hProcess, &exit_code))
+    exit_code = static_cast<DWORD>(-1);
+
   // Close process and thread handles.
   CloseHandle(pi.hProcess);
   CloseHandle(pi.hThread);
 
-  return !result ? -1 : 0;
+  return static_cast<int>(exit_code);
 
 }
 
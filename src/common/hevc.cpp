@@ -1442,65 +1442,63 @@ es_parser_c::discard_actual_frames(bool discard) {
 void
 es_parser_c::add_bytes(unsigned char *buffer,
                        size_t size) {
-  memory_slice_cursor_c cursor;
-  int marker_size              = 0;
-  int previous_marker_size     = 0;
-  int previous_pos             = -1;
-  uint64_t previous_parsed_pos = m_parsed_position;
-
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
-
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          auto new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          auto nalu     = memory_c::alloc(new_size);
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          m_parsed_position = previous_parsed_pos + previous_pos;
-
-          mtx::mpeg::remove_trailing_zero_bytes(*nalu);
-          if (nalu->get_size())
-            handle_nalu(nalu, m_parsed_position);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
+  auto previous_parsed_pos = m_parsed_position;
+  m_stream_position       += size;
+
+  // Scan a contiguous buffer: either the new data alone or the new
+  // data appended to what's left over from the previous call.
+  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size())) {
+    m_unparsed_buffer->add(buffer, size);
+    buffer = m_unparsed_buffer->get_buffer();
+    size   = m_unparsed_buffer->get_size();
+  }
 
-      if (!cursor.char_available())
-        break;
+  auto end                  = buffer + size;
+  auto scan_pos             = static_cast<unsigned char const *>(buffer);
+  auto previous_marker_size = 0;
+  unsigned char const *previous_marker{};
+
+  while (true) {
+    auto marker = mtx::mpeg::find_start_code(scan_pos, end);
+    if (marker == end)
+      break;
+
+    scan_pos         = marker + 3;
+    auto marker_size = 3;
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+    if ((marker > buffer) && !marker[-1]) {
+      --marker;
+      marker_size = 4;
     }
+
+    if (previous_marker) {
+      auto nalu_start = previous_marker + previous_marker_size;
+      auto nalu       = memory_c::clone(nalu_start, marker - nalu_start);
+      m_parsed_position = previous_parsed_pos + (previous_marker - buffer);
+
+      mtx::mpeg::remove_trailing_zero_bytes(*nalu);
+      if (nalu->get_size())
+        handle_nalu(nalu, m_parsed_position);
+    }
+
+    previous_marker      = marker;
+    previous_marker_size = marker_size;
   }
 
-  if (-1 == previous_pos)
-    previous_pos = 0;
+  auto previous_pos = previous_marker ? previous_marker - buffer : 0;
+  m_parsed_position = previous_parsed_pos + previous_pos;
 
-  m_stream_position += size;
-  m_parsed_position  = previous_parsed_pos + previous_pos;
+  auto new_size = size - previous_pos;
+  if (0 == new_size)
+    m_unparsed_buffer.reset();
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    m_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
+  else if (m_unparsed_buffer && (m_unparsed_buffer->get_buffer() == buffer)) {
+    if (previous_pos)
+      memmove(buffer, buffer + previous_pos, new_size);
+    m_unparsed_buffer->resize(new_size);
 
   } else
-    m_unparsed_buffer.reset();
+    m_unparsed_buffer = memory_c::clone(buffer + previous_pos, new_size);
 }
 
 void
@@ -1554,7 +1552,8 @@ es_parser_c::handle_slice_nalu(memory_cptr const &nalu,
   }
 
   slice_info_t si;
-  if (!parse_slice(mpeg::nalu_to_rbsp(nalu), si))
+  auto rbsp_size = mpeg::nalu_to_rbsp(nalu->get_buffer(), nalu->get_size(), m_rbsp_buffer);
+  if (!parse_slice(m_rbsp_buffer.get_buffer(), rbsp_size, si))
     return;
 
   if (m_have_incomplete_frame && si.first_slice_segment_in_pic_flag)
@@ -1837,10 +1836,11 @@ es_parser_c::handle_nalu(memory_cptr const &nalu,
 }
 
 bool
-es_parser_c::parse_slice(memory_cptr const &buffer,
+es_parser_c::parse_slice(unsigned char const *buffer,
+                         std::size_t size,
                          slice_info_t &si) {
   try {
-    bit_reader_c r(buffer->get_buffer(), buffer->get_size());
+    bit_reader_c r(buffer, size);
     unsigned int i;
 
     memset(&si, 0, sizeof(si));
@@ -455,6 +455,7 @@ protected:
   codec_private_t m_codec_private;
 
   memory_cptr m_unparsed_buffer;
+  memory_c m_rbsp_buffer;
   uint64_t m_stream_position, m_parsed_position;
 
   frame_t m_incomplete_frame;
@@ -582,7 +583,7 @@ public:
   static std::string get_nalu_type_name(int type);
 
 protected:
-  bool parse_slice(memory_cptr const &buffer, slice_info_t &si);
+  bool parse_slice(unsigned char const *buffer, std::size_t size, slice_info_t &si);
   void handle_vps_nalu(memory_cptr const &nalu);
   void handle_sps_nalu(memory_cptr const &nalu);
   void handle_pps_nalu(memory_cptr const &nalu);
@@ -19,6 +19,8 @@
 #include <ebml/EbmlStream.h>
 #include <ebml/EbmlVoid.h>
 #include <matroska/KaxCluster.h>
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxInfoData.h>
 #include <matroska/KaxSeekHead.h>
 #include <matroska/KaxSegment.h>
 #include <matroska/KaxTags.h>
@@ -30,8 +32,11 @@
 #include "common/error.h"
 #include "common/list_utils.h"
 #include "common/kax_analyzer.h"
+#include "common/kax_analyzer_cache.h"
 #include "common/mm_io_x.h"
 #include "common/strings/editing.h"
+#include "common/strings/formatting.h"
+#include "common/vint.h"
 
 using namespace libebml;
 using namespace libmatroska;
@@ -40,6 +45,10 @@ using namespace libmatroska;
 
 #define CONSOLE_PERCENTAGE_WIDTH 25
 
+// The number of clusters whose headers are compared with a cached
+// layout. All other level 1 elements are always compared.
+#define LAYOUT_CACHE_NUM_SAMPLED_CLUSTERS 8
+
 bool
 operator <(const kax_analyzer_data_cptr &d1,
            const kax_analyzer_data_cptr &d2) {
@@ -85,11 +94,21 @@ kax_analyzer_c::~kax_analyzer_c() {
 void
 kax_analyzer_c::close_file() {
   if (m_close_file) {
+    // The file's modification time is only final once it has been
+    // closed.
+    auto store_layout = m_file && m_layout_modified;
+    auto segment_uid  = store_layout ? read_segment_uid_as_hex() : std::string{};
+
     delete m_file;
     m_file = nullptr;
 
     delete m_stream;
     m_stream = nullptr;
+
+    if (store_layout)
+      store_layout_in_cache(segment_uid);
+
+    m_layout_modified = false;
   }
 }
 
@@ -317,6 +336,18 @@ kax_analyzer_c::process_internal() {
   if (m_parser_start_position)
     m_file->setFilePointer(std::max<uint64_t>(*m_parser_start_position, m_segment->GetElementPosition() + m_segment->HeadSize()));
 
+  else {
+    // A cached layout either replaces the scan completely or, if the
+    // file has only been appended to, lets the scan continue at the
+    // last known level 1 element.
+    auto cache_result = restore_layout_from_cache(file_size);
+
+    if (lcr_complete == cache_result) {
+      show_progress_done();
+      return true;
+    }
+  }
+
   // We've got our segment, so let's find all level 1 elements.
   while (m_file->getFilePointer() < m_segment_end) {
     if (!l1)
@@ -353,6 +384,9 @@ kax_analyzer_c::process_internal() {
     if (parse_mode_full != m_parse_mode)
       fix_element_sizes(file_size);
 
+    if (!m_parser_start_position && mtx::kax_analyzer_cache::is_enabled())
+      store_layout_in_cache(read_segment_uid_as_hex());
+
     return true;
   }
 
@@ -431,6 +465,8 @@ kax_analyzer_c::update_element(EbmlElement *e,
     call_and_validate(add_to_meta_seek(e),                        "update_element_6");
     call_and_validate(merge_void_elements(),                      "update_element_7");
 
+    m_layout_modified = true;
+
   } catch (kax_analyzer_c::update_element_result_e result) {
     debug_dump_elements_maybe("update_element_exception");
     return result;
@@ -455,6 +491,8 @@ kax_analyzer_c::remove_elements(EbmlId const &id) {
     call_and_validate(remove_from_meta_seeks(id),                 "remove_elements_4");
     call_and_validate(merge_void_elements(),                      "remove_elements_5");
 
+    m_layout_modified = true;
+
   } catch (kax_analyzer_c::update_element_result_e result) {
     debug_dump_elements_maybe("update_element_exception");
     return result;
@@ -1449,6 +1487,136 @@ kax_analyzer_c::get_segment_data_start_pos()
   return m_segment->GetElementPosition() + m_segment->HeadSize();
 }
 
+kax_analyzer_c::layout_cache_result_e
+kax_analyzer_c::restore_layout_from_cache(uint64_t file_size) {
+  if (!m_close_file || !mtx::kax_analyzer_cache::is_enabled())
+    return lcr_miss;
+
+  auto entry       = mtx::kax_analyzer_cache::load(m_file_name);
+  auto state       = mtx::kax_analyzer_cache::entry_t{};
+  auto parse_fully = parse_mode_full == m_parse_mode;
+
+  // Layouts found in fast mode are only good enough for fast mode.
+  if (   !entry
+      || entry->m_data.empty()
+      || (parse_fully && !entry->m_parsed_fully)
+      || (entry->m_segment_position != m_segment->GetElementPosition())
+      || !mtx::kax_analyzer_cache::get_file_state(m_file_name, state)
+      || (state.m_file_size != file_size))
+    return lcr_miss;
+
+  auto unchanged = (state.m_file_size == entry->m_file_size) && (state.m_modification_time == entry->m_modification_time);
+  auto appended  = parse_fully && (state.m_file_size > entry->m_file_size);
+
+  if (!unchanged && !appended)
+    return lcr_miss;
+
+  // The sizes in fast mode are only estimates based on the positions
+  // of the following elements. The last element's size may have
+  // changed when data has been appended.
+  auto &data = entry->m_data;
+  std::vector<std::size_t> cluster_indexes;
+
+  for (auto idx = 0u; idx < data.size(); ++idx) {
+    auto check_size = entry->m_parsed_fully && (unchanged || ((idx + 1) < data.size()));
+
+    if (Is<KaxCluster>(data[idx]->m_id) && check_size)
+      cluster_indexes.push_back(idx);
+
+    else if (!verify_cached_element(*data[idx], check_size)) {
+      mxdebug_if(m_debug, boost::format("kax_analyzer: cached layout for '%1%' differs at %2%\n") % m_file_name % data[idx]->to_string());
+      return lcr_miss;
+    }
+  }
+
+  auto num_samples = std::min<std::size_t>(cluster_indexes.size(), LAYOUT_CACHE_NUM_SAMPLED_CLUSTERS);
+  for (auto sample = 0u; sample < num_samples; ++sample) {
+    auto idx = cluster_indexes[1 < num_samples ? sample * (cluster_indexes.size() - 1) / (num_samples - 1) : 0];
+
+    if (!verify_cached_element(*data[idx], true)) {
+      mxdebug_if(m_debug, boost::format("kax_analyzer: cached layout for '%1%' differs at %2%\n") % m_file_name % data[idx]->to_string());
+      return lcr_miss;
+    }
+  }
+
+  m_data = data;
+
+  if (read_segment_uid_as_hex() != entry->m_segment_uid) {
+    m_data.clear();
+    return lcr_miss;
+  }
+
+  if (unchanged) {
+    mxdebug_if(m_debug, boost::format("kax_analyzer: using the cached layout for '%1%'\n") % m_file_name);
+    return lcr_complete;
+  }
+
+  // Re-scan the last element as its size may have changed, e.g. for
+  // clusters of unknown size written by live recordings.
+  auto resume_position = m_data.back()->m_pos;
+  m_data.pop_back();
+  m_file->setFilePointer(resume_position);
+
+  mxdebug_if(m_debug, boost::format("kax_analyzer: continuing the scan of '%1%' at %2% after %3% cached elements\n") % m_file_name % resume_position % m_data.size());
+
+  return lcr_appended;
+}
+
+bool
+kax_analyzer_c::verify_cached_element(kax_analyzer_data_c const &data,
+                                      bool check_size) {
+  try {
+    m_file->setFilePointer(data.m_pos);
+
+    auto id   = vint_c::read_ebml_id(*m_file);
+    auto size = vint_c::read(*m_file);
+
+    if (!id.is_valid() || !size.is_valid() || (static_cast<uint64_t>(id.m_value) != EBML_ID_VALUE(data.m_id)))
+      return false;
+
+    if (!data.m_size_known || size.is_unknown())
+      return !data.m_size_known && size.is_unknown();
+
+    return !check_size || ((m_file->getFilePointer() - data.m_pos + size.m_value) == static_cast<uint64_t>(data.m_size));
+
+  } catch (mtx::mm_io::exception &) {
+    return false;
+  }
+}
+
+std::string
+kax_analyzer_c::read_segment_uid_as_hex() {
+  try {
+    auto element      = read_all(EBML_INFO(KaxInfo));
+    auto segment_info = dynamic_cast<KaxInfo *>(element.get());
+    auto segment_uid  = segment_info ? FindChild<KaxSegmentUID>(segment_info) : nullptr;
+
+    if (segment_uid)
+      return to_hex(*segment_uid, true);
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  return {};
+}
+
+void
+kax_analyzer_c::store_layout_in_cache(std::string const &segment_uid) {
+  if (!m_close_file || !m_segment || m_data.empty() || !mtx::kax_analyzer_cache::is_enabled())
+    return;
+
+  auto entry = mtx::kax_analyzer_cache::entry_t{};
+  if (!mtx::kax_analyzer_cache::get_file_state(m_file_name, entry))
+    return;
+
+  entry.m_segment_uid      = segment_uid;
+  entry.m_segment_position = m_segment->GetElementPosition();
+  entry.m_parsed_fully     = parse_mode_full == m_parse_mode;
+  entry.m_data             = m_data;
+
+  mtx::kax_analyzer_cache::store(entry);
+}
+
 bitvalue_cptr
 kax_analyzer_c::read_segment_uid_from(std::string const &file_name) {
   try {
@@ -95,6 +95,13 @@ public:
     ps_end,
   };
 
+protected:
+  enum layout_cache_result_e {
+    lcr_miss,
+    lcr_complete,
+    lcr_appended,
+  };
+
 private:
   std::vector<kax_analyzer_data_cptr> m_data;
   std::string m_file_name;
@@ -109,6 +116,7 @@ private:
   open_mode m_open_mode{MODE_WRITE};
   bool m_throw_on_error{};
   boost::optional<uint64_t> m_parser_start_position;
+  bool m_layout_modified{};
 
 public:                         // Static functions
   static bool probe(std::string file_name);
@@ -201,6 +209,11 @@ protected:
   virtual void fix_element_sizes(uint64_t file_size);
   virtual void fix_unknown_size_for_last_level1_element();
 
+  virtual layout_cache_result_e restore_layout_from_cache(uint64_t file_size);
+  virtual bool verify_cached_element(kax_analyzer_data_c const &data, bool check_size);
+  virtual void store_layout_in_cache(std::string const &segment_uid);
+  virtual std::string read_segment_uid_as_hex();
+
 protected:
   virtual bool process_internal();
 };
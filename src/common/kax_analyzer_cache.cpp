@@ -0,0 +1,175 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   on-disk cache of analyzed file layouts
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/checksums/base.h"
+#include "common/json.h"
+#include "common/kax_analyzer_cache.h"
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+
+namespace mtx { namespace kax_analyzer_cache {
+
+namespace {
+
+unsigned int const s_format_version = 1;
+
+bfs::path s_directory;
+debugging_option_c s_debug{"kax_analyzer_cache"};
+
+bfs::path
+get_absolute_path(std::string const &file_name) {
+  boost::system::error_code ec;
+  auto path = bfs::absolute(bfs::path{file_name});
+  auto full = bfs::canonical(path, ec);
+
+  return ec ? path : full;
+}
+
+bfs::path
+get_entry_file_name(bfs::path const &file_name) {
+  auto name = file_name.string();
+  auto hash = mtx::checksum::calculate(mtx::checksum::algorithm_e::md5, name.c_str(), name.length());
+
+  return s_directory / (to_hex(hash, true) + ".json");
+}
+
+}
+
+void
+set_directory(bfs::path const &directory) {
+  s_directory = directory;
+}
+
+bool
+is_enabled() {
+  return !s_directory.empty();
+}
+
+bool
+get_file_state(std::string const &file_name,
+               entry_t &entry) {
+  auto path = get_absolute_path(file_name);
+  boost::system::error_code ec;
+
+  auto file_size = bfs::file_size(path, ec);
+  if (ec)
+    return false;
+
+  auto modification_time = bfs::last_write_time(path, ec);
+  if (ec)
+    return false;
+
+  entry.m_file_name         = path.string();
+  entry.m_file_size         = file_size;
+  entry.m_modification_time = modification_time;
+
+  return true;
+}
+
+boost::optional<entry_t>
+load(std::string const &file_name) {
+  if (!is_enabled())
+    return boost::none;
+
+  auto path       = get_absolute_path(file_name);
+  auto entry_name = get_entry_file_name(path);
+
+  if (!bfs::exists(entry_name))
+    return boost::none;
+
+  try {
+    mm_file_io_c in{entry_name.string()};
+    std::string content;
+    in.read(content, in.get_size());
+
+    auto json = mtx::json::parse(content);
+
+    if (   (json["version"].get<unsigned int>()  != s_format_version)
+        || (json["file_name"].get<std::string>() != path.string()))
+      return boost::none;
+
+    auto entry                = entry_t{};
+    entry.m_file_name         = json["file_name"].get<std::string>();
+    entry.m_segment_uid       = json["segment_uid"].get<std::string>();
+    entry.m_file_size         = json["file_size"].get<uint64_t>();
+    entry.m_segment_position  = json["segment_position"].get<uint64_t>();
+    entry.m_modification_time = json["modification_time"].get<int64_t>();
+    entry.m_parsed_fully      = json["parsed_fully"].get<bool>();
+
+    for (auto const &element : json["elements"]) {
+      auto id = element[0].get<uint32_t>();
+      auto id_length = 1u;
+      while ((id_length < 4) && (id >= (1u << (8 * id_length))))
+        ++id_length;
+
+      entry.m_data.push_back(kax_analyzer_data_c::create(EbmlId{id, id_length}, element[1].get<uint64_t>(), element[2].get<int64_t>(), element[3].get<bool>()));
+    }
+
+    mxdebug_if(s_debug, boost::format("kax_analyzer_cache: loaded %1% elements for '%2%' from '%3%'\n") % entry.m_data.size() % path.string() % entry_name.string());
+
+    return entry;
+
+  } catch (std::exception &ex) {
+    mxdebug_if(s_debug, boost::format("kax_analyzer_cache: reading '%1%' failed: %2%\n") % entry_name.string() % ex.what());
+  }
+
+  return boost::none;
+}
+
+void
+store(entry_t const &entry) {
+  if (!is_enabled())
+    return;
+
+  auto elements = nlohmann::json::array();
+  for (auto const &data : entry.m_data)
+    elements.push_back(nlohmann::json::array({ EBML_ID_VALUE(data->m_id), data->m_pos, data->m_size, data->m_size_known }));
+
+  auto json = nlohmann::json{
+    { "version",           s_format_version          },
+    { "file_name",         entry.m_file_name         },
+    { "segment_uid",       entry.m_segment_uid       },
+    { "file_size",         entry.m_file_size         },
+    { "segment_position",  entry.m_segment_position  },
+    { "modification_time", entry.m_modification_time },
+    { "parsed_fully",      entry.m_parsed_fully      },
+    { "elements",          elements                  },
+  };
+
+  // Several processes may work on the same file. Writing to a
+  // temporary file first and renaming it afterwards ensures that other
+  // processes never see partially written entries.
+  auto entry_name     = get_entry_file_name(bfs::path{entry.m_file_name});
+  auto temp_file_name = s_directory / bfs::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+
+  try {
+    {
+      mm_file_io_c out{temp_file_name.string(), MODE_CREATE};
+      out.write(mtx::json::dump(json));
+    }
+
+    bfs::rename(temp_file_name, entry_name);
+
+    mxdebug_if(s_debug, boost::format("kax_analyzer_cache: stored %1% elements for '%2%' in '%3%'\n") % entry.m_data.size() % entry.m_file_name % entry_name.string());
+
+  } catch (std::exception &ex) {
+    mxdebug_if(s_debug, boost::format("kax_analyzer_cache: writing '%1%' failed: %2%\n") % entry_name.string() % ex.what());
+
+    boost::system::error_code ec;
+    bfs::remove(temp_file_name, ec);
+  }
+}
+
+}}
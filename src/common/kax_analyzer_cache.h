@@ -0,0 +1,55 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for the on-disk cache of analyzed file layouts
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_KAX_ANALYZER_CACHE_H
+#define MTX_COMMON_KAX_ANALYZER_CACHE_H
+
+#include "common/common_pch.h"
+
+#include "common/kax_analyzer.h"
+
+/** \brief Storage for the level 1 element layouts found by \c kax_analyzer_c
+
+   Each analyzed file gets its own entry in the cache directory. The
+   entry's name is derived from the file's absolute path. Entries are
+   only a hint: \c kax_analyzer_c compares the file's size,
+   modification time and segment UID with the entry and verifies a
+   number of element headers before using it.
+
+   The cache is disabled until a directory has been set.
+*/
+namespace mtx { namespace kax_analyzer_cache {
+
+struct entry_t {
+  std::string m_file_name, m_segment_uid;
+  uint64_t m_file_size{}, m_segment_position{};
+  int64_t m_modification_time{};
+  bool m_parsed_fully{};
+  std::vector<kax_analyzer_data_cptr> m_data;
+};
+
+void set_directory(bfs::path const &directory);
+bool is_enabled();
+
+/** \brief Fills in the file name, size and modification time of \c entry
+
+   Returns \c false if the file's status cannot be determined.
+*/
+bool get_file_state(std::string const &file_name, entry_t &entry);
+
+boost::optional<entry_t> load(std::string const &file_name);
+void store(entry_t const &entry);
+
+}}
+
+#endif  // MTX_COMMON_KAX_ANALYZER_CACHE_H
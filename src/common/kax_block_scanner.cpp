@@ -0,0 +1,394 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a lightweight scanner for the blocks in a cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/kax_block_scanner.h"
+
+namespace {
+
+uint32_t const s_id_cluster_timecode = 0xe7;
+uint32_t const s_id_simple_block     = 0xa3;
+uint32_t const s_id_block_group      = 0xa0;
+uint32_t const s_id_block            = 0xa1;
+uint32_t const s_id_block_duration   = 0x9b;
+uint32_t const s_id_reference_block  = 0xfb;
+uint32_t const s_id_codec_state      = 0xa4;
+uint32_t const s_id_discard_padding  = 0x75a2;
+uint32_t const s_id_block_additions  = 0x75a1;
+
+unsigned int const s_lacing_none  = 0;
+unsigned int const s_lacing_xiph  = 1;
+unsigned int const s_lacing_ebml  = 3;
+
+bool
+is_unknown_size(uint64_t size,
+                int length) {
+  return size == ((uint64_t{1} << (7 * length)) - 1);
+}
+
+}
+
+uint64_t const kax_block_scanner_c::max_cluster_size;
+
+kax_block_scanner_c::kax_block_scanner_c()
+  : m_buffer{memory_c::alloc(0)}
+{
+}
+
+void
+kax_block_scanner_c::set_track_filter(std::function<bool(uint64_t)> const &filter) {
+  m_track_filter = filter;
+}
+
+bool
+kax_block_scanner_c::wants_track(uint64_t track_number)
+  const {
+  return !m_track_filter || m_track_filter(track_number);
+}
+
+bool
+kax_block_scanner_c::scan(mm_io_c &in,
+                          uint64_t size) {
+  if (size > max_cluster_size)
+    return false;
+
+  // The buffer is only ever enlarged. Its size is the largest cluster
+  // size seen so far, not the current cluster's size.
+  if (m_buffer->get_size() < size)
+    m_buffer = memory_c::alloc(size);
+
+  m_data_size = size;
+
+  if (in.read(m_buffer->get_buffer(), m_data_size) != m_data_size)
+    return false;
+
+  return scan_buffer();
+}
+
+bool
+kax_block_scanner_c::scan(unsigned char const *data,
+                          std::size_t size) {
+  if (m_buffer->get_size() < size)
+    m_buffer = memory_c::alloc(size);
+
+  m_data_size = size;
+
+  if (size)
+    std::memcpy(m_buffer->get_buffer(), data, size);
+
+  return scan_buffer();
+}
+
+bool
+kax_block_scanner_c::scan_buffer() {
+  m_blocks.clear();
+  m_cluster_timecode = 0;
+
+  auto ptr = m_buffer->get_buffer();
+  auto end = ptr + m_data_size;
+
+  while (ptr < end) {
+    auto id     = uint32_t{};
+    auto size   = uint64_t{};
+    auto length = 0;
+
+    if (   !read_id(ptr, end, id)
+        || !read_size(ptr, end, size, length)
+        || is_unknown_size(size, length)
+        || (size > static_cast<uint64_t>(end - ptr)))
+      return false;
+
+    if (id == s_id_cluster_timecode)
+      m_cluster_timecode = get_uint(ptr, size);
+
+    else if (id == s_id_simple_block) {
+      m_blocks.emplace_back();
+      auto &block = m_blocks.back();
+
+      if (!scan_block(ptr, size, block))
+        return false;
+
+      block.m_simple_block = true;
+
+      if (block.m_frames.empty())
+        m_blocks.pop_back();
+
+    } else if ((id == s_id_block_group) && !scan_block_group(ptr, size))
+      return false;
+
+    ptr += size;
+  }
+
+  return true;
+}
+
+bool
+kax_block_scanner_c::scan_block_group(unsigned char *data,
+                                      std::size_t size) {
+  auto end = data + size;
+
+  // Decode the block first so that BlockGroups for unwanted tracks
+  // can be skipped without looking at their other children.
+  auto found_block = false;
+
+  for (auto pass = 0; pass < 2; ++pass) {
+    auto ptr = data;
+
+    while (ptr < end) {
+      auto child  = ptr;
+      auto id     = uint32_t{};
+      auto csize  = uint64_t{};
+      auto length = 0;
+
+      if (   !read_id(ptr, end, id)
+          || !read_size(ptr, end, csize, length)
+          || is_unknown_size(csize, length)
+          || (csize > static_cast<uint64_t>(end - ptr)))
+        return false;
+
+      if ((0 == pass) && (id == s_id_block)) {
+        m_blocks.emplace_back();
+        if (!scan_block(ptr, csize, m_blocks.back()))
+          return false;
+
+        if (m_blocks.back().m_frames.empty()) {
+          m_blocks.pop_back();
+          return true;
+        }
+
+        found_block = true;
+        break;
+
+      } else if (1 == pass) {
+        auto &block = m_blocks.back();
+
+        if (id == s_id_block_duration)
+          block.m_duration.reset(get_uint(ptr, csize));
+
+        else if (id == s_id_reference_block)
+          block.m_references.push_back(get_int(ptr, csize));
+
+        else if (id == s_id_discard_padding)
+          block.m_discard_padding.reset(get_int(ptr, csize));
+
+        else if (id == s_id_codec_state)
+          block.m_codec_state = std::make_shared<memory_c>(ptr, csize, false);
+
+        else if (id == s_id_block_additions)
+          block.m_block_additions = std::make_shared<memory_c>(child, ptr + csize - child, false);
+      }
+
+      ptr += csize;
+    }
+
+    if (!found_block)
+      return true;
+  }
+
+  return true;
+}
+
+bool
+kax_block_scanner_c::scan_block(unsigned char *data,
+                                std::size_t size,
+                                block_t &block) {
+  auto ptr          = data;
+  auto end          = data + size;
+  auto track_number = uint64_t{};
+  auto length       = 0;
+
+  if (!read_size(ptr, end, track_number, length) || ((end - ptr) < 3))
+    return false;
+
+  if (!wants_track(track_number))
+    return true;
+
+  auto flags            = ptr[2];
+  block.m_track_number  = track_number;
+  block.m_timecode      = static_cast<int16_t>((ptr[0] << 8) | ptr[1]);
+  block.m_keyframe      = (flags & 0x80) == 0x80;
+  block.m_discardable   = (flags & 0x01) == 0x01;
+  ptr                  += 3;
+
+  return split_laced_frames(ptr, end - ptr, (flags >> 1) & 0x03, block);
+}
+
+bool
+kax_block_scanner_c::split_laced_frames(unsigned char *data,
+                                        std::size_t size,
+                                        unsigned int lacing,
+                                        block_t &block) {
+  if (s_lacing_none == lacing) {
+    block.m_frames.emplace_back(std::make_shared<memory_c>(data, size, false));
+    return true;
+  }
+
+  if (!size)
+    return false;
+
+  auto ptr        = data;
+  auto end        = data + size;
+  auto num_frames = static_cast<std::size_t>(*ptr++) + 1;
+  std::vector<uint64_t> sizes;
+  uint64_t total_size = 0;
+
+  sizes.reserve(num_frames);
+
+  if (s_lacing_xiph == lacing) {
+    for (auto idx = 1u; idx < num_frames; ++idx) {
+      auto frame_size = uint64_t{};
+      auto byte       = 0;
+
+      do {
+        if (ptr >= end)
+          return false;
+        byte        = *ptr++;
+        frame_size += byte;
+      } while (byte == 0xff);
+
+      sizes.push_back(frame_size);
+      total_size += frame_size;
+
+      if (total_size > static_cast<uint64_t>(end - ptr))
+        return false;
+    }
+
+  } else if (s_lacing_ebml == lacing) {
+    auto frame_size = uint64_t{};
+    auto length     = 0;
+
+    if ((1 < num_frames) && !read_size(ptr, end, frame_size, length))
+      return false;
+
+    for (auto idx = 1u; idx < num_frames; ++idx) {
+      if (1 < idx) {
+        auto raw_difference = uint64_t{};
+        if (!read_size(ptr, end, raw_difference, length))
+          return false;
+
+        auto difference = static_cast<int64_t>(raw_difference) - ((int64_t{1} << (7 * length - 1)) - 1);
+        if ((static_cast<int64_t>(frame_size) + difference) < 0)
+          return false;
+
+        frame_size += difference;
+      }
+
+      sizes.push_back(frame_size);
+      total_size += frame_size;
+
+      if (total_size > static_cast<uint64_t>(end - ptr))
+        return false;
+    }
+
+  } else {
+    // Fixed-size lacing
+    auto remaining = static_cast<uint64_t>(end - ptr);
+    if (remaining % num_frames)
+      return false;
+
+    sizes.assign(num_frames - 1, remaining / num_frames);
+    total_size = remaining - remaining / num_frames;
+  }
+
+  if (total_size > static_cast<uint64_t>(end - ptr))
+    return false;
+
+  sizes.push_back(static_cast<uint64_t>(end - ptr) - total_size);
+  block.m_frames.reserve(num_frames);
+
+  for (auto frame_size : sizes) {
+    block.m_frames.emplace_back(std::make_shared<memory_c>(ptr, frame_size, false));
+    ptr += frame_size;
+  }
+
+  return true;
+}
+
+bool
+kax_block_scanner_c::read_id(unsigned char *&data,
+                             unsigned char const *end,
+                             uint32_t &id) {
+  if (data >= end)
+    return false;
+
+  auto length = 1;
+  auto mask   = 0x80;
+
+  while ((length <= 4) && !(*data & mask)) {
+    ++length;
+    mask >>= 1;
+  }
+
+  if ((length > 4) || ((end - data) < length))
+    return false;
+
+  id = 0;
+  for (auto idx = 0; idx < length; ++idx)
+    id = (id << 8) | *data++;
+
+  return true;
+}
+
+bool
+kax_block_scanner_c::read_size(unsigned char *&data,
+                               unsigned char const *end,
+                               uint64_t &size,
+                               int &length) {
+  if ((data >= end) || !*data)
+    return false;
+
+  auto mask = 0x80;
+  length    = 1;
+
+  while (!(*data & mask)) {
+    ++length;
+    mask >>= 1;
+  }
+
+  if ((end - data) < length)
+    return false;
+
+  size = *data++ & (mask - 1);
+  for (auto idx = 1; idx < length; ++idx)
+    size = (size << 8) | *data++;
+
+  return true;
+}
+
+uint64_t
+kax_block_scanner_c::get_uint(unsigned char const *data,
+                              std::size_t size) {
+  uint64_t value = 0;
+
+  for (auto idx = 0u; idx < std::min<std::size_t>(size, 8); ++idx)
+    value = (value << 8) | data[idx];
+
+  return value;
+}
+
+int64_t
+kax_block_scanner_c::get_int(unsigned char const *data,
+                             std::size_t size) {
+  if (!size)
+    return 0;
+
+  size       = std::min<std::size_t>(size, 8);
+  auto value = get_uint(data, size);
+
+  // Sign-extend from the element's actual width.
+  if ((size < 8) && (data[0] & 0x80))
+    value |= ~uint64_t{} << (8 * size);
+
+  return static_cast<int64_t>(value);
+}
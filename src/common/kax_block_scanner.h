@@ -0,0 +1,98 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definition of a lightweight scanner for the blocks in a cluster
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_KAX_BLOCK_SCANNER_H
+#define MTX_COMMON_KAX_BLOCK_SCANNER_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/** \brief Decodes the blocks of a cluster without libebml
+
+   The cluster's content is read into a single buffer that is re-used
+   for all clusters. The IDs and sizes of the cluster's children are
+   parsed directly from that buffer. SimpleBlocks and BlockGroups have
+   their headers and their lacing decoded in place. The frames are
+   handed out as \c memory_c objects that point into the buffer and
+   don't own their memory. They're only valid until the next cluster
+   is scanned.
+
+   Blocks for tracks rejected by the track filter are skipped right
+   after their track number has been read.
+
+   Damaged clusters aren't repaired. \c scan() returns \c false
+   instead, and the caller is expected to fall back to libebml which
+   is able to resync.
+*/
+class kax_block_scanner_c {
+public:
+  static uint64_t const max_cluster_size = 256 * 1024 * 1024;
+
+  struct block_t {
+    uint64_t m_track_number{};
+    // Relative to the cluster timecode, not scaled
+    int64_t m_timecode{};
+    // Not scaled; only present in BlockGroups
+    boost::optional<uint64_t> m_duration;
+    boost::optional<int64_t> m_discard_padding;
+    std::vector<int64_t> m_references;
+    std::vector<memory_cptr> m_frames;
+    // The complete BlockAdditions element including its header
+    memory_cptr m_block_additions, m_codec_state;
+    bool m_simple_block{}, m_keyframe{}, m_discardable{};
+  };
+
+protected:
+  memory_cptr m_buffer;
+  std::size_t m_data_size{};
+  uint64_t m_cluster_timecode{};
+  std::vector<block_t> m_blocks;
+  std::function<bool(uint64_t)> m_track_filter;
+
+public:
+  kax_block_scanner_c();
+
+  void set_track_filter(std::function<bool(uint64_t)> const &filter);
+
+  /** \brief Reads \c size bytes of cluster content from \c in and scans them
+
+     \c in must be positioned right after the cluster's ID and size.
+     Returns \c false if the content cannot be read or isn't valid.
+     Clusters larger than \c max_cluster_size are rejected as well.
+  */
+  bool scan(mm_io_c &in, uint64_t size);
+  bool scan(unsigned char const *data, std::size_t size);
+
+  uint64_t get_cluster_timecode() const {
+    return m_cluster_timecode;
+  }
+
+  std::vector<block_t> const &get_blocks() const {
+    return m_blocks;
+  }
+
+protected:
+  bool scan_buffer();
+  bool scan_block_group(unsigned char *data, std::size_t size);
+  bool scan_block(unsigned char *data, std::size_t size, block_t &block);
+  bool split_laced_frames(unsigned char *data, std::size_t size, unsigned int lacing, block_t &block);
+  bool wants_track(uint64_t track_number) const;
+
+  static bool read_id(unsigned char *&data, unsigned char const *end, uint32_t &id);
+  static bool read_size(unsigned char *&data, unsigned char const *end, uint64_t &size, int &length);
+  static uint64_t get_uint(unsigned char const *data, std::size_t size);
+  static int64_t get_int(unsigned char const *data, std::size_t size);
+};
+
+#endif  // MTX_COMMON_KAX_BLOCK_SCANNER_H
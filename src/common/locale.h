@@ -17,6 +17,7 @@
 #include "common/common_pch.h"
 
 #include <iconv.h>
+#include <mutex>
 
 class charset_converter_c;
 using charset_converter_cptr = std::shared_ptr<charset_converter_c>;
@@ -52,6 +53,9 @@ class iconv_charset_converter_c: public charset_converter_c {
 private:
   bool m_is_utf8;
   iconv_t m_to_utf8_handle, m_from_utf8_handle;
+  // The handles keep a conversion state and must not be used by
+  // several threads at the same time.
+  std::mutex m_mutex;
 
 public:
   iconv_charset_converter_c(const std::string &charset);
@@ -26,16 +26,33 @@ memory_c::resize(size_t new_size)
   if (new_size == its_counter->size)
     return;
 
-  if (its_counter->is_free) {
-    its_counter->ptr  = (unsigned char *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
-    its_counter->size = new_size + its_counter->offset;
+  auto total_size = new_size + its_counter->offset;
+
+  if (its_counter->is_free && its_counter->capacity) {
+    // Pooled buffers only have to be replaced if they're too small.
+    if (total_size > its_counter->capacity) {
+      auto capacity = size_t{};
+      auto tmp      = memory_pool_c::allocate(total_size, capacity);
+      memcpy(tmp, its_counter->ptr, std::min(its_counter->size, total_size));
+      memory_pool_c::release(its_counter->ptr, its_counter->capacity);
+
+      its_counter->ptr      = tmp;
+      its_counter->capacity = capacity;
+    }
+
+    its_counter->size = total_size;
+
+  } else if (its_counter->is_free) {
+    its_counter->ptr  = (unsigned char *)saferealloc(its_counter->ptr, total_size);
+    its_counter->size = total_size;
 
   } else {
-    auto tmp = (unsigned char *)safemalloc(new_size);
+    auto tmp = memory_pool_c::allocate(new_size, its_counter->capacity);
     memcpy(tmp, its_counter->ptr + its_counter->offset, std::min(new_size, its_counter->size - its_counter->offset));
     its_counter->ptr     = tmp;
     its_counter->is_free = true;
     its_counter->size    = new_size;
+    its_counter->offset  = 0;
   }
 }
 
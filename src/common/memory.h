@@ -19,6 +19,7 @@
 #include <deque>
 
 #include "common/error.h"
+#include "common/memory_pool.h"
 
 namespace mtx {
   namespace mem {
@@ -95,8 +96,9 @@ public:
   }
 
   explicit memory_c(size_t s)
-    : its_counter(new counter(static_cast<unsigned char *>(safemalloc(s)), s, true))
+    : its_counter(new counter(nullptr, s, true))
   {
+    its_counter->ptr = memory_pool_c::allocate(s, its_counter->capacity);
   }
 
   ~memory_c() {
@@ -154,15 +156,23 @@ public:
     if (!its_counter || its_counter->is_free)
       return;
 
-    its_counter->ptr      = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
-    its_counter->is_free  = true;
-    its_counter->size    -= its_counter->offset;
-    its_counter->offset   = 0;
+    auto size = get_size();
+    auto copy = memory_pool_c::allocate(size, its_counter->capacity);
+    if (size)
+      memcpy(copy, get_buffer(), size);
+
+    its_counter->ptr     = copy;
+    its_counter->is_free = true;
+    its_counter->size    = size;
+    its_counter->offset  = 0;
   }
 
+  // The caller takes ownership of the buffer and must free() it.
   void lock() {
-    if (its_counter)
-      its_counter->is_free = false;
+    if (its_counter) {
+      its_counter->is_free  = false;
+      its_counter->capacity = 0;
+    }
   }
 
   void resize(size_t new_size) throw();
@@ -206,13 +216,20 @@ public:
 public:
   static memory_cptr
   alloc(size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
+    return std::make_shared<memory_c>(size);
   };
 
   static inline memory_cptr
   clone(const void *buffer,
         size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safememdup(buffer, size)), size, true));
+    if (!buffer)
+      return std::make_shared<memory_c>();
+
+    auto mem = alloc(size);
+    if (size)
+      memcpy(mem->get_buffer(), buffer, size);
+
+    return mem;
   }
 
   static inline memory_cptr
@@ -225,6 +242,15 @@ public:
     return std::make_shared<memory_c>(reinterpret_cast<unsigned char *>(&buffer[0]), buffer.length(), false);
   }
 
+  // Returns a view of a part of another buffer without copying. The
+  // view keeps the other buffer alive for as long as it exists itself.
+  static inline memory_cptr
+  slice(memory_cptr const &buffer,
+        size_t offset,
+        size_t size) {
+    return memory_cptr{new memory_c{buffer->get_buffer() + offset, size, false}, [buffer](memory_c *view) { delete view; }};
+  }
+
 private:
   struct counter {
     unsigned char *ptr;
@@ -232,6 +258,7 @@ private:
     bool is_free;
     unsigned count;
     size_t offset;
+    size_t capacity;            // != 0 if ptr belongs to memory_pool_c
 
     counter(unsigned char *p = nullptr,
             size_t s = 0,
@@ -242,6 +269,7 @@ private:
       , is_free(f)
       , count(c)
       , offset(0)
+      , capacity(0)
     { }
   } *its_counter;
 
@@ -255,7 +283,7 @@ private:
     if (its_counter) {
       if (--its_counter->count == 0) {
         if (its_counter->is_free)
-          free(its_counter->ptr);
+          memory_pool_c::release(its_counter->ptr, its_counter->capacity);
         delete its_counter;
       }
       its_counter = 0;
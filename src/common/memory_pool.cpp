@@ -0,0 +1,174 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the size-classed buffer pool used by memory_c
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "common/memory_pool.h"
+
+namespace {
+
+// Limits for the number of released buffers each size class keeps.
+std::size_t const s_max_cached_buffers = 256;
+std::size_t const s_max_cached_bytes   = 4 * 1024 * 1024;
+
+struct size_class_t {
+  std::size_t m_size{}, m_max_cached{};
+  std::vector<unsigned char *> m_free;
+  std::mutex m_mutex;
+};
+
+struct statistics_t {
+  std::atomic<uint64_t> m_allocations{}, m_reused{}, m_allocated_for_pool{}, m_oversized{}, m_returned{}, m_freed{};
+};
+
+class pool_c {
+public:
+  std::vector<size_class_t> m_classes;
+  statistics_t m_statistics;
+
+public:
+  pool_c() {
+    auto num_classes = std::size_t{};
+    for (auto size = memory_pool_c::min_class_size; size <= memory_pool_c::max_class_size; size *= 2)
+      ++num_classes;
+
+    m_classes = std::vector<size_class_t>(num_classes);
+
+    auto size = memory_pool_c::min_class_size;
+    for (auto &size_class : m_classes) {
+      size_class.m_size       = size;
+      size_class.m_max_cached = std::max<std::size_t>(std::min(s_max_cached_buffers, s_max_cached_bytes / size), 1);
+      size                   *= 2;
+    }
+  }
+
+  size_class_t &
+  find_class(std::size_t size) {
+    auto idx = 0u;
+    while (m_classes[idx].m_size < size)
+      ++idx;
+
+    return m_classes[idx];
+  }
+
+  size_class_t *
+  find_class_by_capacity(std::size_t capacity) {
+    for (auto &size_class : m_classes)
+      if (size_class.m_size == capacity)
+        return &size_class;
+
+    return nullptr;
+  }
+};
+
+pool_c &
+get_pool() {
+  // The pool is never destroyed. Buffers may be released during the
+  // destruction of global objects which can happen after a static
+  // pool would have been destroyed already.
+  static auto s_pool = new pool_c;
+
+  return *s_pool;
+}
+
+}
+
+std::size_t const memory_pool_c::min_class_size;
+std::size_t const memory_pool_c::max_class_size;
+
+unsigned char *
+memory_pool_c::allocate(std::size_t size,
+                        std::size_t &capacity) {
+  auto &pool = get_pool();
+
+  ++pool.m_statistics.m_allocations;
+
+  if (size > max_class_size) {
+    ++pool.m_statistics.m_oversized;
+    capacity = 0;
+    return safemalloc(size);
+  }
+
+  auto &size_class = pool.find_class(size);
+  capacity         = size_class.m_size;
+
+  {
+    std::lock_guard<std::mutex> lock{size_class.m_mutex};
+
+    if (!size_class.m_free.empty()) {
+      auto buffer = size_class.m_free.back();
+      size_class.m_free.pop_back();
+      ++pool.m_statistics.m_reused;
+
+      return buffer;
+    }
+  }
+
+  ++pool.m_statistics.m_allocated_for_pool;
+
+  return safemalloc(capacity);
+}
+
+void
+memory_pool_c::release(unsigned char *buffer,
+                       std::size_t capacity) {
+  if (!buffer)
+    return;
+
+  auto &pool      = get_pool();
+  auto size_class = capacity ? pool.find_class_by_capacity(capacity) : nullptr;
+
+  if (size_class) {
+    std::lock_guard<std::mutex> lock{size_class->m_mutex};
+
+    if (size_class->m_free.size() < size_class->m_max_cached) {
+      size_class->m_free.push_back(buffer);
+      ++pool.m_statistics.m_returned;
+
+      return;
+    }
+  }
+
+  ++pool.m_statistics.m_freed;
+  free(buffer);
+}
+
+void
+memory_pool_c::dump_statistics() {
+  static debugging_option_c s_debug{"memory_pool"};
+
+  if (!s_debug)
+    return;
+
+  auto &pool       = get_pool();
+  auto &stats      = pool.m_statistics;
+  auto allocations = stats.m_allocations.load();
+  auto reused      = stats.m_reused.load();
+  auto oversized   = stats.m_oversized.load();
+  auto mallocs     = stats.m_allocated_for_pool.load() + oversized;
+  auto hit_rate    = allocations ? 100.0 * reused / allocations : 0.0;
+
+  mxdebug(boost::format("memory pool: %1% allocations, %2% served from the pool (%|3$.1f|%%), %4% malloc() calls (%5% for buffers larger than %6% bytes); "
+                        "%7% buffers returned to the pool, %8% freed\n")
+          % allocations % reused % hit_rate % mallocs % oversized % max_class_size % stats.m_returned.load() % stats.m_freed.load());
+
+  for (auto &size_class : pool.m_classes) {
+    std::lock_guard<std::mutex> lock{size_class.m_mutex};
+
+    if (!size_class.m_free.empty())
+      mxdebug(boost::format("memory pool:   size class %1%: %2% buffers cached\n") % size_class.m_size % size_class.m_free.size());
+  }
+}
@@ -0,0 +1,53 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definition of the size-classed buffer pool used by memory_c
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MEMORY_POOL_H
+#define MTX_COMMON_MEMORY_POOL_H
+
+#include "common/common_pch.h"
+
+/** \brief Recycles packet buffers instead of returning them to the heap
+
+   Buffers are grouped into size classes that are powers of two from
+   64 bytes up to 2 MB. Each class keeps a limited number of released
+   buffers around and hands them out again on the next request for
+   that class. Larger requests are passed through to \c malloc.
+
+   Every buffer is allocated individually with \c malloc. A pooled
+   buffer can therefore still be handed to code that calls \c free or
+   \c realloc on it as long as it isn't released to the pool as well.
+
+   All functions are thread-safe. Statistics are output on exit if
+   the debugging option \c memory_pool is active.
+*/
+class memory_pool_c {
+public:
+  static std::size_t const min_class_size = 64;
+  static std::size_t const max_class_size = 2 * 1024 * 1024;
+
+public:
+  /** \brief Allocates a buffer of at least \c size bytes
+
+     \c capacity is set to the buffer's actual size if it belongs to
+     a size class and to 0 if it was allocated outside of the pool.
+     The caller has to pass the same value to \c release().
+  */
+  static unsigned char *allocate(std::size_t size, std::size_t &capacity);
+
+  /** \brief Returns a buffer obtained from \c allocate() */
+  static void release(unsigned char *buffer, std::size_t capacity);
+
+  static void dump_statistics();
+};
+
+#endif  // MTX_COMMON_MEMORY_POOL_H
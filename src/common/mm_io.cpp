@@ -22,6 +22,9 @@
 #endif
 #include <sys/stat.h>
 #include <sys/types.h>
+#if !defined(SYS_WINDOWS)
+# include <fcntl.h>
+#endif
 
 #include "common/endian.h"
 #include "common/error.h"
@@ -30,6 +33,7 @@
 #include "common/mm_io_x.h"
 #include "common/strings/editing.h"
 #include "common/strings/parsing.h"
+#include "common/text_scanning.h"
 
 union double_to_uint64_t {
   uint64_t i;
@@ -135,6 +139,42 @@ mm_file_io_c::truncate(int64_t pos) {
   return ftruncate(fileno((FILE *)m_file), pos);
 }
 
+uint64_t
+mm_file_io_c::get_insert_range_alignment() {
+#if defined(FALLOC_FL_INSERT_RANGE)
+  struct stat st;
+  if ((0 == fstat(fileno((FILE *)m_file), &st)) && (0 < st.st_blksize))
+    return st.st_blksize;
+#endif
+
+  return 0;
+}
+
+bool
+mm_file_io_c::insert_range(uint64_t position,
+                           uint64_t size) {
+#if defined(FALLOC_FL_INSERT_RANGE)
+  if (fflush((FILE *)m_file) != 0)
+    return false;
+
+  if (fallocate(fileno((FILE *)m_file), FALLOC_FL_INSERT_RANGE, position, size) != 0)
+    return false;
+
+  m_cached_size = -1;
+
+  // Anything stdio has read ahead is stale now.
+  setFilePointer(m_current_position);
+
+  return true;
+
+#else
+  (void)position;
+  (void)size;
+
+  return false;
+#endif
+}
+
 /** \brief OS and kernel dependant setup
 */
 void
@@ -431,6 +471,24 @@ mm_io_c::read_mp4_descriptor_len() {
   return len;
 }
 
+/** \brief Reads \c size bytes without copying them if possible
+
+   I/O classes that hold the file's content in memory anyway return a
+   view into that memory instead of a copy. Such a view is not owned
+   by the returned object; it stays valid as long as the I/O object
+   itself. All other classes read the data into a new buffer.
+
+   A view must not be modified. Callers that want to modify the data
+   have to call \c memory_c::grab() first.
+
+   Throws \c mtx::mm_io::end_of_file_x if fewer than \c size bytes are
+   available.
+*/
+memory_cptr
+mm_io_c::read_view(size_t size) {
+  return read(size);
+}
+
 uint32_t
 mm_io_c::read(memory_cptr &buffer,
               size_t size,
@@ -658,6 +716,13 @@ mm_proxy_io_c::_write(const void *buffer,
   return m_proxy_io->write(buffer, size);
 }
 
+bool
+mm_proxy_io_c::insert_range(uint64_t position,
+                            uint64_t size) {
+  m_cached_size = -1;
+  return m_proxy_io->insert_range(position, size);
+}
+
 /*
    Dummy class for output to /dev/null. Needed for two pass stuff.
 */
@@ -887,6 +952,8 @@ mm_mem_io_c::get_content()
    Class for handling UTF-8/UTF-16/UTF-32 text files.
 */
 
+std::size_t const mm_text_io_c::ms_buffer_size;
+
 mm_text_io_c::mm_text_io_c(mm_io_c *in,
                            bool delete_in)
   : mm_proxy_io_c(in, delete_in)
@@ -895,6 +962,9 @@ mm_text_io_c::mm_text_io_c(mm_io_c *in,
   , m_uses_carriage_returns(false)
   , m_uses_newlines(false)
   , m_eol_style_detected(false)
+  , m_buffer_start(0)
+  , m_buffer_pos(0)
+  , m_buffer_fill(0)
 {
   in->setFilePointer(0, seek_beginning);
 
@@ -1066,6 +1136,110 @@ mm_text_io_c::getline(boost::optional<std::size_t> max_chars) {
   if (!m_eol_style_detected)
     detect_eol_style();
 
+  if (!can_read_lines_from_buffer(max_chars))
+    return read_line_by_chars(max_chars);
+
+  std::string line;
+  read_line_from_buffer(line);
+
+  return line;
+}
+
+bool
+mm_text_io_c::getline2(std::string &s,
+                       boost::optional<std::size_t> max_chars) {
+  if (!can_read_lines_from_buffer(max_chars))
+    return mm_io_c::getline2(s, max_chars);
+
+  // Filling the caller's string directly lets it re-use its memory
+  // for the next line.
+  try {
+    if (eof())
+      return false;
+
+    if (!m_eol_style_detected)
+      detect_eol_style();
+
+    read_line_from_buffer(s);
+
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
+bool
+mm_text_io_c::can_read_lines_from_buffer(boost::optional<std::size_t> const &max_chars)
+  const {
+  return !max_chars && ((BO_NONE == m_byte_order) || (BO_UTF8 == m_byte_order));
+}
+
+/** \brief Reads a line directly from the read-ahead buffer
+
+   Only used for files that don't need to be converted to UTF-8
+   first. The line breaks are searched for in the buffer in large
+   blocks instead of reading the file character by character. Line
+   breaks are handled exactly like in \c read_line_by_chars.
+*/
+void
+mm_text_io_c::read_line_from_buffer(std::string &line) {
+  auto previous_was_carriage_return = false;
+
+  line.clear();
+
+  while ((m_buffer_pos < m_buffer_fill) || fill_buffer()) {
+    auto buffer = m_buffer->get_buffer();
+
+    if (previous_was_carriage_return) {
+      auto c = buffer[m_buffer_pos];
+
+      if ('\n' == c) {
+        ++m_buffer_pos;
+        break;
+      }
+
+      if (('\r' != c) || !m_uses_newlines)
+        break;
+
+      ++m_buffer_pos;
+      continue;
+    }
+
+    auto start      = buffer + m_buffer_pos;
+    auto end        = buffer + m_buffer_fill;
+    auto line_break = mtx::text::find_line_break(start, end);
+
+    line.append(reinterpret_cast<char const *>(start), line_break - start);
+    m_buffer_pos = line_break - buffer;
+
+    if (line_break == end)
+      continue;
+
+    ++m_buffer_pos;
+
+    if ('\r' == *line_break)
+      previous_was_carriage_return = true;
+
+    else if (!m_uses_carriage_returns)
+      break;
+
+    else
+      line += '\n';
+  }
+
+  if (BO_UTF8 != m_byte_order)
+    return;
+
+  auto begin   = reinterpret_cast<unsigned char const *>(line.data());
+  auto invalid = mtx::text::find_invalid_utf8_lead_byte(begin, begin + line.length());
+
+  if (invalid != (begin + line.length()))
+    throw mtx::mm_io::text::invalid_utf8_char_x(*invalid);
+}
+
+std::string
+mm_text_io_c::read_line_by_chars(boost::optional<std::size_t> max_chars) {
   std::string s;
   char utf8char[9];
   bool previous_was_carriage_return = false;
@@ -1105,10 +1279,94 @@ mm_text_io_c::getline(boost::optional<std::size_t> max_chars) {
   }
 }
 
+bool
+mm_text_io_c::fill_buffer() {
+  if (!m_buffer)
+    m_buffer = memory_c::alloc(ms_buffer_size);
+
+  m_buffer_start = m_proxy_io->getFilePointer();
+  m_buffer_pos   = 0;
+  m_buffer_fill  = m_proxy_io->read(m_buffer->get_buffer(), ms_buffer_size);
+
+  return 0 < m_buffer_fill;
+}
+
+uint32
+mm_text_io_c::_read(void *buffer,
+                    size_t size) {
+  auto dest       = static_cast<unsigned char *>(buffer);
+  auto num_copied = std::min<std::size_t>(size, m_buffer_fill - m_buffer_pos);
+
+  if (num_copied) {
+    std::memcpy(dest, m_buffer->get_buffer() + m_buffer_pos, num_copied);
+    m_buffer_pos += num_copied;
+  }
+
+  if (num_copied == size)
+    return size;
+
+  // The buffer has been used up completely. Large reads bypass it.
+  if ((size - num_copied) >= ms_buffer_size) {
+    m_buffer_pos = m_buffer_fill = 0;
+    return num_copied + m_proxy_io->read(dest + num_copied, size - num_copied);
+  }
+
+  if (!fill_buffer())
+    return num_copied;
+
+  auto num_remaining  = std::min<std::size_t>(size - num_copied, m_buffer_fill);
+  std::memcpy(dest + num_copied, m_buffer->get_buffer(), num_remaining);
+  m_buffer_pos        = num_remaining;
+
+  return num_copied + num_remaining;
+}
+
+size_t
+mm_text_io_c::_write(const void *buffer,
+                     size_t size) {
+  // The proxied file is positioned after the data read ahead.
+  if (m_buffer_fill) {
+    auto position = m_buffer_start + m_buffer_pos;
+    m_buffer_pos  = m_buffer_fill = 0;
+    m_proxy_io->setFilePointer(position);
+  }
+
+  return mm_proxy_io_c::_write(buffer, size);
+}
+
+uint64
+mm_text_io_c::getFilePointer() {
+  return m_buffer_fill ? m_buffer_start + m_buffer_pos : m_proxy_io->getFilePointer();
+}
+
+bool
+mm_text_io_c::eof() {
+  return (m_buffer_pos >= m_buffer_fill) && m_proxy_io->eof();
+}
+
 void
 mm_text_io_c::setFilePointer(int64 offset,
                              seek_mode mode) {
-  mm_proxy_io_c::setFilePointer(((0 == offset) && (seek_beginning == mode)) ? m_bom_len : offset, mode);
+  if ((0 == offset) && (seek_beginning == mode))
+    offset = m_bom_len;
+
+  if (m_buffer_fill && (seek_end != mode)) {
+    auto target = seek_beginning == mode ? offset : static_cast<int64_t>(m_buffer_start + m_buffer_pos) + offset;
+
+    // Seeking within the data read ahead, e.g. when rewinding a small
+    // file after probing it, doesn't require reading it again.
+    if ((target >= static_cast<int64_t>(m_buffer_start)) && (target <= static_cast<int64_t>(m_buffer_start + m_buffer_fill))) {
+      m_buffer_pos = target - m_buffer_start;
+      return;
+    }
+
+    offset = target;
+    mode   = seek_beginning;
+  }
+
+  mm_proxy_io_c::setFilePointer(offset, mode);
+
+  m_buffer_pos = m_buffer_fill = 0;
 }
 
 /*
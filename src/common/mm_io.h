@@ -52,6 +52,7 @@ public:
   virtual uint32 read(void *buffer, size_t size);
   virtual uint32_t read(std::string &buffer, size_t size, size_t offset = 0);
   virtual uint32_t read(memory_cptr &buffer, size_t size, int offset = 0);
+  virtual memory_cptr read_view(size_t size);
   virtual unsigned char read_uint8();
   virtual uint16_t read_uint16_le();
   virtual uint32_t read_uint24_le();
@@ -84,6 +85,17 @@ public:
     return 0;
   }
 
+  // Inserting space in the middle of a file without rewriting the data
+  // after it is only supported by some file systems. The position and
+  // the size must be multiples of get_insert_range_alignment(), which
+  // is 0 if inserting isn't supported at all.
+  virtual uint64_t get_insert_range_alignment() {
+    return 0;
+  }
+  virtual bool insert_range(uint64_t, uint64_t) {
+    return false;
+  }
+
   virtual std::string get_file_name() const = 0;
 
   virtual std::string getline(boost::optional<std::size_t> max_chars = boost::none);
@@ -149,6 +161,10 @@ public:
   }
 
   virtual int truncate(int64_t pos);
+#if !defined(SYS_WINDOWS)
+  virtual uint64_t get_insert_range_alignment();
+  virtual bool insert_range(uint64_t position, uint64_t size);
+#endif
 
   static void setup();
   static void cleanup();
@@ -195,6 +211,10 @@ public:
   virtual mm_io_c *get_proxied() const {
     return m_proxy_io;
   }
+  virtual uint64_t get_insert_range_alignment() {
+    return m_proxy_io->get_insert_range_alignment();
+  }
+  virtual bool insert_range(uint64_t position, uint64_t size);
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
@@ -268,11 +288,22 @@ protected:
   unsigned int m_bom_len;
   bool m_uses_carriage_returns, m_uses_newlines, m_eol_style_detected;
 
+  // Data read ahead from the proxied file. m_buffer_start is the
+  // position of the buffer's first byte in the file.
+  memory_cptr m_buffer;
+  uint64_t m_buffer_start;
+  std::size_t m_buffer_pos, m_buffer_fill;
+
+  static std::size_t const ms_buffer_size = 128 * 1024;
+
 public:
   mm_text_io_c(mm_io_c *in, bool delete_in = true);
 
   virtual void setFilePointer(int64 offset, seek_mode mode=seek_beginning);
+  virtual uint64 getFilePointer();
+  virtual bool eof();
   virtual std::string getline(boost::optional<std::size_t> max_chars = boost::none);
+  virtual bool getline2(std::string &s, boost::optional<std::size_t> max_chars = boost::none);
   virtual int read_next_char(char *buffer);
   virtual byte_order_e get_byte_order() const {
     return m_byte_order;
@@ -286,6 +317,13 @@ public:
 
 protected:
   virtual void detect_eol_style();
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  bool fill_buffer();
+  bool can_read_lines_from_buffer(boost::optional<std::size_t> const &max_chars) const;
+  void read_line_from_buffer(std::string &line);
+  std::string read_line_by_chars(boost::optional<std::size_t> max_chars);
 
 public:
   static bool has_byte_order_marker(const std::string &string);
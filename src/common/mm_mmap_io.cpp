@@ -0,0 +1,240 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+
+# include "common/locale.h"
+# include "common/mm_io_x.h"
+# include "common/mm_mmap_io.h"
+
+namespace {
+
+// How far ahead of the current position pages are requested while
+// the file is read sequentially.
+uint64_t const s_readahead_size = 8 * 1024 * 1024;
+
+// Thresholds for the access pattern score: each sequential read
+// increases it, each jump decreases it.
+int const s_sequential_threshold = 4;
+int const s_random_threshold     = -8;
+int const s_max_score            = 16;
+
+}
+
+mm_mmap_io_c::mm_mmap_io_c(std::string const &file_name)
+  : m_file_name{file_name}
+  , m_mapping{}
+  , m_size{}
+  , m_pos{}
+  , m_eof{}
+  , m_last_read_end{}
+  , m_readahead_end{}
+  , m_access_score{}
+  , m_advice{advice_e::normal}
+  , m_debug{"mmap_io"}
+{
+  auto fd = ::open(g_cc_local_utf8->native(file_name).c_str(), O_RDONLY);
+  if (-1 == fd)
+    throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  struct stat st;
+  if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode)) {
+    auto error = mtx::mm_io::make_error_code();
+    ::close(fd);
+    throw mtx::mm_io::open_x{error};
+  }
+
+  m_size = st.st_size;
+
+  if (m_size) {
+    // The mapping is read-only. Users of read_view() must copy the
+    // data before modifying it.
+    auto mapping = static_cast<uint64_t>(m_size) <= std::numeric_limits<size_t>::max() ? mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if (MAP_FAILED == mapping) {
+      auto error = mtx::mm_io::make_error_code();
+      ::close(fd);
+      throw mtx::mm_io::open_x{error};
+    }
+
+    m_mapping = static_cast<unsigned char *>(mapping);
+  }
+
+  ::close(fd);
+
+  mxdebug_if(m_debug, boost::format("mapped %1% with %2% bytes\n") % m_file_name % m_size);
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+mm_io_cptr
+mm_mmap_io_c::open(std::string const &file_name) {
+  try {
+    return std::make_shared<mm_mmap_io_c>(file_name);
+
+  } catch (mtx::mm_io::exception &) {
+    return {};
+  }
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_pos;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? static_cast<int64_t>(m_size) + offset // offsets from the end are negative already
+    :                          static_cast<int64_t>(m_pos)  + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  m_pos = std::min<uint64_t>(new_pos, m_size);
+  m_eof = false;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_mmap_io_c::clear_eof() {
+  m_eof = false;
+}
+
+void
+mm_mmap_io_c::close() {
+  if (m_mapping)
+    munmap(m_mapping, m_size);
+
+  m_mapping = nullptr;
+  m_size    = 0;
+  m_pos     = 0;
+}
+
+std::string
+mm_mmap_io_c::get_file_name()
+  const {
+  return m_file_name;
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  auto num_read = std::min<uint64_t>(size, m_size - m_pos);
+
+  if (num_read) {
+    advise_access(m_pos, num_read);
+    std::memcpy(buffer, m_mapping + m_pos, num_read);
+    m_pos += num_read;
+  }
+
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+memory_cptr
+mm_mmap_io_c::read_view(size_t size) {
+  if ((m_size - m_pos) < size) {
+    m_pos = m_size;
+    m_eof = true;
+    throw mtx::mm_io::end_of_file_x{};
+  }
+
+  advise_access(m_pos, size);
+
+  auto view  = std::make_shared<memory_c>(m_mapping + m_pos, size, false);
+  m_pos     += size;
+
+  return view;
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+void
+mm_mmap_io_c::advise(advice_e advice,
+                     uint64_t position,
+                     uint64_t size) {
+  static auto s_page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+  auto start = position - (position % s_page_size);
+  auto end   = std::min(position + size, m_size);
+
+  if (end <= start)
+    return;
+
+  auto flag = advice_e::sequential == advice ? MADV_SEQUENTIAL
+            : advice_e::random     == advice ? MADV_RANDOM
+            : advice_e::willneed   == advice ? MADV_WILLNEED
+            :                                  MADV_NORMAL;
+
+  madvise(m_mapping + start, end - start, flag);
+}
+
+void
+mm_mmap_io_c::advise_access(uint64_t position,
+                            size_t size) {
+  auto sequential = position == m_last_read_end;
+  m_last_read_end = position + size;
+  m_access_score  = std::max(std::min(m_access_score + (sequential ? 1 : -1), s_max_score), -s_max_score);
+
+  auto advice = m_access_score >= s_sequential_threshold ? advice_e::sequential
+              : m_access_score <= s_random_threshold     ? advice_e::random
+              :                                            m_advice;
+
+  if (advice != m_advice) {
+    mxdebug_if(m_debug, boost::format("%1%: switching to %2% access at %3%\n") % m_file_name % (advice_e::sequential == advice ? "sequential" : "random") % position);
+
+    m_advice        = advice;
+    m_readahead_end = 0;
+    this->advise(advice, 0, m_size);
+  }
+
+  // Request the pages ahead of the current position once half of the
+  // previously requested window has been consumed.
+  if (   (advice_e::sequential == m_advice)
+      && ((m_last_read_end + s_readahead_size / 2) >= m_readahead_end)
+      && (m_readahead_end < m_size)) {
+    auto start      = std::max(m_last_read_end, m_readahead_end);
+    m_readahead_end = m_last_read_end + s_readahead_size;
+    this->advise(advice_e::willneed, start, m_readahead_end - start);
+  }
+}
+
+#endif  // !defined(SYS_WINDOWS)
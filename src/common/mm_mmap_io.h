@@ -0,0 +1,83 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_MMAP_IO_H
+#define MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+#if !defined(SYS_WINDOWS)
+
+/** \brief Read-only access to a file mapped into memory
+
+   Reading copies directly from the mapping; no intermediate buffers
+   are involved. \c read_view() doesn't copy at all but returns a
+   read-only view into the mapping.
+
+   Accessing the mapping after the file has been truncated by another
+   process raises SIGBUS. Therefore only the readers that benefit the
+   most from it use this class.
+
+   The kernel is advised about the access pattern: as long as the file
+   is read sequentially the pages following the current position are
+   requested ahead of time. If the reader jumps around a lot then
+   readahead is turned off for the whole mapping.
+*/
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  std::string m_file_name;
+  unsigned char *m_mapping;
+  uint64_t m_size, m_pos;
+  bool m_eof;
+
+  enum class advice_e {
+    normal,
+    sequential,
+    random,
+    willneed,
+  };
+
+  uint64_t m_last_read_end, m_readahead_end;
+  int m_access_score;
+  advice_e m_advice;
+  debugging_option_c m_debug;
+
+public:
+  mm_mmap_io_c(std::string const &file_name);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual int64_t get_size();
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual void close();
+  virtual std::string get_file_name() const;
+
+  virtual memory_cptr read_view(size_t size);
+
+  static mm_io_cptr open(std::string const &file_name);
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  void advise_access(uint64_t position, size_t size);
+  void advise(advice_e advice, uint64_t position, uint64_t size);
+};
+
+#endif  // !defined(SYS_WINDOWS)
+
+#endif  // MTX_COMMON_MM_MMAP_IO_H
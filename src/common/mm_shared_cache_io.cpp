@@ -0,0 +1,165 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_shared_cache_io.h"
+
+mm_shared_cache_io_c::cache_c::cache_c(mm_io_c &source,
+                                       std::size_t chunk_size)
+  : m_source(source)
+  , m_size{source.get_size()}
+  , m_chunk_size{chunk_size}
+  , m_cancelled{}
+{
+}
+
+memory_cptr
+mm_shared_cache_io_c::cache_c::get_chunk(uint64_t idx) {
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  auto itr = m_chunks.find(idx);
+  if (itr != m_chunks.end())
+    return itr->second;
+
+  if (m_cancelled)
+    return {};
+
+  auto position = idx * m_chunk_size;
+  auto size     = std::min<int64_t>(m_chunk_size, m_size - position);
+  auto chunk    = memory_c::alloc(size);
+
+  m_source.setFilePointer(position);
+  chunk->set_size(m_source.read(chunk->get_buffer(), size));
+
+  m_chunks[idx] = chunk;
+
+  return chunk;
+}
+
+std::size_t
+mm_shared_cache_io_c::cache_c::get_chunk_size()
+  const {
+  return m_chunk_size;
+}
+
+int64_t
+mm_shared_cache_io_c::cache_c::get_size()
+  const {
+  return m_size;
+}
+
+std::string
+mm_shared_cache_io_c::cache_c::get_file_name()
+  const {
+  return m_source.get_file_name();
+}
+
+void
+mm_shared_cache_io_c::cache_c::cancel() {
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_cancelled = true;
+}
+
+// ------------------------------------------------------------
+
+mm_shared_cache_io_c::mm_shared_cache_io_c(cache_cptr const &cache)
+  : m_cache{cache}
+  , m_pos{}
+  , m_eof{}
+{
+}
+
+uint64
+mm_shared_cache_io_c::getFilePointer() {
+  return m_pos;
+}
+
+void
+mm_shared_cache_io_c::setFilePointer(int64 offset,
+                                     seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_cache->get_size() + offset // offsets from the end are negative already
+    :                          m_pos               + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  // Same behavior as a buffered file: seeking beyond the end positions
+  // at the end.
+  m_pos = std::min(new_pos, m_cache->get_size());
+  m_eof = false;
+}
+
+int64_t
+mm_shared_cache_io_c::get_size() {
+  return m_cache->get_size();
+}
+
+bool
+mm_shared_cache_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_shared_cache_io_c::clear_eof() {
+  m_eof = false;
+}
+
+void
+mm_shared_cache_io_c::close() {
+}
+
+std::string
+mm_shared_cache_io_c::get_file_name()
+  const {
+  return m_cache->get_file_name();
+}
+
+uint32
+mm_shared_cache_io_c::_read(void *buffer,
+                            size_t size) {
+  auto dest       = static_cast<unsigned char *>(buffer);
+  auto chunk_size = m_cache->get_chunk_size();
+  auto num_read   = 0u;
+
+  while (size && (m_pos < m_cache->get_size())) {
+    auto chunk  = m_cache->get_chunk(m_pos / chunk_size);
+    auto offset = static_cast<std::size_t>(m_pos % chunk_size);
+
+    if (!chunk || (chunk->get_size() <= offset))
+      break;
+
+    auto to_copy = std::min(size, chunk->get_size() - offset);
+    std::memcpy(dest, chunk->get_buffer() + offset, to_copy);
+
+    dest     += to_copy;
+    size     -= to_copy;
+    m_pos    += to_copy;
+    num_read += to_copy;
+  }
+
+  if (size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_shared_cache_io_c::_write(const void *,
+                             size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
@@ -0,0 +1,82 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_SHARED_CACHE_IO_H
+#define MTX_COMMON_MM_SHARED_CACHE_IO_H
+
+#include "common/common_pch.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "common/mm_io.h"
+
+/** \brief Read-only access to a file through a cache shared by several readers
+
+   Several instances of this class can read from the same source file
+   concurrently, e.g. on different threads. Each instance has its own
+   file position. The source is read in chunks only once no matter
+   how many instances access the same data; all chunks read are kept
+   in memory for the lifetime of the cache.
+
+   Once the cache has been cancelled all reads that cannot be served
+   from chunks already in memory behave as if the end of the file had
+   been reached.
+*/
+class mm_shared_cache_io_c: public mm_io_c {
+public:
+  class cache_c {
+  protected:
+    mm_io_c &m_source;
+    int64_t m_size;
+    std::size_t m_chunk_size;
+    bool m_cancelled;
+    std::unordered_map<uint64_t, memory_cptr> m_chunks;
+    std::mutex m_mutex;
+
+  public:
+    cache_c(mm_io_c &source, std::size_t chunk_size = 1 << 17);
+
+    memory_cptr get_chunk(uint64_t idx);
+    std::size_t get_chunk_size() const;
+    int64_t get_size() const;
+    std::string get_file_name() const;
+    void cancel();
+  };
+
+  using cache_cptr = std::shared_ptr<cache_c>;
+
+protected:
+  cache_cptr m_cache;
+  int64_t m_pos;
+  bool m_eof;
+
+public:
+  mm_shared_cache_io_c(cache_cptr const &cache);
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual int64_t get_size();
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual void close();
+  virtual std::string get_file_name() const;
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+};
+
+using mm_shared_cache_io_cptr = std::shared_ptr<mm_shared_cache_io_c>;
+
+#endif // MTX_COMMON_MM_SHARED_CACHE_IO_H
@@ -19,7 +19,8 @@
 
 mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
                                            size_t buffer_size,
-                                           bool delete_out)
+                                           bool delete_out,
+                                           bool write_behind)
   : mm_proxy_io_c(out, delete_out)
   , m_af_buffer(memory_c::alloc(buffer_size))
   , m_buffer(m_af_buffer->get_buffer())
@@ -27,6 +28,8 @@ mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
   , m_size(buffer_size)
   , m_debug_seek{ "write_buffer_io|write_buffer_io_read"}
   , m_debug_write{"write_buffer_io|write_buffer_io_write"}
+  , m_write_behind{write_behind}
+  , m_pending_end_position{}
 {
 }
 
@@ -36,18 +39,25 @@ mm_write_buffer_io_c::~mm_write_buffer_io_c() {
 
 mm_io_cptr
 mm_write_buffer_io_c::open(const std::string &file_name,
-                           size_t buffer_size) {
-  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size));
+                           size_t buffer_size,
+                           bool write_behind) {
+  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size, true, write_behind));
 }
 
 uint64
 mm_write_buffer_io_c::getFilePointer() {
-  return mm_proxy_io_c::getFilePointer() + m_fill;
+  // The proxied file's position is updated by the background thread
+  // while a write is pending.
+  auto position = m_pending_write.valid() ? m_pending_end_position : mm_proxy_io_c::getFilePointer();
+  return position + m_fill;
 }
 
 void
 mm_write_buffer_io_c::setFilePointer(int64 offset,
                                      seek_mode mode) {
+  if (seek_end == mode)
+    wait_for_pending_write();
+
   int64_t new_pos
     = seek_beginning == mode ? offset
     : seek_end       == mode ? m_proxy_io->get_size() + offset // offsets from the end are negative already
@@ -78,6 +88,19 @@ mm_write_buffer_io_c::close() {
   mm_proxy_io_c::close();
 }
 
+bool
+mm_write_buffer_io_c::insert_range(uint64_t position,
+                                   uint64_t size) {
+  flush_buffer();
+  return mm_proxy_io_c::insert_range(position, size);
+}
+
+bool
+mm_write_buffer_io_c::eof() {
+  wait_for_pending_write();
+  return mm_proxy_io_c::eof();
+}
+
 uint32
 mm_write_buffer_io_c::_read(void *buffer,
                             size_t size) {
@@ -94,7 +117,17 @@ mm_write_buffer_io_c::_write(const void *buffer,
 
   // whole blocks
   while (remain >= (avail = m_size - m_fill)) {
-    if (m_fill) {
+    if (m_write_behind) {
+      // The caller's buffer cannot be written in the background as
+      // it may be reused as soon as this function returns. Always
+      // go through our own buffers.
+      memcpy(m_buffer + m_fill, buf, avail);
+      m_fill = m_size;
+      flush_buffer_in_background();
+      remain -= avail;
+      buf    += avail;
+
+    } else if (m_fill) {
       // Fill the buffer in an attempt to defeat potentially
       // lousy OS I/O scheduling
       memcpy(m_buffer + m_fill, buf, avail);
@@ -126,6 +159,8 @@ mm_write_buffer_io_c::_write(const void *buffer,
 
 void
 mm_write_buffer_io_c::flush_buffer() {
+  wait_for_pending_write();
+
   if (!m_fill)
     return;
 
@@ -139,7 +174,51 @@ mm_write_buffer_io_c::flush_buffer() {
     throw mtx::mm_io::insufficient_space_x();
 }
 
+void
+mm_write_buffer_io_c::flush_buffer_in_background() {
+  wait_for_pending_write();
+
+  if (!m_fill)
+    return;
+
+  if (!m_af_pending_buffer)
+    m_af_pending_buffer = memory_c::alloc(m_size);
+
+  std::swap(m_af_buffer, m_af_pending_buffer);
+
+  auto out               = m_proxy_io;
+  auto pending_buffer    = m_af_pending_buffer->get_buffer();
+  auto fill              = m_fill;
+  auto start_position    = mm_proxy_io_c::getFilePointer();
+  m_buffer               = m_af_buffer->get_buffer();
+  m_fill                 = 0;
+  m_pending_end_position = start_position + fill;
+  m_cached_size          = -1;
+
+  mxdebug_if(m_debug_write, boost::format("flush_buffer_in_background() at %1% for %2%\n") % start_position % fill);
+
+  m_pending_write = std::async(std::launch::async, [out, pending_buffer, fill]() {
+    if (out->write(pending_buffer, fill) != fill)
+      throw mtx::mm_io::insufficient_space_x();
+  });
+}
+
+void
+mm_write_buffer_io_c::wait_for_pending_write() {
+  if (!m_pending_write.valid())
+    return;
+
+  // get() re-throws exceptions that occurred in the background
+  // thread, e.g. if the disk is full.
+  m_pending_write.get();
+}
+
 void
 mm_write_buffer_io_c::discard_buffer() {
+  try {
+    wait_for_pending_write();
+  } catch (mtx::mm_io::exception &) {
+  }
+
   m_fill = 0;
 }
@@ -17,6 +17,8 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+
 #include "common/mm_io.h"
 
 class mm_write_buffer_io_c: public mm_proxy_io_c {
@@ -27,22 +29,34 @@ protected:
   const size_t m_size;
   debugging_option_c m_debug_seek, m_debug_write;
 
+  // Write-behind mode: full buffers are handed over to a background
+  // thread that writes them to the proxied file while the caller
+  // continues filling the other buffer.
+  bool m_write_behind;
+  memory_cptr m_af_pending_buffer;
+  uint64_t m_pending_end_position;
+  std::future<void> m_pending_write;
+
 public:
-  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true);
+  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true, bool write_behind = false);
   virtual ~mm_write_buffer_io_c();
 
   virtual uint64 getFilePointer();
   virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
   virtual void flush();
   virtual void close();
+  virtual bool eof();
   virtual void discard_buffer();
+  virtual bool insert_range(uint64_t position, uint64_t size);
 
-  static mm_io_cptr open(const std::string &file_name, size_t buffer_size);
+  static mm_io_cptr open(const std::string &file_name, size_t buffer_size, bool write_behind = false);
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
   virtual void flush_buffer();
+  virtual void flush_buffer_in_background();
+  virtual void wait_for_pending_write();
 };
 using mm_write_buffer_io_cptr = std::shared_ptr<mm_write_buffer_io_c>;
 
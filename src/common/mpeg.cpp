@@ -12,55 +12,228 @@
 
 #include "common/common_pch.h"
 
+#include "common/cpu_features.h"
 #include "common/debugging.h"
 #include "common/endian.h"
 #include "common/mpeg.h"
 
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#endif
+
 namespace mtx { namespace mpeg {
 
+namespace {
+
+/* The following functions find the first position p in [begin, end)
+   at which p[0] and p[1] are zero bytes and p[2] is a byte in the
+   range [Lo, Hi]. They return end if there is no such position. This
+   covers both start codes (00 00 01) and the sequences that
+   emulation prevention deals with (00 00 00..03).
+*/
+
+template<unsigned char Lo, unsigned char Hi>
+unsigned char const *
+find_zeros_followed_by_scalar(unsigned char const *begin,
+                              unsigned char const *end) {
+  auto p = begin;
+
+  // Look at the third byte of each candidate position first. If it
+  // isn't zero then neither of the next two positions can match.
+  while ((p + 3) <= end) {
+    auto third = p[2];
+
+    if ((static_cast<unsigned char>(third - Lo) <= (Hi - Lo)) && !p[0] && !p[1])
+      return p;
+
+    p += third ? 3 : 1;
+  }
+
+  return end;
+}
+
+#if defined(MTX_CPU_X86)
+
+template<unsigned char Lo, unsigned char Hi>
+__attribute__((target("sse2")))
+unsigned char const *
+find_zeros_followed_by_sse2(unsigned char const *begin,
+                            unsigned char const *end) {
+  auto p     = begin;
+  auto zero  = _mm_setzero_si128();
+  auto lo    = _mm_set1_epi8(Lo);
+  auto range = _mm_set1_epi8(Hi - Lo);
+
+  // Compare 16 candidate positions at once; each one needs two
+  // further bytes to be present.
+  while ((p + 16 + 2) <= end) {
+    auto b0    = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)),     zero);
+    auto b1    = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p + 1)), zero);
+    auto third = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p + 2)), lo);
+    auto b2    = Lo == Hi ? _mm_cmpeq_epi8(third, zero) : _mm_cmpeq_epi8(_mm_min_epu8(third, range), third);
+    auto mask  = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(b0, b1), b2)));
+
+    if (mask)
+      return p + __builtin_ctz(mask);
+
+    p += 16;
+  }
+
+  return find_zeros_followed_by_scalar<Lo, Hi>(p, end);
+}
+
+template<unsigned char Lo, unsigned char Hi>
+__attribute__((target("avx2")))
+unsigned char const *
+find_zeros_followed_by_avx2(unsigned char const *begin,
+                            unsigned char const *end) {
+  auto p     = begin;
+  auto zero  = _mm256_setzero_si256();
+  auto lo    = _mm256_set1_epi8(Lo);
+  auto range = _mm256_set1_epi8(Hi - Lo);
+
+  while ((p + 32 + 2) <= end) {
+    auto b0    = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)),     zero);
+    auto b1    = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + 1)), zero);
+    auto third = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + 2)), lo);
+    auto b2    = Lo == Hi ? _mm256_cmpeq_epi8(third, zero) : _mm256_cmpeq_epi8(_mm256_min_epu8(third, range), third);
+    auto mask  = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(b0, b1), b2)));
+
+    if (mask)
+      return p + __builtin_ctz(mask);
+
+    p += 32;
+  }
+
+  return find_zeros_followed_by_sse2<Lo, Hi>(p, end);
+}
+
+#endif  // MTX_CPU_X86
+
+template<unsigned char Lo, unsigned char Hi>
+unsigned char const *
+find_zeros_followed_by(unsigned char const *begin,
+                       unsigned char const *end) {
+#if defined(MTX_CPU_X86)
+  if (mtx::cpu::has_avx2())
+    return find_zeros_followed_by_avx2<Lo, Hi>(begin, end);
+
+  if (mtx::cpu::has_sse2())
+    return find_zeros_followed_by_sse2<Lo, Hi>(begin, end);
+#endif
+
+  return find_zeros_followed_by_scalar<Lo, Hi>(begin, end);
+}
+
+}
+
+/** \brief Finds the next \c 00 00 01 start code in a buffer
+
+   Returns a pointer to the first of the three start code bytes or \c
+   end if the buffer does not contain a complete start code. The
+   implementation is chosen once depending on the CPU's capabilities.
+*/
+unsigned char const *
+find_start_code(unsigned char const *begin,
+                unsigned char const *end) {
+  return find_zeros_followed_by<1, 1>(begin, end);
+}
+
+/** \brief Removes the emulation prevention bytes from a NALU
+
+   Each \c 00 00 03 sequence is replaced by \c 00 00. The result is
+   written to \c dest which is enlarged if it is too small to hold
+   it. \c dest is never shrunk so that it can be reused for
+   converting further NALUs without having to reallocate memory.
+
+   Returns the number of bytes written to \c dest.
+*/
+std::size_t
+nalu_to_rbsp(unsigned char const *buffer,
+             std::size_t size,
+             memory_c &dest) {
+  if (dest.get_size() < size)
+    dest.resize(size);
+
+  auto src = buffer;
+  auto end = buffer + size;
+  auto out = dest.get_buffer();
+
+  while (true) {
+    auto sequence = find_zeros_followed_by<3, 3>(src, end);
+    if (sequence == end)
+      break;
+
+    // Copy up to and including the two zero bytes, skip the 03.
+    std::memcpy(out, src, sequence + 2 - src);
+    out += sequence + 2 - src;
+    src  = sequence + 3;
+  }
+
+  if (src < end) {
+    std::memcpy(out, src, end - src);
+    out += end - src;
+  }
+
+  return out - dest.get_buffer();
+}
+
+/** \brief Inserts emulation prevention bytes into a RBSP
+
+   Inserts a \c 03 after each pair of zero bytes that is followed by
+   a byte in the range \c 00..03. The result is written to \c dest in
+   the same manner as by \c nalu_to_rbsp.
+
+   Returns the number of bytes written to \c dest.
+*/
+std::size_t
+rbsp_to_nalu(unsigned char const *buffer,
+             std::size_t size,
+             memory_c &dest) {
+  // At most one byte is inserted for every two source bytes.
+  auto max_size = size + size / 2 + 1;
+  if (dest.get_size() < max_size)
+    dest.resize(max_size);
+
+  auto src = buffer;
+  auto end = buffer + size;
+  auto out = dest.get_buffer();
+
+  while (true) {
+    auto sequence = find_zeros_followed_by<0, 3>(src, end);
+    if (sequence == end)
+      break;
+
+    // Copy up to and including the two zero bytes and insert the 03.
+    // The following byte may start the next sequence.
+    std::memcpy(out, src, sequence + 2 - src);
+    out    += sequence + 2 - src;
+    *out++  = 3;
+    src     = sequence + 2;
+  }
+
+  if (src < end) {
+    std::memcpy(out, src, end - src);
+    out += end - src;
+  }
+
+  return out - dest.get_buffer();
+}
+
 memory_cptr
 nalu_to_rbsp(memory_cptr const &buffer) {
-  int pos, size = buffer->get_size();
-  mm_mem_io_c d(nullptr, size, 100);
-  unsigned char *b = buffer->get_buffer();
-
-  for (pos = 0; pos < size; ++pos) {
-    if (   ((pos + 2) < size)
-        && (0 == b[pos])
-        && (0 == b[pos + 1])
-        && (3 == b[pos + 2])) {
-      d.write_uint8(0);
-      d.write_uint8(0);
-      pos += 2;
-
-    } else
-      d.write_uint8(b[pos]);
-  }
+  auto rbsp = memory_c::alloc(buffer->get_size());
+  rbsp->set_size(nalu_to_rbsp(buffer->get_buffer(), buffer->get_size(), *rbsp));
 
-  return std::make_shared<memory_c>(d.get_and_lock_buffer(), d.getFilePointer(), true);
+  return rbsp;
 }
 
 memory_cptr
 rbsp_to_nalu(memory_cptr const &buffer) {
-  int pos, size = buffer->get_size();
-  mm_mem_io_c d(nullptr, size, 100);
-  unsigned char *b = buffer->get_buffer();
-
-  for (pos = 0; pos < size; ++pos) {
-    if (   ((pos + 2) < size)
-        && (0 == b[pos])
-        && (0 == b[pos + 1])
-        && (3 >= b[pos + 2])) {
-      d.write_uint8(0);
-      d.write_uint8(0);
-      d.write_uint8(3);
-      ++pos;
-
-    } else
-      d.write_uint8(b[pos]);
-  }
+  auto nalu = memory_c::alloc(buffer->get_size() + buffer->get_size() / 2 + 1);
+  nalu->set_size(rbsp_to_nalu(buffer->get_buffer(), buffer->get_size(), *nalu));
 
-  return std::make_shared<memory_c>(d.get_and_lock_buffer(), d.getFilePointer(), true);
+  return nalu;
 }
 
 void
@@ -41,8 +41,12 @@ public:
   }
 };
 
+unsigned char const *find_start_code(unsigned char const *begin, unsigned char const *end);
+
 memory_cptr nalu_to_rbsp(memory_cptr const &buffer);
 memory_cptr rbsp_to_nalu(memory_cptr const &buffer);
+std::size_t nalu_to_rbsp(unsigned char const *buffer, std::size_t size, memory_c &dest);
+std::size_t rbsp_to_nalu(unsigned char const *buffer, std::size_t size, memory_c &dest);
 
 void write_nalu_size(unsigned char *buffer, std::size_t size, std::size_t nalu_size_length, bool ignore_nalu_size_length_errors = false);
 memory_cptr create_nalu_with_size(memory_cptr const &src, std::size_t nalu_size_length, std::vector<memory_cptr> extra_data);
@@ -930,65 +930,63 @@ mpeg4::p10::avc_es_parser_c::discard_actual_frames(bool discard) {
 void
 mpeg4::p10::avc_es_parser_c::add_bytes(unsigned char *buffer,
                                        size_t size) {
-  memory_slice_cursor_c cursor;
-  int marker_size              = 0;
-  int previous_marker_size     = 0;
-  int previous_pos             = -1;
-  uint64_t previous_parsed_pos = m_parsed_position;
-
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
+  auto previous_parsed_pos = m_parsed_position;
+  m_stream_position       += size;
+
+  // Scan a contiguous buffer: either the new data alone or the new
+  // data appended to what's left over from the previous call.
+  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size())) {
+    m_unparsed_buffer->add(buffer, size);
+    buffer = m_unparsed_buffer->get_buffer();
+    size   = m_unparsed_buffer->get_size();
+  }
 
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          auto nalu = memory_c::alloc(new_size);
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          m_parsed_position = previous_parsed_pos + previous_pos;
-
-          mtx::mpeg::remove_trailing_zero_bytes(*nalu);
-          if (nalu->get_size())
-            handle_nalu(nalu, m_parsed_position);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
+  auto end                  = buffer + size;
+  auto scan_pos             = static_cast<unsigned char const *>(buffer);
+  auto previous_marker_size = 0;
+  unsigned char const *previous_marker{};
 
-      if (!cursor.char_available())
-        break;
+  while (true) {
+    auto marker = mtx::mpeg::find_start_code(scan_pos, end);
+    if (marker == end)
+      break;
+
+    scan_pos         = marker + 3;
+    auto marker_size = 3;
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+    if ((marker > buffer) && !marker[-1]) {
+      --marker;
+      marker_size = 4;
     }
+
+    if (previous_marker) {
+      auto nalu_start = previous_marker + previous_marker_size;
+      auto nalu       = memory_c::clone(nalu_start, marker - nalu_start);
+      m_parsed_position = previous_parsed_pos + (previous_marker - buffer);
+
+      mtx::mpeg::remove_trailing_zero_bytes(*nalu);
+      if (nalu->get_size())
+        handle_nalu(nalu, m_parsed_position);
+    }
+
+    previous_marker      = marker;
+    previous_marker_size = marker_size;
   }
 
-  if (-1 == previous_pos)
-    previous_pos = 0;
+  auto previous_pos = previous_marker ? previous_marker - buffer : 0;
+  m_parsed_position = previous_parsed_pos + previous_pos;
 
-  m_stream_position += size;
-  m_parsed_position  = previous_parsed_pos + previous_pos;
+  auto new_size = size - previous_pos;
+  if (0 == new_size)
+    m_unparsed_buffer.reset();
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    m_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
+  else if (m_unparsed_buffer && (m_unparsed_buffer->get_buffer() == buffer)) {
+    if (previous_pos)
+      memmove(buffer, buffer + previous_pos, new_size);
+    m_unparsed_buffer->resize(new_size);
 
   } else
-    m_unparsed_buffer.reset();
+    m_unparsed_buffer = memory_c::clone(buffer + previous_pos, new_size);
 }
 
 void
@@ -1096,7 +1094,8 @@ mpeg4::p10::avc_es_parser_c::handle_slice_nalu(memory_cptr const &nalu,
   }
 
   slice_info_t si;
-  if (!parse_slice(mtx::mpeg::nalu_to_rbsp(nalu), si))
+  auto rbsp_size = mtx::mpeg::nalu_to_rbsp(nalu->get_buffer(), nalu->get_size(), m_rbsp_buffer);
+  if (!parse_slice(m_rbsp_buffer.get_buffer(), rbsp_size, si))
     return;
 
   if (NALU_TYPE_IDR_SLICE == si.nalu_type)
@@ -1261,9 +1260,9 @@ mpeg4::p10::avc_es_parser_c::handle_sei_nalu(memory_cptr const &nalu) {
   try {
     ++m_stats.num_sei_nalus;
 
-    auto nalu_as_rbsp = mtx::mpeg::nalu_to_rbsp(nalu);
+    auto rbsp_size = mtx::mpeg::nalu_to_rbsp(nalu->get_buffer(), nalu->get_size(), m_rbsp_buffer);
 
-    bit_reader_c r(nalu_as_rbsp->get_buffer(), nalu_as_rbsp->get_size());
+    bit_reader_c r(m_rbsp_buffer.get_buffer(), rbsp_size);
 
     r.skip_bits(8);
 
@@ -1350,10 +1349,11 @@ mpeg4::p10::avc_es_parser_c::handle_nalu(memory_cptr const &nalu,
 }
 
 bool
-mpeg4::p10::avc_es_parser_c::parse_slice(memory_cptr const &buffer,
+mpeg4::p10::avc_es_parser_c::parse_slice(unsigned char const *buffer,
+                                         std::size_t size,
                                          slice_info_t &si) {
   try {
-    bit_reader_c r(buffer->get_buffer(), buffer->get_size());
+    bit_reader_c r(buffer, size);
 
     memset(&si, 0, sizeof(si));
 
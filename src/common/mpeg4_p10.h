@@ -247,6 +247,7 @@ protected:
   std::vector<pps_info_t> m_pps_info_list;
 
   memory_cptr m_unparsed_buffer;
+  memory_c m_rbsp_buffer;
   uint64_t m_stream_position, m_parsed_position;
 
   avc_frame_t m_incomplete_frame;
@@ -387,7 +388,7 @@ public:
   std::pair<int64_t, int64_t> const get_display_dimensions(int width = -1, int height = -1) const;
 
 protected:
-  bool parse_slice(memory_cptr const &buffer, slice_info_t &si);
+  bool parse_slice(unsigned char const *buffer, std::size_t size, slice_info_t &si);
   void handle_sps_nalu(memory_cptr const &nalu);
   void handle_pps_nalu(memory_cptr const &nalu);
   void handle_sei_nalu(memory_cptr const &nalu);
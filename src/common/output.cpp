@@ -14,6 +14,7 @@
 #include "common/common_pch.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <mutex>
 #include <sstream>
 
 #include "common/command_line.h"
@@ -108,6 +109,10 @@ mxmsg(unsigned int level,
   static debugging_option_c s_timestamped_messages{"timestamped_messages"};
   static debugging_option_c s_memory_usage_in_messages{"memory_usage_in_messages"};
   static bool s_saw_cr_after_nl = false;
+  static std::recursive_mutex s_mutex;
+
+  // Messages may be output from mkvmerge's reader threads, too.
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
 
   if (g_suppress_info && (MXMSG_INFO == level))
     return;
@@ -29,7 +29,7 @@ using namespace libebml;
 using mxmsg_handler_t = std::function<void(unsigned int level, std::string const &)>;
 void set_mxmsg_handler(unsigned int level, mxmsg_handler_t const &handler);
 
-extern bool g_suppress_info, g_suppress_warnings;
+extern bool g_suppress_info, g_suppress_warnings, g_warning_issued;
 extern std::string g_stdio_charset;
 extern charset_converter_cptr g_cc_stdio;
 extern std::shared_ptr<mm_io_c> g_mm_stdio;
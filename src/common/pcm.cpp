@@ -0,0 +1,174 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   repacking PCM samples
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/cpu_features.h"
+#include "common/pcm.h"
+
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#endif
+
+namespace mtx { namespace pcm {
+
+namespace {
+
+// All implementations take the index of the first frame to process
+// and return the index of the first frame they haven't processed.
+// Frame n is read from buffer + n * input_frame_size and written to
+// buffer + n * output_frame_size.
+
+std::size_t
+remove_trailing_channels_generic(unsigned char *buffer,
+                                 std::size_t first_frame,
+                                 std::size_t num_frames,
+                                 std::size_t input_frame_size,
+                                 std::size_t output_frame_size) {
+  for (auto frame = first_frame; frame < num_frames; ++frame)
+    std::memmove(&buffer[frame * output_frame_size], &buffer[frame * input_frame_size], output_frame_size);
+
+  return num_frames;
+}
+
+// With the frame sizes known at compile time each frame is copied
+// with three possibly overlapping 64-bit loads and stores. All of them
+// are loaded before storing, so the frames may overlap as well.
+template<std::size_t input_frame_size, std::size_t output_frame_size>
+std::size_t
+remove_trailing_channels_fixed(unsigned char *buffer,
+                               std::size_t first_frame,
+                               std::size_t num_frames) {
+  static_assert((8 <= output_frame_size) && (24 >= output_frame_size), "unsupported frame size");
+
+  std::size_t const second_offset = std::min<std::size_t>(8, output_frame_size - 8);
+  std::size_t const third_offset  = output_frame_size - 8;
+
+  for (auto frame = first_frame; frame < num_frames; ++frame) {
+    auto src = &buffer[frame * input_frame_size];
+    auto dst = &buffer[frame * output_frame_size];
+    uint64_t first, second, third;
+
+    std::memcpy(&first,  src,                 8);
+    std::memcpy(&second, src + second_offset, 8);
+    std::memcpy(&third,  src + third_offset,  8);
+    std::memcpy(dst,                 &first,  8);
+    std::memcpy(dst + second_offset, &second, 8);
+    std::memcpy(dst + third_offset,  &third,  8);
+  }
+
+  return num_frames;
+}
+
+#if defined(MTX_CPU_X86)
+
+/* Handles frames of up to 16 bytes. Each iteration loads as many
+   complete frames as fit into 16 bytes, moves the kept channels
+   together with a shuffle and stores all 16 bytes. The bytes after
+   the kept ones are garbage; they're overwritten by the next
+   iteration. This is only safe once the read position is at least 16
+   bytes ahead of the write position. The frames before that point are
+   handled by the caller.
+*/
+__attribute__((target("ssse3")))
+std::size_t
+remove_trailing_channels_ssse3(unsigned char *buffer,
+                               std::size_t first_frame,
+                               std::size_t num_frames,
+                               std::size_t input_frame_size,
+                               std::size_t output_frame_size) {
+  auto frames_per_vector = 16 / input_frame_size;
+
+  alignas(16) unsigned char mask_bytes[16];
+  std::memset(mask_bytes, 0x80, 16);
+
+  for (auto frame = 0u; frame < frames_per_vector; ++frame)
+    for (auto byte = 0u; byte < output_frame_size; ++byte)
+      mask_bytes[frame * output_frame_size + byte] = frame * input_frame_size + byte;
+
+  auto mask  = _mm_load_si128(reinterpret_cast<__m128i const *>(mask_bytes));
+  auto frame = first_frame;
+
+  // The last load must not read beyond the last complete frame.
+  while (((frame * input_frame_size) + 16) <= (num_frames * input_frame_size)) {
+    auto data = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&buffer[frame * input_frame_size]));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&buffer[frame * output_frame_size]), _mm_shuffle_epi8(data, mask));
+
+    frame += frames_per_vector;
+  }
+
+  return frame;
+}
+
+#endif  // MTX_CPU_X86
+
+}
+
+/** \brief Removes the last channels from each frame of interleaved PCM samples
+
+   Each frame consists of \c num_input_channels samples of \c
+   bytes_per_channel bytes each. Only the first \c num_output_channels
+   samples of each frame are kept. The samples are moved to the front
+   of \c buffer in place. An incomplete frame at the end of the buffer
+   is dropped.
+
+   This is used for Blu-ray PCM which always contains an even number
+   of channels; for an odd number of channels the last one is padding.
+
+   Returns the number of bytes remaining in the buffer.
+*/
+std::size_t
+remove_trailing_channels(unsigned char *buffer,
+                         std::size_t num_bytes,
+                         std::size_t bytes_per_channel,
+                         std::size_t num_input_channels,
+                         std::size_t num_output_channels) {
+  auto input_frame_size  = bytes_per_channel * num_input_channels;
+  auto output_frame_size = bytes_per_channel * std::min(num_input_channels, num_output_channels);
+
+  if (!input_frame_size)
+    return 0;
+
+  auto num_frames = num_bytes / input_frame_size;
+  auto frame      = std::size_t{};
+
+  if (input_frame_size == output_frame_size)
+    return num_frames * output_frame_size;
+
+#if defined(MTX_CPU_X86)
+  if ((input_frame_size <= 16) && mtx::cpu::has_ssse3()) {
+    // Handle the first frames one by one until the read position is
+    // far enough ahead of the write position.
+    auto removed_per_frame = input_frame_size - output_frame_size;
+    frame                  = std::min((16 + removed_per_frame - 1) / removed_per_frame, num_frames);
+
+    remove_trailing_channels_generic(buffer, 0, frame, input_frame_size, output_frame_size);
+    frame = remove_trailing_channels_ssse3(buffer, frame, num_frames, input_frame_size, output_frame_size);
+  }
+#endif
+
+  // The layouts of Blu-ray PCM with 5 and 7 channels with 24 bits per
+  // sample.
+  if ((18 == input_frame_size) && (15 == output_frame_size))
+    remove_trailing_channels_fixed<18, 15>(buffer, frame, num_frames);
+
+  else if ((24 == input_frame_size) && (21 == output_frame_size))
+    remove_trailing_channels_fixed<24, 21>(buffer, frame, num_frames);
+
+  else
+    remove_trailing_channels_generic(buffer, frame, num_frames, input_frame_size, output_frame_size);
+
+  return num_frames * output_frame_size;
+}
+
+}}
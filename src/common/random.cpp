@@ -13,6 +13,8 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
+
 #if !defined(SYS_WINDOWS)
 # include <sys/time.h>
 # include <time.h>
@@ -24,6 +26,7 @@
 #include "common/random.h"
 
 bool random_c::m_seeded = false;
+static std::mutex s_mutex;
 
 #if defined(SYS_WINDOWS)
 
@@ -33,6 +36,8 @@ bool random_c::m_use_uuidcreate   = false;
 void
 random_c::generate_bytes(void *destination,
                          size_t num_bytes) {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
   UUID uuid;
 
   if (!m_seeded) {
@@ -93,6 +98,8 @@ bool random_c::m_tried_dev_urandom = false;
 void
 random_c::generate_bytes(void *destination,
                          size_t num_bytes) {
+  std::lock_guard<std::mutex> lock{s_mutex};
+
   try {
     if (!m_tried_dev_urandom) {
       m_tried_dev_urandom = true;
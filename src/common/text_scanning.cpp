@@ -0,0 +1,243 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   fast scanning of text buffers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/cpu_features.h"
+#include "common/text_scanning.h"
+
+#if defined(MTX_CPU_X86)
+# include <immintrin.h>
+#endif
+
+namespace mtx { namespace text {
+
+namespace {
+
+/* Returns the length of the UTF-8 sequence started by the lead byte
+   c or 0 if c cannot start a sequence. Only the lead byte is looked
+   at; this matches what mm_text_io_c has always accepted.
+*/
+inline unsigned int
+get_utf8_sequence_length(unsigned char c) {
+  return (c & 0x80) == 0x00 ? 1
+       : (c & 0xe0) == 0xc0 ? 2
+       : (c & 0xf0) == 0xe0 ? 3
+       : (c & 0xf8) == 0xf0 ? 4
+       : (c & 0xfc) == 0xf8 ? 5
+       : (c & 0xfe) == 0xfc ? 6
+       :                      0;
+}
+
+unsigned char const *
+find_line_break_scalar(unsigned char const *begin,
+                       unsigned char const *end) {
+  for (auto p = begin; p < end; ++p)
+    if ((*p == '\n') || (*p == '\r'))
+      return p;
+
+  return end;
+}
+
+/* Skips the non-ASCII sequence starting at p. Returns nullptr if p
+   doesn't point to a valid lead byte. Sequences truncated by the end
+   of the buffer are not an error.
+*/
+inline unsigned char const *
+skip_utf8_sequence(unsigned char const *p,
+                   unsigned char const *end) {
+  auto length = get_utf8_sequence_length(*p);
+  if (!length)
+    return nullptr;
+
+  return p + std::min<std::size_t>(length, end - p);
+}
+
+unsigned char const *
+find_invalid_utf8_lead_byte_scalar(unsigned char const *begin,
+                                   unsigned char const *end) {
+  auto p = begin;
+
+  while (p < end) {
+    // Check eight bytes at once for being plain ASCII.
+    while ((p + 8) <= end) {
+      uint64_t chunk;
+      std::memcpy(&chunk, p, 8);
+      if (chunk & 0x8080808080808080ull)
+        break;
+      p += 8;
+    }
+
+    if (p >= end)
+      break;
+
+    if (*p < 0x80) {
+      ++p;
+      continue;
+    }
+
+    auto next = skip_utf8_sequence(p, end);
+    if (!next)
+      return p;
+
+    p = next;
+  }
+
+  return end;
+}
+
+#if defined(MTX_CPU_X86)
+
+__attribute__((target("sse2")))
+unsigned char const *
+find_line_break_sse2(unsigned char const *begin,
+                     unsigned char const *end) {
+  auto p  = begin;
+  auto lf = _mm_set1_epi8('\n');
+  auto cr = _mm_set1_epi8('\r');
+
+  while ((p + 16) <= end) {
+    auto data = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(data, lf), _mm_cmpeq_epi8(data, cr))));
+
+    if (mask)
+      return p + __builtin_ctz(mask);
+
+    p += 16;
+  }
+
+  return find_line_break_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+unsigned char const *
+find_line_break_avx2(unsigned char const *begin,
+                     unsigned char const *end) {
+  auto p  = begin;
+  auto lf = _mm256_set1_epi8('\n');
+  auto cr = _mm256_set1_epi8('\r');
+
+  while ((p + 32) <= end) {
+    auto data = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+    auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(data, lf), _mm256_cmpeq_epi8(data, cr))));
+
+    if (mask)
+      return p + __builtin_ctz(mask);
+
+    p += 32;
+  }
+
+  return find_line_break_sse2(p, end);
+}
+
+// The movemask of the raw bytes has a bit set for each byte with its
+// high bit set, i.e. for each byte that isn't plain ASCII. Runs of
+// ASCII are skipped 16 or 32 bytes at a time; only the non-ASCII
+// sequences are looked at individually.
+
+__attribute__((target("sse2")))
+unsigned char const *
+find_invalid_utf8_lead_byte_sse2(unsigned char const *begin,
+                                 unsigned char const *end) {
+  auto p = begin;
+
+  while ((p + 16) <= end) {
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p))));
+
+    if (!mask) {
+      p += 16;
+      continue;
+    }
+
+    p         += __builtin_ctz(mask);
+    auto next  = skip_utf8_sequence(p, end);
+    if (!next)
+      return p;
+
+    p = next;
+  }
+
+  return find_invalid_utf8_lead_byte_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+unsigned char const *
+find_invalid_utf8_lead_byte_avx2(unsigned char const *begin,
+                                 unsigned char const *end) {
+  auto p = begin;
+
+  while ((p + 32) <= end) {
+    auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p))));
+
+    if (!mask) {
+      p += 32;
+      continue;
+    }
+
+    p         += __builtin_ctz(mask);
+    auto next  = skip_utf8_sequence(p, end);
+    if (!next)
+      return p;
+
+    p = next;
+  }
+
+  return find_invalid_utf8_lead_byte_sse2(p, end);
+}
+
+#endif  // MTX_CPU_X86
+
+}
+
+/** \brief Finds the next carriage return or line feed in a buffer
+
+   Returns a pointer to the first \c \\r or \c \\n character or \c end
+   if the buffer contains neither.
+*/
+unsigned char const *
+find_line_break(unsigned char const *begin,
+                unsigned char const *end) {
+#if defined(MTX_CPU_X86)
+  if (mtx::cpu::has_avx2())
+    return find_line_break_avx2(begin, end);
+
+  if (mtx::cpu::has_sse2())
+    return find_line_break_sse2(begin, end);
+#endif
+
+  return find_line_break_scalar(begin, end);
+}
+
+/** \brief Finds the first byte in a UTF-8 buffer that cannot start a character
+
+   Each character's lead byte must announce a sequence of one to six
+   bytes. The continuation bytes are skipped without being checked,
+   and a sequence cut off by the end of the buffer is not an error.
+
+   Returns a pointer to the offending byte or \c end if there is none.
+*/
+unsigned char const *
+find_invalid_utf8_lead_byte(unsigned char const *begin,
+                            unsigned char const *end) {
+#if defined(MTX_CPU_X86)
+  if (mtx::cpu::has_avx2())
+    return find_invalid_utf8_lead_byte_avx2(begin, end);
+
+  if (mtx::cpu::has_sse2())
+    return find_invalid_utf8_lead_byte_sse2(begin, end);
+#endif
+
+  return find_invalid_utf8_lead_byte_scalar(begin, end);
+}
+
+}}
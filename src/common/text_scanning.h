@@ -0,0 +1,26 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for fast scanning of text buffers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_TEXT_SCANNING_H
+#define MTX_COMMON_TEXT_SCANNING_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace text {
+
+unsigned char const *find_line_break(unsigned char const *begin, unsigned char const *end);
+unsigned char const *find_invalid_utf8_lead_byte(unsigned char const *begin, unsigned char const *end);
+
+}}
+
+#endif  // MTX_COMMON_TEXT_SCANNING_H
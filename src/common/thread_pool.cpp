@@ -0,0 +1,78 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a simple thread pool
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/thread_pool.h"
+
+thread_pool_c::thread_pool_c(unsigned int num_threads)
+  : m_stop{}
+{
+  for (auto idx = 0u; idx < std::max(num_threads, 1u); ++idx)
+    m_threads.emplace_back([this]() { run(); });
+}
+
+thread_pool_c::~thread_pool_c() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_job_available.notify_all();
+
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+unsigned int
+thread_pool_c::get_num_threads()
+  const {
+  return m_threads.size();
+}
+
+std::future<void>
+thread_pool_c::submit(std::function<void()> job) {
+  std::packaged_task<void()> task{std::move(job)};
+  auto future = task.get_future();
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_jobs.emplace_back(std::move(task));
+  }
+
+  m_job_available.notify_one();
+
+  return future;
+}
+
+void
+thread_pool_c::run() {
+  while (true) {
+    std::packaged_task<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_job_available.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+      // Jobs still queued at this point are finished before the
+      // threads exit so that nobody waits for a future forever.
+      if (m_jobs.empty())
+        return;
+
+      task = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    task();
+  }
+}
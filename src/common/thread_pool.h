@@ -0,0 +1,54 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definition of a simple thread pool
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_THREAD_POOL_H
+#define MTX_COMMON_THREAD_POOL_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/** \brief A fixed number of threads executing jobs in submission order
+
+   Jobs are started in the order they're submitted, but as several of
+   them run concurrently they may finish in any order. Callers that
+   need the results in order have to wait for the returned futures in
+   order. Exceptions thrown by a job are stored in its future.
+*/
+class thread_pool_c {
+protected:
+  std::vector<std::thread> m_threads;
+  std::deque<std::packaged_task<void()>> m_jobs;
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  bool m_stop;
+
+public:
+  thread_pool_c(unsigned int num_threads);
+  ~thread_pool_c();
+
+  std::future<void> submit(std::function<void()> job);
+  unsigned int get_num_threads() const;
+
+protected:
+  void run();
+};
+
+using thread_pool_cptr = std::shared_ptr<thread_pool_c>;
+
+#endif  // MTX_COMMON_THREAD_POOL_H
@@ -13,6 +13,8 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
+
 #include "common/container.h"
 #include "common/hacks.h"
 #include "common/random.h"
@@ -20,6 +22,8 @@
 
 static std::vector<uint64_t> s_random_unique_numbers[4];
 static std::unordered_map<unique_id_category_e, bool, mtx::hash<unique_id_category_e>> s_ignore_unique_numbers;
+// mkvpropedit's batch mode creates attachment UIDs from several threads.
+static std::recursive_mutex s_mutex;
 
 static void
 assert_valid_category(unique_id_category_e category) {
@@ -28,6 +32,8 @@ assert_valid_category(unique_id_category_e category) {
 
 void
 clear_list_of_unique_numbers(unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert((UNIQUE_ALL_IDS <= category) && (UNIQUE_ATTACHMENT_IDS >= category));
 
   if (UNIQUE_ALL_IDS == category) {
@@ -41,6 +47,8 @@ clear_list_of_unique_numbers(unique_id_category_e category) {
 bool
 is_unique_number(uint64_t number,
                  unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert_valid_category(category);
 
   if (s_ignore_unique_numbers[category])
@@ -56,6 +64,8 @@ is_unique_number(uint64_t number,
 void
 add_unique_number(uint64_t number,
                   unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert_valid_category(category);
 
   if (hack_engaged(ENGAGE_NO_VARIABLE_DATA))
@@ -67,6 +77,8 @@ add_unique_number(uint64_t number,
 void
 remove_unique_number(uint64_t number,
                      unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert_valid_category(category);
 
   boost::remove_erase_if(s_random_unique_numbers[category], [=](uint64_t stored_number) { return number == stored_number; });
@@ -74,6 +86,8 @@ remove_unique_number(uint64_t number,
 
 uint64_t
 create_unique_number(unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert_valid_category(category);
 
   if (hack_engaged(ENGAGE_NO_VARIABLE_DATA)) {
@@ -92,6 +106,8 @@ create_unique_number(unique_id_category_e category) {
 
 void
 ignore_unique_numbers(unique_id_category_e category) {
+  std::lock_guard<std::recursive_mutex> lock{s_mutex};
+
   assert_valid_category(category);
   s_ignore_unique_numbers[category] = true;
 }
@@ -16,6 +16,7 @@
 
 #include "common/bit_cursor.h"
 #include "common/endian.h"
+#include "common/mpeg.h"
 #include "common/strings/formatting.h"
 #include "common/vc1.h"
 
@@ -301,52 +302,48 @@ es_parser_c::~es_parser_c() {
 void
 es_parser_c::add_bytes(unsigned char *buffer,
                        int size) {
-  memory_slice_cursor_c cursor;
-
-  int previous_pos            = -1;
   int64_t previous_stream_pos = m_stream_pos;
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker = (1 << 24) | ((unsigned int)cursor.get_char() << 16) | ((unsigned int)cursor.get_char() << 8) | (unsigned int)cursor.get_char();
+  // Scan a contiguous buffer: either the new data alone or the new
+  // data appended to what's left over from the previous call.
+  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size())) {
+    m_unparsed_buffer->add(buffer, size);
+    buffer = m_unparsed_buffer->get_buffer();
+    size   = m_unparsed_buffer->get_size();
+  }
 
-    while (1) {
-      if (is_marker(marker)) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - 4 - previous_pos;
+  auto end      = buffer + size;
+  auto scan_pos = static_cast<unsigned char const *>(buffer);
+  unsigned char const *previous_marker{};
 
-          memory_cptr packet(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(packet->get_buffer(), previous_pos, new_size);
+  while (true) {
+    // A marker consists of the start code and the following byte.
+    auto marker = mtx::mpeg::find_start_code(scan_pos, end);
+    if ((end - marker) < 4)
+      break;
 
-          handle_packet(packet);
-        }
+    scan_pos = marker + 3;
 
-        previous_pos = cursor.get_position() - 4;
-        m_stream_pos = previous_stream_pos + previous_pos;
-      }
+    if (previous_marker)
+      handle_packet(memory_c::clone(previous_marker, marker - previous_marker));
 
-      if (!cursor.char_available())
-        break;
-
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
-    }
+    previous_marker = marker;
+    m_stream_pos    = previous_stream_pos + (previous_marker - buffer);
   }
 
-  if (-1 == previous_pos)
-    previous_pos = 0;
+  int previous_pos = previous_marker ? previous_marker - buffer : 0;
+  int new_size     = size - previous_pos;
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    memory_cptr new_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(new_unparsed_buffer->get_buffer(), previous_pos, new_size);
-    m_unparsed_buffer = new_unparsed_buffer;
+  if (0 == new_size)
+    m_unparsed_buffer.reset();
+
+  else if (m_unparsed_buffer && (m_unparsed_buffer->get_buffer() == buffer)) {
+    if (previous_pos)
+      memmove(buffer, buffer + previous_pos, new_size);
+    m_unparsed_buffer->resize(new_size);
 
   } else
-    m_unparsed_buffer.reset();
+    m_unparsed_buffer = memory_c::clone(buffer + previous_pos, new_size);
 }
 
 void
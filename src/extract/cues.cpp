@@ -42,7 +42,8 @@ write_cues(std::vector<track_spec_t> const &tracks,
            std::map<int64_t, int64_t> const &track_number_map,
            std::unordered_map<int64_t, std::vector<cue_point_t> > const &cue_points,
            uint64_t segment_data_start_pos,
-           uint64_t timecode_scale) {
+           uint64_t timecode_scale,
+           extraction_range_c const &range) {
   for (auto const &track : tracks) {
     auto track_number_itr = track_number_map.find(track.tid);
     if (track_number_itr == track_number_map.end())
@@ -60,6 +61,9 @@ write_cues(std::vector<track_spec_t> const &tracks,
       auto out = mm_file_io_c{track.out_name, MODE_CREATE};
 
       for (auto const &p : track_cue_points) {
+        if (!range.includes(p.timecode * timecode_scale))
+          continue;
+
         auto line = (boost::format("timecode=%1% duration=%2% cluster_position=%3% relative_position=%4%\n")
                      % format_timestamp(p.timecode * timecode_scale, 9)
                      % (p.duration          ? format_timestamp(p.duration.get() * timecode_scale, 9)        : "-")
@@ -178,7 +182,8 @@ determine_cluster_data_start_positions(mm_io_c &file,
 void
 extract_cues(std::string const &file_name,
              std::vector<track_spec_t> const &tracks,
-             kax_analyzer_c::parse_mode_e parse_mode) {
+             kax_analyzer_c::parse_mode_e parse_mode,
+             extraction_range_c const &range) {
   if (tracks.empty())
     mxerror(Y("Nothing to do.\n"));
 
@@ -190,5 +195,5 @@ extract_cues(std::string const &file_name,
   auto segment_data_start_pos = analyzer->get_segment_data_start_pos();
 
   determine_cluster_data_start_positions(analyzer->get_file(), segment_data_start_pos, cue_points);
-  write_cues(tracks, track_number_map, cue_points, segment_data_start_pos, timecode_scale);
+  write_cues(tracks, track_number_map, cue_points, segment_data_start_pos, timecode_scale, range);
 }
@@ -15,10 +15,12 @@
 
 #include "common/ebml.h"
 #include "common/iso639.h"
+#include "common/kax_analyzer_cache.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "common/translation.h"
 #include "extract/extract_cli_parser.h"
+#include "extract/extraction_worker.h"
 #include "extract/options.h"
 
 extract_cli_parser_c::extract_cli_parser_c(const std::vector<std::string> &args)
@@ -60,6 +62,9 @@ extract_cli_parser_c::init_parser() {
 
   add_section_header(YT("Global options"));
   OPT("f|parse-fully",    set_parse_fully,      YT("Parse the whole file instead of relying on the index."));
+  OPT("analyzer-cache=directory", set_analyzer_cache, YT("Store the layout of analyzed files in this directory and re-use it for files that haven't been changed since."));
+  OPT("range=start-end",  set_range,            YT("Only extract frames, timecodes or cues from this range of timestamps. Only valid when extracting tracks, timecodes or cues. "
+                                                   "Either side may be omitted (e.g. '01:00:00-' or '-00:02:30')."));
 
   add_common_options();
 
@@ -70,6 +75,9 @@ extract_cli_parser_c::init_parser() {
   OPT("blockadd=level", set_blockadd, YT("Keep only the BlockAdditions up to this level (default: keep all levels)"));
   OPT("raw",            set_raw,      YT("Extract the data to a raw file."));
   OPT("fullraw",        set_fullraw,  YT("Extract the data to a raw file including the CodecPrivate as a header."));
+  OPT("threaded-writing", set_threaded_writing, YT("Decode and write each output file on its own thread. This option applies to all tracks."));
+  OPT("max-queued-memory=megabytes", set_max_queued_memory,
+      YT("Limit the memory used for frames waiting to be written in threaded writing mode to this many megabytes (default: 128)."));
   add_informational_option("TID:out", YT("Write track with the ID TID to the file 'out'."));
 
   add_section_header(YT("Example"));
@@ -147,6 +155,11 @@ extract_cli_parser_c::set_parse_fully() {
   m_options.m_parse_mode = kax_analyzer_c::parse_mode_full;
 }
 
+void
+extract_cli_parser_c::set_analyzer_cache() {
+  mtx::kax_analyzer_cache::set_directory(m_next_arg);
+}
+
 void
 extract_cli_parser_c::set_charset() {
   assert_mode(options_c::em_tracks);
@@ -178,6 +191,23 @@ extract_cli_parser_c::set_fullraw() {
   m_target_mode = track_spec_t::tm_full_raw;
 }
 
+void
+extract_cli_parser_c::set_threaded_writing() {
+  assert_mode(options_c::em_tracks);
+  m_options.m_threaded_writing = true;
+}
+
+void
+extract_cli_parser_c::set_max_queued_memory() {
+  assert_mode(options_c::em_tracks);
+
+  int64_t megabytes = 0;
+  if (!parse_number(m_next_arg, megabytes) || (0 >= megabytes))
+    mxerror(boost::format(Y("Invalid amount of memory in argument '%1%'.\n")) % m_next_arg);
+
+  extraction_worker_c::set_max_queued_bytes(megabytes * 1024 * 1024);
+}
+
 void
 extract_cli_parser_c::set_simple() {
   assert_mode(options_c::em_chapters);
@@ -195,6 +225,17 @@ extract_cli_parser_c::set_simple_language() {
   m_options.m_simple_chapter_language.reset(g_iso639_languages[language_idx].iso639_2_code);
 }
 
+void
+extract_cli_parser_c::set_range() {
+  if (   (options_c::em_tracks       != m_options.m_extraction_mode)
+      && (options_c::em_timecodes_v2 != m_options.m_extraction_mode)
+      && (options_c::em_cues         != m_options.m_extraction_mode))
+    mxerror(boost::format(Y("'%1%' is only allowed when extracting tracks, timecodes or cues.\n")) % m_current_arg);
+
+  if (!m_options.m_range.parse(m_next_arg))
+    mxerror(boost::format(Y("Invalid time range in argument '%1%'.\n")) % m_next_arg);
+}
+
 void
 extract_cli_parser_c::set_mode_or_extraction_spec() {
   ++m_num_unknown_args;
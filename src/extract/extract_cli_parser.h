@@ -43,13 +43,17 @@ protected:
   void assert_mode(options_c::extraction_mode_e mode);
 
   void set_parse_fully();
+  void set_analyzer_cache();
   void set_charset();
   void set_cuesheet();
   void set_blockadd();
   void set_raw();
   void set_fullraw();
+  void set_threaded_writing();
+  void set_max_queued_memory();
   void set_simple();
   void set_simple_language();
+  void set_range();
   void set_mode_or_extraction_spec();
   void set_extraction_mode();
   void add_extraction_spec();
@@ -0,0 +1,145 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   restricting the extraction to a range of timestamps
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxInfoData.h>
+
+#include "common/ebml.h"
+#include "common/strings/parsing.h"
+#include "extract/extraction_range.h"
+
+using namespace libmatroska;
+
+bool
+extraction_range_c::parse(std::string const &arg) {
+  auto dash_pos = arg.find('-');
+  if (std::string::npos == dash_pos)
+    return false;
+
+  auto start_str = arg.substr(0, dash_pos);
+  auto end_str   = arg.substr(dash_pos + 1);
+  auto start     = timestamp_c{};
+  auto end       = timestamp_c{};
+
+  if (start_str.empty() && end_str.empty())
+    return false;
+
+  if (   (!start_str.empty() && !parse_timecode(start_str, start))
+      || (!end_str.empty()   && !parse_timecode(end_str,   end)))
+    return false;
+
+  if (start.valid() && end.valid() && (start >= end))
+    return false;
+
+  m_start = start;
+  m_end   = end;
+
+  return true;
+}
+
+bool
+extraction_range_c::includes(int64_t timestamp)
+  const {
+  return (!m_start.valid() || (timestamp >= m_start.to_ns()))
+      && (!m_end.valid()   || (timestamp <  m_end.to_ns()));
+}
+
+void
+extraction_range_c::start_cluster() {
+  m_min_cluster_timestamp.reset();
+}
+
+bool
+extraction_range_c::is_cluster_past_end()
+  const {
+  return m_end.valid() && m_min_cluster_timestamp.valid() && (m_min_cluster_timestamp >= m_end);
+}
+
+bool
+extraction_range_c::wants_frame(int64_t track_number,
+                                int64_t timestamp,
+                                bool keyframe) {
+  if (!is_set())
+    return true;
+
+  if (!m_min_cluster_timestamp.valid() || (timestamp < m_min_cluster_timestamp.to_ns()))
+    m_min_cluster_timestamp = timestamp_c::ns(timestamp);
+
+  if (!includes(timestamp))
+    return false;
+
+  if (m_started_tracks.count(track_number))
+    return true;
+
+  if (!keyframe)
+    return false;
+
+  m_started_tracks.insert(track_number);
+
+  return true;
+}
+
+uint64_t
+extraction_range_c::find_start_position(kax_analyzer_c &analyzer)
+  const {
+  if (!m_start.valid())
+    return 0;
+
+  auto info_m = analyzer.read_all(EBML_INFO(KaxInfo));
+  auto info   = dynamic_cast<KaxInfo *>(info_m.get());
+  auto cues_m = analyzer.read_all(EBML_INFO(KaxCues));
+  auto cues   = dynamic_cast<KaxCues *>(cues_m.get());
+
+  if (!cues)
+    return 0;
+
+  auto timecode_scale = info ? FindChildValue<KaxTimecodeScale>(info, 1000000ull) : 1000000ull;
+  auto start          = static_cast<uint64_t>(m_start.to_ns());
+  auto found          = false;
+  auto best_timestamp = uint64_t{};
+  auto best_position  = uint64_t{};
+
+  for (auto const &elt : *cues) {
+    auto kcue_point = dynamic_cast<KaxCuePoint *>(elt);
+    if (!kcue_point)
+      continue;
+
+    auto ktime        = FindChild<KaxCueTime>(*kcue_point);
+    auto ktrack_pos   = FindChild<KaxCueTrackPositions>(*kcue_point);
+    auto kcluster_pos = ktrack_pos ? FindChild<KaxCueClusterPosition>(*ktrack_pos) : nullptr;
+
+    if (!ktime || !kcluster_pos)
+      continue;
+
+    auto timestamp = ktime->GetValue() * timecode_scale;
+    auto position  = kcluster_pos->GetValue();
+
+    if (timestamp > start)
+      continue;
+
+    // Several tracks may have cue points with the same timestamp. The
+    // cluster located first contains all of them.
+    if (   !found
+        || (timestamp > best_timestamp)
+        || ((timestamp == best_timestamp) && (position < best_position))) {
+      found          = true;
+      best_timestamp = timestamp;
+      best_position  = position;
+    }
+  }
+
+  return found ? analyzer.get_segment_data_start_pos() + best_position : 0;
+}
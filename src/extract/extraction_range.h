@@ -0,0 +1,74 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   restricting the extraction to a range of timestamps
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_EXTRACT_EXTRACTION_RANGE_H
+#define MTX_EXTRACT_EXTRACTION_RANGE_H
+
+#include "common/common_pch.h"
+
+#include <unordered_set>
+
+#include "common/kax_analyzer.h"
+#include "common/timestamp.h"
+
+class extraction_range_c {
+public:
+  // Either may be invalid meaning that the range is open on that side.
+  timestamp_c m_start, m_end;
+
+protected:
+  std::unordered_set<int64_t> m_started_tracks;
+  // Smallest timestamp of all frames passed to wants_frame() since
+  // start_cluster() was called
+  timestamp_c m_min_cluster_timestamp;
+
+public:
+  bool is_set() const {
+    return m_start.valid() || m_end.valid();
+  }
+
+  /** \brief Parses \c START-END; one of the two may be omitted */
+  bool parse(std::string const &arg);
+
+  bool includes(int64_t timestamp) const;
+
+  /** \brief Resets the timestamp tracking for the next cluster */
+  void start_cluster();
+
+  /** \brief Whether or not reading can stop after the current cluster
+
+     Blocks may have negative timestamps relative to their cluster
+     (e.g. B frames), so a cluster starting at or after the range's
+     end may still contain frames inside the range, and so may the
+     clusters following it. Reading stops only once all frames of a
+     cluster lie at or after the range's end.
+  */
+  bool is_cluster_past_end() const;
+
+  /** \brief Decides whether or not a frame is output
+
+     Frames outside the range are dropped. Inside the range each track
+     starts with its first key frame so that the output doesn't begin
+     with frames that cannot be decoded.
+  */
+  bool wants_frame(int64_t track_number, int64_t timestamp, bool keyframe);
+
+  /** \brief Finds the cluster to start reading at
+
+     Returns the absolute file position of the cluster referenced by
+     the last cue point at or before the range's start, or 0 if there
+     is no such cue point.
+  */
+  uint64_t find_start_position(kax_analyzer_c &analyzer) const;
+};
+
+#endif // MTX_EXTRACT_EXTRACTION_RANGE_H
@@ -0,0 +1,201 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   decoding and writing extracted frames on separate threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlockData.h>
+
+#include "extract/extraction_worker.h"
+
+int64_t extraction_worker_c::ms_max_queued_bytes = 128 * 1024 * 1024;
+int64_t extraction_worker_c::ms_queued_bytes     = 0;
+std::mutex extraction_worker_c::ms_queued_bytes_mutex;
+std::condition_variable extraction_worker_c::ms_room_available;
+
+extraction_worker_c::extraction_worker_c()
+  : m_stop{}
+{
+  m_thread = std::thread{[this]() { run(); }};
+}
+
+extraction_worker_c::~extraction_worker_c() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_job_available.notify_all();
+
+  if (!m_thread.joinable())
+    return;
+
+  // mxerror() called by an extractor exits the program from the
+  // worker thread itself, destroying the worker on its own thread.
+  if (m_thread.get_id() == std::this_thread::get_id())
+    m_thread.detach();
+  else
+    m_thread.join();
+}
+
+void
+extraction_worker_c::set_max_queued_bytes(int64_t max_queued_bytes) {
+  ms_max_queued_bytes = max_queued_bytes;
+}
+
+void
+extraction_worker_c::reserve_room(std::size_t size) {
+  std::unique_lock<std::mutex> lock{ms_queued_bytes_mutex};
+
+  // A single job larger than the limit is let through as long as
+  // nothing else is queued.
+  ms_room_available.wait(lock, [size]() {
+    return !ms_queued_bytes || ((ms_queued_bytes + static_cast<int64_t>(size)) <= ms_max_queued_bytes);
+  });
+
+  ms_queued_bytes += size;
+}
+
+void
+extraction_worker_c::release_room(std::size_t size) {
+  {
+    std::lock_guard<std::mutex> lock{ms_queued_bytes_mutex};
+    ms_queued_bytes -= size;
+  }
+
+  ms_room_available.notify_all();
+}
+
+void
+extraction_worker_c::rethrow_exception_if_any() {
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  if (m_exception)
+    std::rethrow_exception(m_exception);
+}
+
+void
+extraction_worker_c::queue(job_t &&job) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_jobs.emplace_back(std::move(job));
+  }
+
+  m_job_available.notify_one();
+}
+
+void
+extraction_worker_c::queue_frame(xtr_base_c &extractor,
+                                 xtr_frame_t const &f) {
+  rethrow_exception_if_any();
+
+  auto job = job_t{};
+  job.m_size = f.frame->get_size();
+
+  reserve_room(job.m_size);
+
+  // The frame's memory belongs to the cluster currently being read
+  // and is gone by the time the worker gets to it.
+  job.m_extractor        = &extractor;
+  job.m_frame            = memory_c::clone(f.frame->get_buffer(), f.frame->get_size());
+  job.m_timecode         = f.timecode;
+  job.m_duration         = f.duration;
+  job.m_bref             = f.bref;
+  job.m_fref             = f.fref;
+  job.m_keyframe         = f.keyframe;
+  job.m_discardable      = f.discardable;
+  job.m_references_valid = f.references_valid;
+  job.m_discard_duration = f.discard_duration;
+
+  if (f.additions)
+    job.m_additions.reset(static_cast<KaxBlockAdditions *>(f.additions->Clone()));
+
+  queue(std::move(job));
+}
+
+void
+extraction_worker_c::queue_codec_state(xtr_base_c &extractor,
+                                       memory_cptr const &codec_state) {
+  rethrow_exception_if_any();
+
+  auto job = job_t{};
+  job.m_size = codec_state->get_size();
+
+  reserve_room(job.m_size);
+
+  job.m_extractor   = &extractor;
+  job.m_codec_state = memory_c::clone(codec_state->get_buffer(), codec_state->get_size());
+
+  queue(std::move(job));
+}
+
+void
+extraction_worker_c::process(job_t &job) {
+  if (job.m_codec_state) {
+    job.m_extractor->handle_codec_state(job.m_codec_state);
+    return;
+  }
+
+  auto f = xtr_frame_t{job.m_frame, job.m_additions.get(), job.m_timecode, job.m_duration, job.m_bref, job.m_fref, job.m_keyframe, job.m_discardable, job.m_references_valid, job.m_discard_duration};
+  job.m_extractor->decode_and_handle_frame(f);
+}
+
+void
+extraction_worker_c::run() {
+  while (true) {
+    auto job    = job_t{};
+    auto failed = false;
+
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_job_available.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+      if (m_jobs.empty())
+        return;
+
+      job    = std::move(m_jobs.front());
+      failed = !!m_exception;
+      m_jobs.pop_front();
+    }
+
+    // After a failure the remaining jobs are only dropped so that the
+    // main thread doesn't wait for room in the queues forever.
+    if (!failed) {
+      try {
+        process(job);
+
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_exception = std::current_exception();
+      }
+    }
+
+    auto size = job.m_size;
+    job       = job_t{};
+
+    release_room(size);
+  }
+}
+
+void
+extraction_worker_c::finish() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_job_available.notify_all();
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  rethrow_exception_if_any();
+}
@@ -0,0 +1,92 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   decoding and writing extracted frames on separate threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_EXTRACT_EXTRACTION_WORKER_H
+#define MTX_EXTRACT_EXTRACTION_WORKER_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "extract/xtr_base.h"
+
+/** \brief Runs the extractors writing to one output file on their own thread
+
+   In threaded writing mode the main thread only demultiplexes. Each
+   frame is copied and queued for the worker responsible for the
+   frame's extractor. The worker reverses the content encodings and
+   calls the extractor's \c handle_frame(). Extractors writing to the
+   same file share a worker so that their output isn't interleaved
+   differently than in the source file. Codec state updates are queued
+   as well so that they're applied in the right order.
+
+   The number of bytes queued for all workers together is limited.
+   \c queue_frame() blocks until the workers have made room. An
+   exception thrown on a worker thread stops that worker and is
+   re-thrown on the main thread by the next call to \c queue_frame()
+   or by \c finish().
+*/
+class extraction_worker_c {
+protected:
+  struct job_t {
+    xtr_base_c *m_extractor{};
+    memory_cptr m_frame, m_codec_state;
+    std::shared_ptr<KaxBlockAdditions> m_additions;
+    int64_t m_timecode{}, m_duration{}, m_bref{}, m_fref{};
+    bool m_keyframe{}, m_discardable{}, m_references_valid{};
+    timestamp_c m_discard_duration;
+    std::size_t m_size{};
+  };
+
+  std::deque<job_t> m_jobs;
+  bool m_stop;
+  std::exception_ptr m_exception;
+
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  std::thread m_thread;
+
+protected:
+  static int64_t ms_max_queued_bytes, ms_queued_bytes;
+  static std::mutex ms_queued_bytes_mutex;
+  static std::condition_variable ms_room_available;
+
+public:
+  extraction_worker_c();
+  ~extraction_worker_c();
+
+  void queue_frame(xtr_base_c &extractor, xtr_frame_t const &f);
+  void queue_codec_state(xtr_base_c &extractor, memory_cptr const &codec_state);
+
+  /** \brief Waits until all queued jobs have been processed and stops the thread */
+  void finish();
+
+public:
+  static void set_max_queued_bytes(int64_t max_queued_bytes);
+
+protected:
+  void run();
+  void process(job_t &job);
+  void queue(job_t &&job);
+  void rethrow_exception_if_any();
+
+  static void reserve_room(std::size_t size);
+  static void release_room(std::size_t size);
+};
+
+using extraction_worker_cptr = std::shared_ptr<extraction_worker_c>;
+
+#endif // MTX_EXTRACT_EXTRACTION_WORKER_H
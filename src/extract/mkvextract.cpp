@@ -112,7 +112,7 @@ main(int argc,
   options_c options = extract_cli_parser_c(command_line_utf8(argc, argv)).run();
 
   if (options_c::em_tracks == options.m_extraction_mode)
-    extract_tracks(options.m_file_name, options.m_tracks, options.m_parse_mode);
+    extract_tracks(options.m_file_name, options.m_tracks, options.m_parse_mode, options.m_range, options.m_threaded_writing);
 
   else if (options_c::em_tags == options.m_extraction_mode)
     extract_tags(options.m_file_name, options.m_parse_mode);
@@ -124,13 +124,13 @@ main(int argc,
     extract_chapters(options.m_file_name, options.m_simple_chapter_format, options.m_parse_mode, options.m_simple_chapter_language);
 
   else if (options_c::em_cues == options.m_extraction_mode)
-    extract_cues(options.m_file_name, options.m_tracks, options.m_parse_mode);
+    extract_cues(options.m_file_name, options.m_tracks, options.m_parse_mode, options.m_range);
 
   else if (options_c::em_cuesheet == options.m_extraction_mode)
     extract_cuesheet(options.m_file_name, options.m_parse_mode);
 
   else if (options_c::em_timecodes_v2 == options.m_extraction_mode)
-    extract_timecodes(options.m_file_name, options.m_tracks, 2);
+    extract_timecodes(options.m_file_name, options.m_tracks, 2, options.m_parse_mode, options.m_range);
 
   else
     usage(2);
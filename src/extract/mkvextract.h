@@ -22,6 +22,7 @@
 #include "common/file_types.h"
 #include "common/kax_analyzer.h"
 #include "common/mm_io.h"
+#include "extract/extraction_range.h"
 #include "extract/track_spec.h"
 #include "librmff/librmff.h"
 
@@ -49,14 +50,14 @@ show_error(const boost::format &format) {
 
 void find_and_verify_track_uids(KaxTracks &tracks, std::vector<track_spec_t> &tspecs);
 
-bool extract_tracks(const std::string &file_name, std::vector<track_spec_t> &tspecs, kax_analyzer_c::parse_mode_e parse_mode);
+bool extract_tracks(const std::string &file_name, std::vector<track_spec_t> &tspecs, kax_analyzer_c::parse_mode_e parse_mode, extraction_range_c const &range, bool threaded_writing);
 void extract_tags(const std::string &file_name, kax_analyzer_c::parse_mode_e parse_mode);
 void extract_chapters(const std::string &file_name, bool chapter_format_simple, kax_analyzer_c::parse_mode_e parse_mode, boost::optional<std::string> const &language_to_extract);
 void extract_attachments(const std::string &file_name, std::vector<track_spec_t> &tracks, kax_analyzer_c::parse_mode_e parse_mode);
 void extract_cuesheet(const std::string &file_name, kax_analyzer_c::parse_mode_e parse_mode);
 void write_cuesheet(std::string file_name, KaxChapters &chapters, KaxTags &tags, int64_t tuid, mm_io_c &out);
-void extract_timecodes(const std::string &file_name, std::vector<track_spec_t> &tspecs, int version);
-void extract_cues(std::string const &file_name, std::vector<track_spec_t> const &tracks, kax_analyzer_c::parse_mode_e parse_mode);
+void extract_timecodes(const std::string &file_name, std::vector<track_spec_t> &tspecs, int version, kax_analyzer_c::parse_mode_e parse_mode, extraction_range_c const &range);
+void extract_cues(std::string const &file_name, std::vector<track_spec_t> const &tracks, kax_analyzer_c::parse_mode_e parse_mode, extraction_range_c const &range);
 
 kax_analyzer_cptr open_and_analyze(std::string const &file_name, kax_analyzer_c::parse_mode_e parse_mode, bool exit_on_error = true);
 
@@ -13,6 +13,8 @@
 
 #include "common/common_pch.h"
 
+#include "extract/extraction_range.h"
+
 class options_c {
 public:
   enum extraction_mode_e {
@@ -27,10 +29,11 @@ public:
   };
 
   std::string m_file_name;
-  bool m_simple_chapter_format;
+  bool m_simple_chapter_format, m_threaded_writing;
   boost::optional<std::string> m_simple_chapter_language;
   kax_analyzer_c::parse_mode_e m_parse_mode;
   extraction_mode_e m_extraction_mode;
+  extraction_range_c m_range;
 
   std::vector<track_spec_t> m_tracks;
 
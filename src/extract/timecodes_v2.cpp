@@ -36,6 +36,7 @@
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
 #include "common/strings/formatting.h"
+#include "extract/extraction_range.h"
 #include "extract/mkvextract.h"
 #include "extract/xtr_base.h"
 
@@ -73,6 +74,7 @@ struct timecode_extractor_t {
 };
 
 static std::vector<timecode_extractor_t> timecode_extractors;
+static extraction_range_c s_range;
 
 // ------------------------------------------------------------------------
 
@@ -155,10 +157,16 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
   KaxBlockDuration *kduration = FindChild<KaxBlockDuration>(&blockgroup);
   int64_t duration            = !kduration ? extractor->m_default_duration * block->NumberFrames() : kduration->GetValue() * tc_scale;
 
+  // Blocks without references are key frames.
+  auto keyframe = !FindChild<KaxReferenceBlock>(&blockgroup);
+
   // Pass the block to the extractor.
   size_t i;
-  for (i = 0; block->NumberFrames() > i; ++i)
-    extractor->m_timecodes.push_back(timecode_t(block->GlobalTimecode() + i * duration / block->NumberFrames(), duration / block->NumberFrames()));
+  for (i = 0; block->NumberFrames() > i; ++i) {
+    auto timecode = block->GlobalTimecode() + i * duration / block->NumberFrames();
+    if (s_range.wants_frame(extractor->m_tnum, timecode, keyframe))
+      extractor->m_timecodes.push_back(timecode_t(timecode, duration / block->NumberFrames()));
+  }
 }
 
 static void
@@ -175,17 +183,32 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
 
   // Pass the block to the extractor.
   size_t i;
-  for (i = 0; simpleblock.NumberFrames() > i; ++i)
-    extractor->m_timecodes.push_back(timecode_t(simpleblock.GlobalTimecode() + i * extractor->m_default_duration, extractor->m_default_duration));
+  for (i = 0; simpleblock.NumberFrames() > i; ++i) {
+    auto timecode = simpleblock.GlobalTimecode() + i * extractor->m_default_duration;
+    if (s_range.wants_frame(extractor->m_tnum, timecode, simpleblock.IsKeyframe()))
+      extractor->m_timecodes.push_back(timecode_t(timecode, extractor->m_default_duration));
+  }
 }
 
 void
 extract_timecodes(const std::string &file_name,
                   std::vector<track_spec_t> &tspecs,
-                  int version) {
+                  int version,
+                  kax_analyzer_c::parse_mode_e parse_mode,
+                  extraction_range_c const &range) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
+  s_range = range;
+
+  // The cues are only needed for finding the cluster to start at.
+  auto start_pos = uint64_t{};
+  if (s_range.is_set()) {
+    auto analyzer = open_and_analyze(file_name, parse_mode, false);
+    if (analyzer)
+      start_pos = s_range.find_start_position(*analyzer);
+  }
+
   // open input file
   mm_io_c *in;
   try {
@@ -281,6 +304,16 @@ extract_timecodes(const std::string &file_name,
         find_and_verify_track_uids(*dynamic_cast<KaxTracks *>(l1), tspecs);
         create_timecode_files(*dynamic_cast<KaxTracks *>(l1), tspecs, version);
 
+      } else if (Is<KaxCluster>(l1) && tracks_found && (start_pos > l1->GetElementPosition())) {
+        // Jump to the cluster the cues list for the start of the range.
+        in->setFilePointer(start_pos);
+        start_pos    = 0;
+        upper_lvl_el = 0;
+
+        delete l1;
+        l1 = es->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, 0xFFFFFFFFL, true);
+        continue;
+
       } else if (Is<KaxCluster>(l1)) {
         show_element(l1, 1, Y("Cluster"));
         KaxCluster *cluster = (KaxCluster *)l1;
@@ -295,6 +328,8 @@ extract_timecodes(const std::string &file_name,
             mxinfo(boost::format(Y("Progress: %1%%%%2%")) % current_percentage % "\r");
         }
 
+        s_range.start_cluster();
+
         upper_lvl_el = 0;
         l2           = es->FindNextElement(EBML_CONTEXT(l1), upper_lvl_el, 0xFFFFFFFFL, true, 1);
         while (l2 && (0 >= upper_lvl_el)) {
@@ -347,6 +382,11 @@ extract_timecodes(const std::string &file_name,
 
         } // while (l2)
 
+        if (s_range.is_cluster_past_end()) {
+          delete l1;
+          break;
+        }
+
       } else
         l1->SkipData(*es, EBML_CONTEXT(l1));
 
@@ -34,15 +34,21 @@
 
 #include "common/command_line.h"
 #include "common/ebml.h"
+#include "common/kax_block_scanner.h"
 #include "common/kax_file.h"
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
+#include "extract/extraction_range.h"
+#include "extract/extraction_worker.h"
 #include "extract/mkvextract.h"
 #include "extract/xtr_base.h"
 
 using namespace libmatroska;
 
 static std::vector<xtr_base_c *> extractors;
+static extraction_range_c s_range;
+static bool s_threaded_writing = false;
+static std::unordered_map<xtr_base_c *, extraction_worker_cptr> s_workers;
 
 // ------------------------------------------------------------------------
 
@@ -121,6 +127,41 @@ create_extractors(KaxTracks &kax_tracks,
     extractors[i]->headers_done();
 }
 
+static extraction_worker_c &
+get_worker(xtr_base_c &extractor) {
+  // Tracks written to the same file must share a worker.
+  auto &worker = s_workers[extractor.m_master ? extractor.m_master : &extractor];
+  if (!worker)
+    worker = std::make_shared<extraction_worker_c>();
+
+  return *worker;
+}
+
+static void
+handle_frame(xtr_base_c &extractor,
+             xtr_frame_t &f) {
+  // Blocks in BlockGroups don't carry a key frame flag. They're key
+  // frames if they don't reference other frames.
+  auto keyframe = f.references_valid ? !f.bref && !f.fref : f.keyframe;
+
+  if (!s_range.wants_frame(extractor.m_track_num, f.timecode, keyframe))
+    return;
+
+  if (s_threaded_writing)
+    get_worker(extractor).queue_frame(extractor, f);
+  else
+    extractor.decode_and_handle_frame(f);
+}
+
+static void
+handle_codec_state(xtr_base_c &extractor,
+                   memory_cptr &codec_state) {
+  if (s_threaded_writing)
+    get_worker(extractor).queue_codec_state(extractor, codec_state);
+  else
+    extractor.handle_codec_state(codec_state);
+}
+
 static int64_t
 handle_blockgroup(KaxBlockGroup &blockgroup,
                   KaxCluster &cluster,
@@ -169,7 +210,7 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
   KaxCodecState *kcstate = FindChild<KaxCodecState>(&blockgroup);
   if (kcstate) {
     memory_cptr codec_state(new memory_c(kcstate->GetBuffer(), kcstate->GetSize(), false));
-    extractor->handle_codec_state(codec_state);
+    handle_codec_state(*extractor, codec_state);
   }
 
   for (i = 0; i < block->NumberFrames(); i++) {
@@ -192,7 +233,7 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
     auto &data = block->GetBuffer(i);
     auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
     auto f     = xtr_frame_t{frame, kadditions, this_timecode, this_duration, bref, fref, false, false, true, discard_padding};
-    extractor->decode_and_handle_frame(f);
+    handle_frame(*extractor, f);
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -237,7 +278,84 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
     auto &data = simpleblock.GetBuffer(i);
     auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
     auto f     = xtr_frame_t{frame, nullptr, this_timecode, this_duration, -1, -1, simpleblock.IsKeyframe(), simpleblock.IsDiscardable(), false, timestamp_c::ns(0)};
-    extractor->decode_and_handle_frame(f);
+    handle_frame(*extractor, f);
+
+    max_timecode = std::max(max_timecode, this_timecode);
+  }
+
+  return max_timecode;
+}
+
+static xtr_base_c *
+find_extractor(uint64_t track_number) {
+  for (auto extractor : extractors)
+    if (extractor->m_track_num == static_cast<int64_t>(track_number))
+      return extractor;
+
+  return nullptr;
+}
+
+static std::shared_ptr<KaxBlockAdditions>
+read_block_additions(memory_c const &raw_additions) {
+  mm_mem_io_c in{raw_additions};
+  EbmlStream es{in};
+
+  auto upper_lvl_el = 0;
+  auto element      = std::shared_ptr<EbmlElement>{es.FindNextElement(EBML_CLASS_CONTEXT(KaxBlockGroup), upper_lvl_el, 0xFFFFFFFFL, true)};
+  auto additions    = std::dynamic_pointer_cast<KaxBlockAdditions>(element);
+
+  if (additions) {
+    EbmlElement *l2 = nullptr;
+    additions->Read(es, EBML_CLASS_CONTEXT(KaxBlockAdditions), upper_lvl_el, l2, true);
+  }
+
+  return additions;
+}
+
+static int64_t
+handle_scanned_block(kax_block_scanner_c::block_t const &block,
+                     uint64_t cluster_timecode,
+                     int64_t tc_scale) {
+  auto extractor = find_extractor(block.m_track_number);
+  if (!extractor)
+    return -1;
+
+  int64_t num_frames   = block.m_frames.size();
+  int64_t timecode     = (static_cast<int64_t>(cluster_timecode) + block.m_timecode) * tc_scale;
+  int64_t duration     = block.m_duration ? static_cast<int64_t>(*block.m_duration * tc_scale) : extractor->m_default_duration * num_frames;
+  int64_t max_timecode = 0;
+  int64_t bref         = block.m_simple_block ? -1 : 0;
+  int64_t fref         = block.m_simple_block ? -1 : 0;
+
+  for (auto idx = 0u; (2 > idx) && (block.m_references.size() > idx); ++idx) {
+    if (0 > block.m_references[idx])
+      bref = block.m_references[idx];
+    else
+      fref = block.m_references[idx];
+  }
+
+  if (block.m_codec_state) {
+    auto codec_state = block.m_codec_state;
+    handle_codec_state(*extractor, codec_state);
+  }
+
+  auto additions       = block.m_block_additions ? read_block_additions(*block.m_block_additions) : std::shared_ptr<KaxBlockAdditions>{};
+  auto discard_padding = timestamp_c::ns(block.m_discard_padding ? *block.m_discard_padding : 0);
+
+  for (auto idx = 0; idx < num_frames; ++idx) {
+    int64_t this_timecode, this_duration;
+
+    if (0 > duration) {
+      this_timecode = timecode;
+      this_duration = duration;
+    } else {
+      this_timecode = timecode + idx * duration / num_frames;
+      this_duration = duration / num_frames;
+    }
+
+    auto frame = block.m_frames[idx];
+    auto f     = xtr_frame_t{frame, additions.get(), this_timecode, this_duration, bref, fref, block.m_keyframe, block.m_discardable, !block.m_simple_block, discard_padding};
+    handle_frame(*extractor, f);
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -245,10 +363,75 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
   return max_timecode;
 }
 
+static void
+handle_scanned_cluster(kax_block_scanner_c const &scanner,
+                       kax_file_c &file,
+                       int64_t tc_scale) {
+  int64_t max_timecode = -1;
+
+  for (auto const &block : scanner.get_blocks())
+    max_timecode = std::max(max_timecode, handle_scanned_block(block, scanner.get_cluster_timecode(), tc_scale));
+
+  if (-1 != max_timecode)
+    file.set_last_timecode(max_timecode);
+}
+
+// Reads the next cluster without building libebml elements for it if
+// possible. The file position is left unchanged if the next element
+// isn't a cluster with a known size or if the cluster is damaged; the
+// caller must use kax_file_c in that case.
+static bool
+scan_next_cluster(mm_io_c &in,
+                  uint64_t file_size,
+                  kax_block_scanner_c &scanner) {
+  // The verbose output lists each element's position.
+  if (0 != verbose)
+    return false;
+
+  auto start_pos = in.getFilePointer();
+
+  try {
+    auto id   = vint_c::read_ebml_id(in);
+    auto size = vint_c::read(in);
+
+    if (   id.is_valid()
+        && (EBML_ID_VALUE(EBML_ID(KaxCluster)) == id.m_value)
+        && !size.is_unknown()
+        && ((in.getFilePointer() + size.m_value) <= file_size)
+        && scanner.scan(in, size.m_value))
+      return true;
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  in.setFilePointer(start_pos, seek_beginning);
+
+  return false;
+}
+
+static void
+show_progress(mm_io_c &in,
+              int64_t file_size) {
+  if (0 != verbose)
+    return;
+
+  auto current_percentage = in.getFilePointer() * 100 / file_size;
+
+  if (g_gui_mode)
+    mxinfo(boost::format("#GUI#progress %1%%%\n") % current_percentage);
+  else
+    mxinfo(boost::format(Y("Progress: %1%%%%2%")) % current_percentage % "\r");
+}
+
 static void
 close_extractors() {
   size_t i;
 
+  // All frames must have been written before the files are finished.
+  for (auto const &worker : s_workers)
+    worker.second->finish();
+  s_workers.clear();
+
   for (i = 0; i < extractors.size(); i++)
     extractors[i]->finish_track();
 
@@ -345,10 +528,15 @@ handle_segment_info(EbmlMaster *info,
 bool
 extract_tracks(const std::string &file_name,
                std::vector<track_spec_t> &tspecs,
-               kax_analyzer_c::parse_mode_e parse_mode) {
+               kax_analyzer_c::parse_mode_e parse_mode,
+               extraction_range_c const &range,
+               bool threaded_writing) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
+  s_range            = range;
+  s_threaded_writing = threaded_writing;
+
   // open input file
   mm_io_cptr in;
   kax_file_cptr file;
@@ -423,7 +611,37 @@ extract_tracks(const std::string &file_name,
     KaxChapters all_chapters;
     KaxTags all_tags;
 
-    while ((l1 = file->read_next_level1_element())) {
+    // Jump to the cluster the cues list for the start of the range.
+    // This requires that the track headers have been read from the
+    // index already. Chapters and tags located in front of that
+    // cluster would be missed, therefore cue sheets need the whole
+    // file.
+    auto cuesheet_wanted = std::any_of(tspecs.begin(), tspecs.end(), [](track_spec_t const &tspec) { return tspec.extract_cuesheet; });
+
+    if (s_range.is_set() && analyzer && segment_info_found && tracks_found && !cuesheet_wanted) {
+      auto start_pos = s_range.find_start_position(*analyzer);
+      if (start_pos > in->getFilePointer())
+        in->setFilePointer(start_pos);
+    }
+
+    kax_block_scanner_c scanner;
+    scanner.set_track_filter([](uint64_t track_number) { return !!find_extractor(track_number); });
+
+    auto past_range_end = false;
+
+    while (!past_range_end) {
+      if (scan_next_cluster(*in, file_size, scanner)) {
+        show_progress(*in, file_size);
+        s_range.start_cluster();
+        handle_scanned_cluster(scanner, *file, tc_scale);
+
+        past_range_end = s_range.is_cluster_past_end();
+        continue;
+      }
+
+      if (!(l1 = file->read_next_level1_element()))
+        break;
+
       if (Is<KaxInfo>(l1) && !segment_info_found) {
         segment_info_found = true;
         handle_segment_info(static_cast<EbmlMaster *>(l1), file.get(), tc_scale);
@@ -437,14 +655,7 @@ extract_tracks(const std::string &file_name,
         show_element(l1, 1, Y("Cluster"));
         KaxCluster *cluster = static_cast<KaxCluster *>(l1);
 
-        if (0 == verbose) {
-          auto current_percentage = in->getFilePointer() * 100 / file_size;
-
-          if (g_gui_mode)
-            mxinfo(boost::format("#GUI#progress %1%%%\n") % current_percentage);
-          else
-            mxinfo(boost::format(Y("Progress: %1%%%%2%")) % current_percentage % "\r");
-        }
+        show_progress(*in, file_size);
 
         KaxClusterTimecode *ctc = FindChild<KaxClusterTimecode>(l1);
         if (ctc) {
@@ -457,6 +668,8 @@ extract_tracks(const std::string &file_name,
         size_t i;
         int64_t max_timecode = -1;
 
+        s_range.start_cluster();
+
         for (i = 0; cluster->ListSize() > i; ++i) {
           int64_t max_bg_timecode = -1;
           EbmlElement *el         = (*cluster)[i];
@@ -476,6 +689,8 @@ extract_tracks(const std::string &file_name,
         if (-1 != max_timecode)
           file->set_last_timecode(max_timecode);
 
+        past_range_end = s_range.is_cluster_past_end();
+
       } else if (Is<KaxChapters>(l1)) {
         KaxChapters &chapters = *static_cast<KaxChapters *>(l1);
 
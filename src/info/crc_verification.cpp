@@ -0,0 +1,304 @@
+/*
+   mkvinfo -- info tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   verifying the CRC-32 elements of level 1 elements
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <ebml/EbmlCrc32.h>
+#include <matroska/KaxAttachments.h>
+#include <matroska/KaxChapters.h>
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxCues.h>
+#include <matroska/KaxInfo.h>
+#include <matroska/KaxSeekHead.h>
+#include <matroska/KaxSegment.h>
+#include <matroska/KaxTags.h>
+#include <matroska/KaxTracks.h>
+
+#include "common/checksums/base.h"
+#include "common/ebml.h"
+#include "common/endian.h"
+#include "common/mm_io_x.h"
+#include "common/thread_pool.h"
+#include "common/vint.h"
+#include "info/crc_verification.h"
+#include "info/mkvinfo.h"
+
+using namespace libebml;
+using namespace libmatroska;
+
+namespace {
+
+struct checksummed_element_t {
+  uint64_t m_position{}, m_content_start{}, m_content_end{};
+  uint32_t m_id{}, m_stored_crc{}, m_calculated_crc{};
+  bool m_read_error{};
+};
+
+std::size_t const s_read_chunk_size = 4 * 1024 * 1024;
+debugging_option_c s_debug{"verify_crc"};
+
+std::string
+get_element_name(uint32_t id) {
+  static std::unordered_map<uint32_t, std::string> s_names;
+
+  if (s_names.empty()) {
+    s_names[EBML_ID_VALUE(EBML_ID(KaxSegment))]     = Y("segment");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxCluster))]     = Y("cluster");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxCues))]        = Y("cues");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxSeekHead))]    = Y("seek head");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxInfo))]        = Y("segment information");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxTracks))]      = Y("tracks");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxChapters))]    = Y("chapters");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxTags))]        = Y("tags");
+    s_names[EBML_ID_VALUE(EBML_ID(KaxAttachments))] = Y("attachments");
+  }
+
+  auto name = s_names.find(id);
+  return name != s_names.end() ? name->second : (boost::format(Y("element with ID 0x%|1$x|")) % id).str();
+}
+
+std::string
+format_position(uint64_t position) {
+  return (boost::format(g_options.m_hex_positions ? "0x%|1$x|" : "%1%") % position).str();
+}
+
+/* Collects the level 1 elements of all segments whose first child is
+   a CRC-32 element. Only the element headers and the CRC-32 elements
+   are read. Scanning stops at the first element that is invalid, that
+   extends beyond the end of its segment or that has an unknown size,
+   as the end of such an element can only be found by parsing its
+   content.
+
+   Returns \c false with a warning about the position scanning stopped
+   at if the whole file couldn't be scanned.
+*/
+bool
+find_checksummed_elements(mm_io_c &in,
+                          std::vector<checksummed_element_t> &elements,
+                          unsigned int &num_level1_elements) {
+  static auto const s_segment_id = EBML_ID_VALUE(EBML_ID(KaxSegment));
+  static auto const s_crc32_id   = EBML_ID_VALUE(EBML_ID(EbmlCrc32));
+
+  auto file_size      = static_cast<uint64_t>(in.get_size());
+  auto level0_start   = uint64_t{};
+  num_level1_elements = 0;
+
+  auto stop = [](uint64_t position, std::string const &reason) -> bool {
+    mxwarn(boost::format(Y("The file could not be checked completely. Checking stopped at position %1%: %2%\n")) % format_position(position) % reason);
+    return false;
+  };
+
+  try {
+    while (level0_start < file_size) {
+      in.setFilePointer(level0_start);
+
+      auto id   = vint_c::read_ebml_id(in);
+      auto size = vint_c::read(in);
+
+      if (!id.is_valid() || !size.is_valid())
+        return stop(level0_start, Y("invalid element ID or size."));
+
+      auto segment_start = in.getFilePointer();
+
+      if (!size.is_unknown() && ((segment_start + size.m_value) > file_size))
+        return stop(level0_start, (boost::format(Y("the %1% extends beyond the end of the file.")) % get_element_name(id.m_value)).str());
+
+      auto segment_end = size.is_unknown() ? file_size : segment_start + size.m_value;
+
+      if (id.m_value == s_segment_id) {
+        auto level1_start = segment_start;
+
+        while (level1_start < segment_end) {
+          in.setFilePointer(level1_start);
+
+          auto l1_id   = vint_c::read_ebml_id(in);
+          auto l1_size = vint_c::read(in);
+
+          if (!l1_id.is_valid() || !l1_size.is_valid())
+            return stop(level1_start, Y("invalid element ID or size."));
+
+          if (l1_size.is_unknown())
+            return stop(level1_start, (boost::format(Y("the %1% has an unknown size.")) % get_element_name(l1_id.m_value)).str());
+
+          auto content_start = in.getFilePointer();
+          auto content_end   = content_start + l1_size.m_value;
+
+          if (content_end > segment_end)
+            return stop(level1_start, (boost::format(Y("the %1% extends beyond the end of the segment.")) % get_element_name(l1_id.m_value)).str());
+
+          ++num_level1_elements;
+
+          auto child_id = vint_c::read_ebml_id(in);
+          if (child_id.is_valid() && (child_id.m_value == s_crc32_id)) {
+            auto child_size = vint_c::read(in);
+
+            if (child_size.is_valid() && (child_size.m_value == 4)) {
+              checksummed_element_t element;
+
+              element.m_position      = level1_start;
+              element.m_id            = l1_id.m_value;
+              element.m_stored_crc    = in.read_uint32_le();
+              element.m_content_start = in.getFilePointer();
+              element.m_content_end   = content_end;
+
+              if (element.m_content_start <= content_end)
+                elements.push_back(element);
+            }
+          }
+
+          level1_start = content_end;
+        }
+
+      } else if (size.is_unknown())
+        return stop(level0_start, (boost::format(Y("the %1% has an unknown size.")) % get_element_name(id.m_value)).str());
+
+      level0_start = segment_end;
+    }
+
+  } catch (mtx::mm_io::exception &ex) {
+    return stop(in.getFilePointer(), (boost::format(Y("reading failed (%1%).")) % ex).str());
+  }
+
+  return true;
+}
+
+void
+verify_region(std::string const &file_name,
+              std::vector<checksummed_element_t>::iterator begin,
+              std::vector<checksummed_element_t>::iterator end) {
+  mm_io_cptr in;
+
+  try {
+    in = mm_file_io_c::open(file_name);
+
+  } catch (mtx::mm_io::exception &) {
+    for (auto element = begin; element != end; ++element)
+      element->m_read_error = true;
+    return;
+  }
+
+  auto buffer = memory_c::alloc(s_read_chunk_size);
+
+  for (auto element = begin; element != end; ++element) {
+    auto worker    = mtx::checksum::for_algorithm(mtx::checksum::algorithm_e::crc32_ieee_le, 0xffffffff);
+    auto remaining = element->m_content_end - element->m_content_start;
+
+    try {
+      in->setFilePointer(element->m_content_start);
+
+      while (remaining) {
+        auto to_read = std::min<uint64_t>(remaining, s_read_chunk_size);
+        if (in->read(buffer, to_read) != to_read)
+          throw mtx::mm_io::end_of_file_x{};
+
+        worker->add(buffer->get_buffer(), to_read);
+        remaining -= to_read;
+      }
+
+      worker->finish();
+      element->m_calculated_crc = dynamic_cast<mtx::checksum::uint_result_c &>(*worker).get_result_as_uint() ^ 0xffffffff;
+
+    } catch (mtx::mm_io::exception &) {
+      element->m_read_error = true;
+    }
+  }
+}
+
+/* Splits the elements into one region of consecutive elements per
+   thread, each covering roughly the same number of bytes. Each thread
+   reads its region with its own file handle.
+*/
+void
+verify_in_parallel(std::string const &file_name,
+                   std::vector<checksummed_element_t> &elements) {
+  auto total_size  = boost::accumulate(elements, uint64_t{}, [](uint64_t sum, checksummed_element_t const &element) { return sum + element.m_content_end - element.m_content_start; });
+  auto num_threads = std::max<std::size_t>(std::min<std::size_t>(std::thread::hardware_concurrency(), elements.size()), 1);
+  auto region_size = total_size / num_threads + 1;
+
+  thread_pool_c pool{static_cast<unsigned int>(num_threads)};
+  std::vector<std::future<void>> results;
+
+  auto region_start = elements.begin();
+  auto bytes        = uint64_t{};
+
+  for (auto element = elements.begin(); element != elements.end(); ++element) {
+    bytes += element->m_content_end - element->m_content_start;
+
+    if ((bytes < region_size) && ((element + 1) != elements.end()))
+      continue;
+
+    mxdebug_if(s_debug, boost::format("verify_crc: region from %1% to %2% with %3% elements\n") % region_start->m_position % element->m_content_end % (element + 1 - region_start));
+
+    results.emplace_back(pool.submit([&file_name, region_start, element]() { verify_region(file_name, region_start, element + 1); }));
+
+    region_start = element + 1;
+    bytes        = 0;
+  }
+
+  for (auto &result : results)
+    result.get();
+}
+
+}
+
+/** \brief Verifies the CRC-32 elements of all level 1 elements
+
+   Level 1 elements such as clusters may start with a CRC-32 element
+   covering the rest of their content. The content of all level 1
+   elements with such a CRC-32 element is read in parallel across
+   several regions of the file, and each mismatch is reported with the
+   element's position.
+
+   Returns \c false if at least one element is damaged or if the file
+   couldn't be scanned completely, e.g. because it is truncated.
+*/
+bool
+verify_crc32_elements(std::string const &file_name) {
+  std::vector<checksummed_element_t> elements;
+  auto num_level1_elements = 0u;
+  auto scanned_completely  = false;
+
+  try {
+    mm_file_io_c in{file_name};
+    scanned_completely = find_checksummed_elements(in, elements, num_level1_elements);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("Error: Couldn't open source file %1% (%2%).\n")) % file_name % ex);
+  }
+
+  if (elements.empty()) {
+    mxinfo(boost::format(Y("None of the %1% level 1 elements contains a CRC-32 element.\n")) % num_level1_elements);
+    return scanned_completely;
+  }
+
+  verify_in_parallel(file_name, elements);
+
+  auto num_damaged = 0u;
+
+  for (auto const &element : elements) {
+    if (element.m_read_error)
+      mxwarn(boost::format(Y("The %1% at position %2% could not be read completely.\n")) % get_element_name(element.m_id) % format_position(element.m_position));
+
+    else if (element.m_calculated_crc != element.m_stored_crc)
+      mxwarn(boost::format(Y("The %1% at position %2% is damaged: the stored CRC-32 is 0x%|3$08x| but the calculated one is 0x%|4$08x|.\n"))
+             % get_element_name(element.m_id) % format_position(element.m_position) % element.m_stored_crc % element.m_calculated_crc);
+
+    else
+      continue;
+
+    ++num_damaged;
+  }
+
+  mxinfo(boost::format(Y("%1% of %2% level 1 elements contain a CRC-32 element. %3% of them are damaged.\n")) % elements.size() % num_level1_elements % num_damaged);
+
+  return !num_damaged && scanned_completely;
+}
@@ -0,0 +1,20 @@
+/*
+   mkvinfo -- info tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for verifying the CRC-32 elements of level 1 elements
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_INFO_CRC_VERIFICATION_H
+#define MTX_INFO_CRC_VERIFICATION_H
+
+#include "common/common_pch.h"
+
+bool verify_crc32_elements(std::string const &file_name);
+
+#endif // MTX_INFO_CRC_VERIFICATION_H
@@ -46,6 +46,7 @@ info_cli_parser_c::init_parser() {
   OPT("X|full-hexdump",  set_full_hexdump,  YT("Show all bytes of each frame as a hex dump."));
   OPT("p|hex-positions", set_hex_positions, YT("Show positions in hexadecimal."));
   OPT("z|size",          set_size,          YT("Show the size of each element including its header."));
+  OPT("verify-crc",      set_verify_crc,    YT("Only verify the CRC-32 elements of all level 1 elements such as clusters and report the damaged ones."));
 
   add_common_options();
 
@@ -124,6 +125,11 @@ info_cli_parser_c::set_hex_positions() {
   m_options.m_hex_positions = true;
 }
 
+void
+info_cli_parser_c::set_verify_crc() {
+  m_options.m_verify_crc = true;
+}
+
 options_c
 info_cli_parser_c::run() {
   init_parser();
@@ -40,6 +40,7 @@ protected:
   void set_file_name();
   void set_track_info();
   void set_hex_positions();
+  void set_verify_crc();
 };
 
 #endif // MTX_INFO_INFO_CLI_PARSER_H
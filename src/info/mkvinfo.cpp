@@ -75,6 +75,7 @@
 #include "common/version.h"
 #include "common/xml/ebml_chapters_converter.h"
 #include "common/xml/ebml_tags_converter.h"
+#include "info/crc_verification.h"
 #include "info/mkvinfo.h"
 #include "info/info_cli_parser.h"
 
@@ -1862,6 +1863,9 @@ console_main() {
   if (g_options.m_file_name.empty())
     mxerror(Y("No file name given.\n"));
 
+  if (g_options.m_verify_crc)
+    return verify_crc32_elements(g_options.m_file_name) ? 0 : 1;
+
   return process_file(g_options.m_file_name.c_str()) ? 0 : 1;
 }
 
@@ -31,6 +31,8 @@
 #include <matroska/KaxCluster.h>
 #include <matroska/KaxClusterData.h>
 #include <matroska/KaxContexts.h>
+#include <matroska/KaxCues.h>
+#include <matroska/KaxCuesData.h>
 #include <matroska/KaxInfo.h>
 #include <matroska/KaxInfoData.h>
 #include <matroska/KaxSeekHead.h>
@@ -65,6 +67,7 @@
 #include "merge/file_status.h"
 #include "merge/input_x.h"
 #include "merge/output_control.h"
+#include "merge/split_jobs.h"
 #include "output/p_aac.h"
 #include "output/p_ac3.h"
 #include "output/p_alac.h"
@@ -325,6 +328,7 @@ kax_reader_c::init_l1_position_storage(deferred_positions_t &storage) {
   storage[dl1t_tags]        = std::vector<int64_t>();
   storage[dl1t_tracks]      = std::vector<int64_t>();
   storage[dl1t_seek_head]   = std::vector<int64_t>();
+  storage[dl1t_cues]        = std::vector<int64_t>();
 }
 
 bool
@@ -1359,6 +1363,7 @@ kax_reader_c::handle_seek_head(mm_io_c *io,
         :                       Is<KaxTracks>(id)      ? dl1t_tracks
         :                       Is<KaxSeekHead>(id)    ? dl1t_seek_head
         :                       Is<KaxInfo>(id)        ? dl1t_info
+        :                       Is<KaxCues>(id)        ? dl1t_cues
         :                                                dl1t_unknown;
 
       if (dl1t_unknown == type)
@@ -1410,6 +1415,7 @@ kax_reader_c::find_level1_elements_via_analyzer() {
     analyzer->with_elements(EBML_ID(KaxAttachments), [this](kax_analyzer_data_c const &data) { m_deferred_l1_positions[dl1t_attachments].push_back(data.m_pos); });
     analyzer->with_elements(EBML_ID(KaxChapters),    [this](kax_analyzer_data_c const &data) { m_deferred_l1_positions[dl1t_chapters   ].push_back(data.m_pos); });
     analyzer->with_elements(EBML_ID(KaxTags),        [this](kax_analyzer_data_c const &data) { m_deferred_l1_positions[dl1t_tags       ].push_back(data.m_pos); });
+    analyzer->with_elements(EBML_ID(KaxCues),        [this](kax_analyzer_data_c const &data) { m_deferred_l1_positions[dl1t_cues       ].push_back(data.m_pos); });
 
   } catch (...) {
   }
@@ -1478,6 +1484,7 @@ kax_reader_c::read_headers_internal() {
     }
 
     m_in_file->set_segment_end(*l0);
+    m_segment_data_start_pos = static_cast<KaxSegment *>(l0)->GetGlobalPosition(0);
 
     // We've got our segment, so let's find the m_tracks
     m_tc_scale = TIMECODE_SCALE;
@@ -1502,6 +1509,9 @@ kax_reader_c::read_headers_internal() {
       else if (Is<KaxTags>(*l1))
         m_deferred_l1_positions[dl1t_tags].push_back(l1->GetElementPosition());
 
+      else if (Is<KaxCues>(*l1))
+        m_deferred_l1_positions[dl1t_cues].push_back(l1->GetElementPosition());
+
       else if (Is<KaxSeekHead>(*l1))
         handle_seek_head(m_in.get(), l0, l1->GetElementPosition());
 
@@ -2178,6 +2188,9 @@ kax_reader_c::read(generic_packetizer_c *requested_ptzr,
       return FILE_STATUS_HOLDING;
   }
 
+  if (!m_split_job_start_handled)
+    seek_to_split_job_start();
+
   try {
     KaxCluster *cluster = m_in_file->read_next_cluster();
     if (!cluster) {
@@ -2556,6 +2569,121 @@ kax_reader_c::determine_minimum_timestamps() {
   }
 }
 
+void
+kax_reader_c::read_cue_cluster_positions(int64_t position,
+                                         std::unordered_set<uint64_t> const &track_numbers,
+                                         std::vector<std::pair<int64_t, uint64_t>> &cluster_positions) {
+  m_in->save_pos(position);
+  at_scope_exit_c restore([this]() { m_in->restore_pos(); });
+
+  int upper_lvl_el = 0;
+  std::shared_ptr<EbmlElement> l1(m_es->FindNextElement(EBML_CLASS_CONTEXT(KaxSegment), upper_lvl_el, 0xFFFFFFFFL, true));
+  auto cues = dynamic_cast<KaxCues *>(l1.get());
+
+  if (!cues)
+    return;
+
+  EbmlElement *l2 = nullptr;
+  upper_lvl_el    = 0;
+
+  cues->Read(*m_es, EBML_CLASS_CONTEXT(KaxCues), upper_lvl_el, l2, true);
+
+  for (auto const &elt : *cues) {
+    auto kcue_point = dynamic_cast<KaxCuePoint *>(elt);
+    if (!kcue_point)
+      continue;
+
+    auto ktime = FindChild<KaxCueTime>(*kcue_point);
+    if (!ktime)
+      continue;
+
+    auto timestamp = static_cast<int64_t>(ktime->GetValue() * m_tc_scale) + m_global_timestamp_offset;
+
+    for (auto const &child : *kcue_point) {
+      auto ktrack_pos   = dynamic_cast<KaxCueTrackPositions *>(child);
+      auto kcluster_pos = ktrack_pos ? FindChild<KaxCueClusterPosition>(*ktrack_pos) : nullptr;
+
+      if (kcluster_pos && track_numbers.count(FindChildValue<KaxCueTrack>(*ktrack_pos)))
+        cluster_positions.emplace_back(timestamp, kcluster_pos->GetValue());
+    }
+  }
+}
+
+/** \brief Skips the clusters in front of the range a split job keeps
+
+   A process started for \c --split-jobs discards everything in front
+   of its first range. Instead of reading all of that the reader
+   starts at a cluster found via the cues. It goes back one cue point
+   further than the last one in front of the range's start: the core
+   derives the destination file's timestamp offset from the frames
+   preceding the first key frame kept, and they must be the same as
+   when reading from the start.
+*/
+void
+kax_reader_c::seek_to_split_job_start() {
+  static debugging_option_c s_debug{"kax_reader_split_job|split_jobs"};
+
+  m_split_job_start_handled = true;
+
+  auto start = get_split_job_seek_timestamp();
+  if (!start.valid() || m_deferred_l1_positions[dl1t_cues].empty())
+    return;
+
+  // Which cue points precede the start isn't known if the timestamps
+  // are modified.
+  if (!m_ti.m_timecode_syncs.empty() || !m_ti.m_all_ext_timecodes.empty())
+    return;
+
+  std::unordered_set<uint64_t> track_numbers;
+
+  for (auto const &track : m_tracks)
+    if ((-1 != track->ptzr) && ('v' == track->type))
+      track_numbers.insert(track->track_number);
+
+  if (track_numbers.empty())
+    for (auto const &track : m_tracks)
+      if (-1 != track->ptzr)
+        track_numbers.insert(track->track_number);
+
+  std::vector<std::pair<int64_t, uint64_t>> cluster_positions;
+
+  try {
+    for (auto position : m_deferred_l1_positions[dl1t_cues])
+      read_cue_cluster_positions(position, track_numbers, cluster_positions);
+
+    brng::sort(cluster_positions);
+
+    auto after_start = std::upper_bound(cluster_positions.begin(), cluster_positions.end(), std::make_pair(start.to_ns(), std::numeric_limits<uint64_t>::max()));
+    if (std::distance(cluster_positions.begin(), after_start) < 2) {
+      mxdebug_if(s_debug, boost::format("kax_reader: split job start %1%: not enough cue points in front of it\n") % start);
+      return;
+    }
+
+    auto const &target = *(after_start - 2);
+    auto position      = m_segment_data_start_pos + target.second;
+
+    if (position <= m_in->getFilePointer())
+      return;
+
+    // Make sure the cues point to a cluster before relying on them.
+    m_in->save_pos(position);
+    auto id = m_in->read_uint32_be();
+    m_in->restore_pos();
+
+    if (id != EBML_ID_VALUE(EBML_ID(KaxCluster))) {
+      mxdebug_if(s_debug, boost::format("kax_reader: split job start %1%: no cluster at %2%\n") % start % position);
+      return;
+    }
+
+    mxdebug_if(s_debug, boost::format("kax_reader: split job start %1%: starting at the cluster at %2% for cue point %3%\n") % start % position % format_timestamp(target.first));
+
+    m_in->setFilePointer(position);
+
+  } catch (...) {
+    mxdebug_if(s_debug, boost::format("kax_reader: split job start %1%: reading the cues failed\n") % start);
+  }
+}
+
 void
 kax_reader_c::determine_global_timestamp_offset_to_apply() {
   timestamp_c global_minimum_timestamp;
@@ -18,6 +18,7 @@
 #include "common/common_pch.h"
 
 #include <ctime>
+#include <unordered_set>
 
 #include "common/codec.h"
 #include "common/content_decoder.h"
@@ -203,6 +204,7 @@ private:
     dl1t_tracks,
     dl1t_seek_head,
     dl1t_info,
+    dl1t_cues,
   };
 
   std::vector<kax_track_cptr> m_tracks;
@@ -216,6 +218,8 @@ private:
   std::shared_ptr<EbmlStream> m_es;
 
   int64_t m_segment_duration, m_last_timecode, m_first_timecode, m_global_timestamp_offset;
+  uint64_t m_segment_data_start_pos{};
+  bool m_split_job_start_handled{};
   std::string m_title;
 
   using deferred_positions_t = std::map<deferred_l1_type_e, std::vector<int64_t> >;
@@ -336,6 +340,9 @@ protected:
 
   virtual void determine_minimum_timestamps();
   virtual void determine_global_timestamp_offset_to_apply();
+
+  virtual void seek_to_split_job_start();
+  virtual void read_cue_cluster_positions(int64_t position, std::unordered_set<uint64_t> const &track_numbers, std::vector<std::pair<int64_t, uint64_t>> &cluster_positions);
 };
 
 #endif  // MTX_INPUT_R_MATROSKA_H
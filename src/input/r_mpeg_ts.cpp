@@ -59,6 +59,9 @@
 
 #define TS_PACKET_SIZE     188
 #define TS_MAX_PACKET_SIZE 204
+#define TS_NUM_PIDS        8192
+
+#define TS_READ_CHUNK_SIZE (4 * 1024 * 1024)
 
 #define TS_PAT_PID         0x0000
 #define TS_SDT_PID         0x0011
@@ -948,6 +951,9 @@ file_t::file_t(mm_io_cptr const &in)
   , m_validate_pat_crc{true}
   , m_validate_pmt_crc{true}
   , m_has_audio_or_video_track{}
+  , m_packet_buffer_pos{}
+  , m_packet_buffer_fill{}
+  , m_packet_buffer_file_pos{}
 {
 }
 
@@ -975,6 +981,66 @@ file_t::all_pmts_found()
   return (0 != m_num_pmts_to_find) && (m_num_pmts_found >= m_num_pmts_to_find);
 }
 
+/** \brief Returns the next packet or \c nullptr if there isn't a complete one
+
+   The data is read in chunks of several MB which are a multiple of
+   the packet size. The pointer returned points into that chunk and
+   stays valid until the next call.
+*/
+unsigned char *
+file_t::read_next_packet() {
+  if ((m_packet_buffer_fill - m_packet_buffer_pos) < m_detected_packet_size) {
+    auto chunk_size = std::max<std::size_t>(TS_READ_CHUNK_SIZE / m_detected_packet_size, 1) * m_detected_packet_size;
+    auto remaining  = m_packet_buffer_fill - m_packet_buffer_pos;
+
+    if (!m_packet_buffer)
+      m_packet_buffer = memory_c::alloc(chunk_size);
+
+    else if (m_packet_buffer->get_size() != chunk_size)
+      m_packet_buffer->resize(chunk_size);
+
+    // Keep an incomplete packet at the end, e.g. after a resync.
+    auto buffer = m_packet_buffer->get_buffer();
+    if (remaining)
+      std::memmove(buffer, buffer + m_packet_buffer_pos, remaining);
+
+    m_packet_buffer_file_pos += m_packet_buffer_pos;
+    m_packet_buffer_pos       = 0;
+    m_packet_buffer_fill      = remaining + m_in->read(buffer + remaining, chunk_size - remaining);
+
+    if (m_packet_buffer_fill < m_detected_packet_size)
+      return nullptr;
+  }
+
+  auto packet           = m_packet_buffer->get_buffer() + m_packet_buffer_pos;
+  m_packet_buffer_pos  += m_detected_packet_size;
+
+  return packet;
+}
+
+/** \brief The position right after the last packet returned */
+uint64_t
+file_t::get_position()
+  const {
+  return m_packet_buffer_file_pos + m_packet_buffer_pos;
+}
+
+void
+file_t::set_position(uint64_t position) {
+  m_in->setFilePointer(position);
+  m_in->clear_eof();
+
+  m_packet_buffer_file_pos = position;
+  m_packet_buffer_pos      = 0;
+  m_packet_buffer_fill     = 0;
+}
+
+bool
+file_t::eof()
+  const {
+  return m_in->eof() && ((m_packet_buffer_fill - m_packet_buffer_pos) < m_detected_packet_size);
+}
+
 // ------------------------------------------------------------
 
 bool
@@ -1065,6 +1131,7 @@ reader_c::reader_c(const track_info_c &ti,
 void
 reader_c::setup_initial_tracks() {
   m_tracks.clear();
+  invalidate_pid_to_track_table();
 
   m_tracks.push_back(std::make_shared<track_c>(*this, pid_type_e::pat));
   m_tracks.push_back(std::make_shared<track_c>(*this, pid_type_e::sdt));
@@ -1089,18 +1156,17 @@ reader_c::read_headers_for_file(std::size_t file_num) {
     auto min_size_to_probe   = std::min<uint64_t>(size_to_probe, 5 * 1024 * 1024);
     f.m_detected_packet_size = detect_packet_size(f.m_in.get(), size_to_probe);
 
-    f.m_in->setFilePointer(0);
+    f.set_position(0);
 
     mxdebug_if(m_debug_headers, boost::format("read_headers: Starting to build PID list. (packet size: %1%)\n") % f.m_detected_packet_size);
 
-    unsigned char buf[TS_MAX_PACKET_SIZE]; // maximum TS packet size + 1
-
     while (true) {
-      if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
+      auto buf = f.read_next_packet();
+      if (!buf)
         break;
 
       if (buf[0] != 0x47) {
-        if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
+        if (resync(f.get_position() - f.m_detected_packet_size))
           continue;
         break;
       }
@@ -1110,10 +1176,10 @@ reader_c::read_headers_for_file(std::size_t file_num) {
       if (   f.m_pat_found
           && f.all_pmts_found()
           && (0 == f.m_es_to_process)
-          && (f.m_in->getFilePointer() >= min_size_to_probe))
+          && (f.get_position() >= min_size_to_probe))
         break;
 
-      auto eof = f.m_in->eof() || (f.m_in->getFilePointer() >= size_to_probe);
+      auto eof = f.eof() || (f.get_position() >= size_to_probe);
       if (!eof)
         continue;
 
@@ -1135,8 +1201,7 @@ reader_c::read_headers_for_file(std::size_t file_num) {
       } else
         break;
 
-      f.m_in->setFilePointer(0);
-      f.m_in->clear_eof();
+      f.set_position(0);
 
       setup_initial_tracks();
     }
@@ -1144,9 +1209,9 @@ reader_c::read_headers_for_file(std::size_t file_num) {
     mxdebug_if(m_debug_headers, boost::format("read_headers: caught exception\n"));
   }
 
-  mxdebug_if(m_debug_headers, boost::format("read_headers: Detection done on %1% bytes\n") % f.m_in->getFilePointer());
+  mxdebug_if(m_debug_headers, boost::format("read_headers: Detection done on %1% bytes\n") % f.get_position());
 
-  f.m_in->setFilePointer(0, seek_beginning); // rewind file for later remux
+  f.set_position(0); // rewind file for later remux
 
   // Run probe_packet_complete() for track-type detection once for
   // each track. This way tracks that don't actually need their
@@ -1165,6 +1230,7 @@ reader_c::read_headers() {
     read_headers_for_file(idx);
 
   m_tracks = std::move(m_all_probed_tracks);
+  invalidate_pid_to_track_table();
 
   for (std::size_t idx = 0, num_files = m_files.size(); idx < num_files; ++idx)
     parse_clip_info_file(idx);
@@ -1200,6 +1266,7 @@ reader_c::read_headers() {
   }
 
   m_tracks = std::move(identified_tracks);
+  invalidate_pid_to_track_table();
 
   show_demuxer_info();
 }
@@ -1211,6 +1278,8 @@ reader_c::reset_processing_state(processing_state_e new_state) {
 
   for (auto const &track : m_tracks)
     track->reset_processing_state();
+
+  invalidate_pid_to_track_table();
 }
 
 void
@@ -1219,20 +1288,18 @@ reader_c::determine_global_timestamp_offset() {
 
   auto &f = file();
 
-  f.m_in->setFilePointer(0);
-  f.m_in->clear_eof();
+  f.set_position(0);
 
   mxdebug_if(m_debug_headers, boost::format("determine_global_timestamp_offset: determining global timestamp offset from the first %1% bytes\n") % f.m_probe_range);
 
   try {
-    unsigned char buf[TS_MAX_PACKET_SIZE]; // maximum TS packet size + 1
-
-    while (f.m_in->getFilePointer() < f.m_probe_range) {
-      if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
+    while (f.get_position() < f.m_probe_range) {
+      auto buf = f.read_next_packet();
+      if (!buf)
         break;
 
       if (buf[0] != 0x47) {
-        if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
+        if (resync(f.get_position() - f.m_detected_packet_size))
           continue;
         break;
       }
@@ -1245,8 +1312,7 @@ reader_c::determine_global_timestamp_offset() {
 
   mxdebug_if(m_debug_headers, boost::format("determine_global_timestamp_offset: detection done; global timestamp offset is %1%\n") % f.m_global_timestamp_offset);
 
-  f.m_in->setFilePointer(0);
-  f.m_in->clear_eof();
+  f.set_position(0);
 
   reset_processing_state(processing_state_e::muxing);
 }
@@ -1449,6 +1515,7 @@ reader_c::parse_pat(track_c &track) {
     pmt->set_pid(tmp_pid);
 
     m_tracks.push_back(pmt);
+    invalidate_pid_to_track_table();
   }
 
   mxdebug_if(m_debug_pat_pmt, boost::format("parse_pat: number of PMTs to find: %1%\n") % f.m_num_pmts_to_find);
@@ -1536,6 +1603,8 @@ reader_c::parse_pmt_pid_info(mm_mem_io_c &mem,
 
     brng::copy(track->m_coupled_tracks, std::back_inserter(m_tracks));
     f.m_es_to_process += track->m_coupled_tracks.size();
+
+    invalidate_pid_to_track_table();
   }
 
   mxdebug_if(m_debug_pat_pmt,
@@ -1853,7 +1922,7 @@ reader_c::parse_pes(track_c &track) {
   }
 
   if (m_debug_packet) {
-    mxdebug(boost::format("parse_pes: PES info at file position %1% (file num %2%):\n") % (f.m_in->getFilePointer() - f.m_detected_packet_size) % track.m_file_num);
+    mxdebug(boost::format("parse_pes: PES info at file position %1% (file num %2%):\n") % (f.get_position() - f.m_detected_packet_size) % track.m_file_num);
     mxdebug(boost::format("parse_pes:    stream_id = %1% PID = %2%\n") % static_cast<unsigned int>(pes_header->stream_id) % track.pid);
     mxdebug(boost::format("parse_pes:    PES_packet_length = %1%, PES_header_data_length = %2%, data starts at %3%\n") % pes_size % static_cast<unsigned int>(pes_header->pes_header_data_length) % to_skip);
     mxdebug(boost::format("parse_pes:    PTS? %1% (%5% processed %6%) DTS? (%7% processed %8%) %2% ESCR = %3% ES_rate = %4%\n")
@@ -1869,7 +1938,7 @@ reader_c::parse_pes(track_c &track) {
     if (   mtx::included_in(track.type, pid_type_e::audio, pid_type_e::video)
         && (   !f.m_global_timestamp_offset.valid()
             || (dts < f.m_global_timestamp_offset))) {
-      mxdebug_if(m_debug_headers, boost::format("new global timestamp offset %1% prior %2% file position afterwards %3%\n") % dts % f.m_global_timestamp_offset % f.m_in->getFilePointer());
+      mxdebug_if(m_debug_headers, boost::format("new global timestamp offset %1% prior %2% file position afterwards %3%\n") % dts % f.m_global_timestamp_offset % f.get_position());
       f.m_global_timestamp_offset = dts;
     }
 
@@ -1912,6 +1981,8 @@ reader_c::handle_packet_for_pid_not_listed_in_pmt(uint16_t pid) {
   m_tracks.push_back(track);
   ++f.m_es_to_process;
 
+  invalidate_pid_to_track_table();
+
   return track;
 }
 
@@ -1921,7 +1992,7 @@ reader_c::parse_packet(unsigned char *buf) {
   auto track = find_track_for_pid(hdr->get_pid());
 
   if (!track)
-    track = handle_packet_for_pid_not_listed_in_pmt(hdr->get_pid());
+    track = handle_packet_for_pid_not_listed_in_pmt(hdr->get_pid()).get();
 
   if (   hdr->has_transport_error() // corrupted packet
       || !hdr->has_payload()        // no ts_payload
@@ -2117,6 +2188,8 @@ reader_c::probe_packet_complete(track_c &track) {
     if (m_tracks.end() != it)
       m_tracks.erase(it);
 
+    invalidate_pid_to_track_table();
+
   } else {
     auto &f         = file();
     track.processed = true;
@@ -2196,6 +2269,8 @@ reader_c::create_packetizer(int64_t id) {
 
     m_files[track->m_file_num]->m_packetizers.push_back(ptzr);
 
+    invalidate_pid_to_track_table();
+
     show_packetizer_info(id, ptzr);
   }
 }
@@ -2335,6 +2410,7 @@ reader_c::finish() {
   }
 
   file().m_file_done = true;
+  file().m_packet_buffer.reset();
 
   return FILE_STATUS_DONE;
 }
@@ -2362,14 +2438,13 @@ reader_c::read(generic_packetizer_c *requested_ptzr,
 
   f.m_packet_sent_to_packetizer = false;
 
-  unsigned char buf[TS_MAX_PACKET_SIZE + 1];
-
   while (!f.m_packet_sent_to_packetizer) {
-    if (f.m_in->read(buf, f.m_detected_packet_size) != static_cast<unsigned int>(f.m_detected_packet_size))
+    auto buf = f.read_next_packet();
+    if (!buf)
       return finish();
 
     if (buf[0] != 0x47) {
-      if (resync(f.m_in->getFilePointer() - f.m_detected_packet_size))
+      if (resync(f.get_position() - f.m_detected_packet_size))
         continue;
       return finish();
     }
@@ -2480,7 +2555,7 @@ reader_c::resync(int64_t start_at) {
 
       mxdebug_if(m_debug_resync, boost::format("resync: Re-established at %1%\n") % curr_pos);
 
-      f.m_in->setFilePointer(curr_pos);
+      f.set_position(curr_pos);
       return true;
     }
 
@@ -2491,27 +2566,51 @@ reader_c::resync(int64_t start_at) {
   return false;
 }
 
-track_ptr
-reader_c::find_track_for_pid(uint16_t pid)
-  const {
+track_c *
+reader_c::find_track_for_pid(uint16_t pid) {
+  if (!m_pid_to_track_table_file || (*m_pid_to_track_table_file != m_current_file))
+    build_pid_to_track_table();
+
+  return m_pid_to_track_table[pid].get();
+}
+
+void
+reader_c::build_pid_to_track_table() {
   auto &f = *m_files[m_current_file];
 
+  m_pid_to_track_table.assign(TS_NUM_PIDS, track_ptr{});
+  m_pid_to_track_table_file = m_current_file;
+
+  // The first track found for a PID wins.
   for (auto const &track : m_tracks) {
     if (   (track->m_file_num != m_current_file)
-        || (track->pid        != pid))
+        || (track->pid        >= TS_NUM_PIDS)
+        || m_pid_to_track_table[track->pid])
       continue;
 
+    auto &entry = m_pid_to_track_table[track->pid];
+    entry       = track;
+
     if (track->has_packetizer() || mtx::included_in(f.m_state, processing_state_e::probing, processing_state_e::determining_timestamp_offset))
-      return track;
+      continue;
 
     for (auto const &coupled_track : track->m_coupled_tracks)
-      if (coupled_track->has_packetizer())
-        return coupled_track;
-
-    return track;
+      if (coupled_track->has_packetizer()) {
+        entry = coupled_track;
+        break;
+      }
   }
+}
 
-  return {};
+/** \brief Marks the PID to track table as outdated
+
+   Must be called whenever the list of tracks, their packetizers or
+   the processing state change. The table is rebuilt lazily on the
+   next lookup. Until then it keeps the tracks it refers to alive.
+*/
+void
+reader_c::invalidate_pid_to_track_table() {
+  m_pid_to_track_table_file.reset();
 }
 
 std::pair<unsigned char *, std::size_t>
@@ -389,7 +389,6 @@ public:
 struct file_t {
   mm_io_cptr m_in;
 
-  std::unordered_map<uint16_t, track_ptr> m_pid_to_track_map;
   std::unordered_map<uint16_t, bool> m_ignored_pids, m_pmt_pid_seen;
   std::vector<generic_packetizer_c *> m_packetizers;
   std::vector<program_t> m_programs;
@@ -407,11 +406,21 @@ struct file_t {
   unsigned int m_detected_packet_size, m_num_pat_crc_errors, m_num_pmt_crc_errors;
   bool m_validate_pat_crc, m_validate_pmt_crc, m_has_audio_or_video_track;
 
+  // Packets are read from m_in in large chunks and parsed in place.
+  memory_cptr m_packet_buffer;
+  std::size_t m_packet_buffer_pos, m_packet_buffer_fill;
+  uint64_t m_packet_buffer_file_pos;
+
   file_t(mm_io_cptr const &in);
 
   int64_t get_queued_bytes() const;
   void reset_processing_state(processing_state_e new_state);
   bool all_pmts_found() const;
+
+  unsigned char *read_next_packet();
+  uint64_t get_position() const;
+  void set_position(uint64_t position);
+  bool eof() const;
 };
 using file_cptr = std::shared_ptr<file_t>;
 
@@ -423,6 +432,11 @@ protected:
   std::vector<track_ptr> m_tracks, m_all_probed_tracks;
   std::map<generic_packetizer_c *, track_ptr> m_ptzr_to_track_map;
 
+  // Indexed by PID; only valid for the file stored in
+  // m_pid_to_track_table_file.
+  std::vector<track_ptr> m_pid_to_track_table;
+  boost::optional<std::size_t> m_pid_to_track_table_file;
+
   std::vector<timestamp_c> m_chapter_timestamps;
 
   debugging_option_c m_dont_use_audio_pts, m_debug_resync, m_debug_pat_pmt, m_debug_sdt, m_debug_headers, m_debug_packet, m_debug_aac, m_debug_timestamp_wrapping, m_debug_clpi, m_debug_mpls;
@@ -455,7 +469,9 @@ public:
 private:
   void read_headers_for_file(std::size_t file_num);
 
-  track_ptr find_track_for_pid(uint16_t pid) const;
+  track_c *find_track_for_pid(uint16_t pid);
+  void build_pid_to_track_table();
+  void invalidate_pid_to_track_table();
   std::pair<unsigned char *, std::size_t> determine_ts_payload_start(packet_header_t *hdr) const;
   void setup_initial_tracks();
 
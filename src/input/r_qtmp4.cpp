@@ -32,6 +32,7 @@
 #include "common/iso639.h"
 #include "common/list_utils.h"
 #include "common/math.h"
+#include "common/mm_io_x.h"
 #include "common/mp3.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
@@ -59,6 +60,13 @@ using namespace libmatroska;
 
 #define MAX_INTERLEAVING_BADNESS 0.4
 
+// Samples closer to each other than this are read together.
+#define COALESCED_READ_MAX_GAP     (64 * 1024)
+#define COALESCED_READ_MAX_SIZE    (4 * 1024 * 1024)
+// The amount of data read ahead for tracks other than the one being
+// asked for. Beyond that samples are read one by one again.
+#define COALESCED_READ_MAX_PENDING (64 * 1024 * 1024)
+
 namespace mtx {
 
 class atom_chunk_size_x: public exception {
@@ -162,12 +170,16 @@ qtmp4_reader_c::qtmp4_reader_c(const track_info_c &ti,
   , m_fragment{}
   , m_track_for_fragment{}
   , m_timecodes_calculated{}
+  , m_coalesce_reads{}
+  , m_coalesced_read_tracks_selected{}
+  , m_pending_read_bytes{}
   , m_debug_chapters{    "qtmp4|qtmp4_full|qtmp4_chapters"}
   , m_debug_headers{     "qtmp4|qtmp4_full|qtmp4_headers"}
   , m_debug_tables{            "qtmp4_full|qtmp4_tables|qtmp4_tables_full"}
   , m_debug_tables_full{                               "qtmp4_tables_full"}
   , m_debug_interleaving{"qtmp4|qtmp4_full|qtmp4_interleaving"}
   , m_debug_resync{      "qtmp4|qtmp4_full|qtmp4_resync"}
+  , m_debug_reads{             "qtmp4_full|qtmp4_reads"}
 {
 }
 
@@ -368,6 +380,7 @@ qtmp4_reader_c::calculate_timecodes() {
   for (auto &dmx : m_demuxers) {
     dmx->calculate_frame_rate();
     dmx->calculate_timecodes();
+    dmx->release_tables();
   }
 
   auto min_timecode = calculate_global_min_timecode();
@@ -869,8 +882,32 @@ qtmp4_reader_c::handle_trun_atom(qt_atom_t,
   auto first_sample_flags = flags & QTMP4_TRUN_FIRST_SAMPLE_FLAGS ? m_in->read_uint32_be() : m_fragment->sample_flags;
   auto offset             = m_fragment->base_data_offset + data_offset;
 
-  std::vector<uint32_t> all_sample_flags;
-  std::vector<bool> all_keyframe_flags;
+  // The samples of a run are stored back to back. With a variable
+  // sample size they can therefore share a single chunk; the sample
+  // positions are derived from the sizes in update_tables().
+  if (entries && !track.sample_size)
+    track.chunk_table.emplace_back(entries, offset);
+
+  // Durations and CTS offsets are stored run-length encoded. Each
+  // track's sample table is then the only table growing with each
+  // sample.
+  auto add_duration = [&track](uint32_t sample_duration) {
+    auto &table = track.durmap_table;
+    if (!table.empty() && (table.back().duration == sample_duration))
+      ++table.back().number;
+    else
+      table.emplace_back(1, sample_duration);
+  };
+
+  auto add_frame_offset = [&track](int64_t frame_offset) {
+    auto &table = track.raw_frame_offset_table;
+    if (!table.empty() && (table.back().offset == frame_offset))
+      ++table.back().count;
+    else
+      table.emplace_back(1, frame_offset);
+  };
+
+  std::vector<std::tuple<uint32_t, uint32_t, uint64_t, int64_t, bool, uint32_t>> debug_entries;
 
   for (auto idx = 0u; idx < entries; ++idx) {
     auto sample_duration = flags & QTMP4_TRUN_SAMPLE_DURATION   ? m_in->read_uint32_be() : m_fragment->sample_duration;
@@ -879,20 +916,23 @@ qtmp4_reader_c::handle_trun_atom(qt_atom_t,
     auto ctts_duration   = flags & QTMP4_TRUN_SAMPLE_CTS_OFFSET ? m_in->read_uint32_be() : 0;
     auto keyframe        = !track.is_video()                    ? true                   : !(sample_flags & (QTMP4_FRAG_SAMPLE_FLAG_IS_NON_SYNC | QTMP4_FRAG_SAMPLE_FLAG_DEPENDS_YES));
 
-    track.durmap_table.emplace_back(1, sample_duration);
+    add_duration(sample_duration);
+    add_frame_offset(mtx::math::to_signed(ctts_duration));
     track.sample_table.emplace_back(sample_size);
-    track.chunk_table.emplace_back(1, offset);
-    track.raw_frame_offset_table.emplace_back(1, mtx::math::to_signed(ctts_duration));
 
-    if (keyframe)
+    if (track.sample_size)
+      track.chunk_table.emplace_back(1, offset);
+
+    // An empty key frame table means that all frames are key frames.
+    if (keyframe && (track.is_video() || !track.keyframe_table.empty()))
       track.keyframe_table.emplace_back(track.num_frames_from_trun + 1);
 
+    if (m_debug_tables && (debug_entries.size() < (!m_debug_tables_full ? 20 : std::numeric_limits<std::size_t>::max())))
+      debug_entries.emplace_back(sample_duration, sample_size, offset, mtx::math::to_signed(ctts_duration), keyframe, sample_flags);
+
     offset += sample_size;
 
     track.num_frames_from_trun++;
-
-    all_sample_flags.emplace_back(sample_flags);
-    all_keyframe_flags.push_back(keyframe);
   }
 
   m_fragment->implicit_offset = offset;
@@ -903,24 +943,20 @@ qtmp4_reader_c::handle_trun_atom(qt_atom_t,
   if (!m_debug_tables)
     return;
 
-  auto fmt                = boost::format("%1%%2%: duration %3% size %4% data start %5% end %6% pts offset %7% key? %8% raw flags 0x%|9$08x|\n");
-  auto spc                = space((level + 2) * 2 + 1);
-  auto durmap_start       = track.durmap_table.size()           - entries;
-  auto sample_start       = track.sample_table.size()           - entries;
-  auto chunk_start        = track.chunk_table.size()            - entries;
-  auto frame_offset_start = track.raw_frame_offset_table.size() - entries;
-  auto end                = std::min<std::size_t>(!m_debug_tables_full ? 20 : std::numeric_limits<std::size_t>::max(), entries);
+  auto fmt = boost::format("%1%%2%: duration %3% size %4% data start %5% end %6% pts offset %7% key? %8% raw flags 0x%|9$08x|\n");
+  auto spc = space((level + 2) * 2 + 1);
+  auto idx = 0u;
 
-  for (auto idx = 0u; idx < end; ++idx)
+  for (auto const &entry : debug_entries)
     mxdebug(fmt
-            % spc % idx
-            % track.durmap_table[durmap_start + idx].duration
-            % track.sample_table[sample_start + idx].size
-            % track.chunk_table[chunk_start + idx].pos
-            % (track.sample_table[sample_start + idx].size + track.chunk_table[chunk_start + idx].pos)
-            % track.raw_frame_offset_table[frame_offset_start + idx].offset
-            % static_cast<unsigned int>(all_keyframe_flags[idx])
-            % all_sample_flags[idx]);
+            % spc % idx++
+            % std::get<0>(entry)
+            % std::get<1>(entry)
+            % std::get<2>(entry)
+            % (std::get<1>(entry) + std::get<2>(entry))
+            % std::get<3>(entry)
+            % static_cast<unsigned int>(std::get<4>(entry))
+            % std::get<5>(entry));
 }
 
 void
@@ -1563,37 +1599,34 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
  auto &dmx   = *m_demuxers[dmx_idx];
  auto &index = dmx.m_index[dmx.pos];
 
-  m_in->setFilePointer(index.file_pos);
-
-  int buffer_offset = 0;
   memory_cptr buffer;
 
+  try {
+    buffer = read_sample(dmx);
+
+  } catch (mtx::mm_io::end_of_file_x &) {
+    mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
+           % dmx.pos % dmx.m_index.size() % index.size % index.file_pos);
+    return flush_packetizers();
+  }
+
   if (   dmx.is_video()
       && !dmx.pos
       && dmx.codec.is(codec_c::type_e::V_MPEG4_P2)
       && dmx.esds_parsed
       && (dmx.esds.decoder_config)) {
-    buffer        = memory_c::alloc(index.size + dmx.esds.decoder_config->get_size());
-    buffer_offset = dmx.esds.decoder_config->get_size();
+    auto &decoder_config = dmx.esds.decoder_config;
+    auto frame           = memory_c::alloc(decoder_config->get_size() + buffer->get_size());
+
+    memcpy(frame->get_buffer(),                              decoder_config->get_buffer(), decoder_config->get_size());
+    memcpy(frame->get_buffer() + decoder_config->get_size(), buffer->get_buffer(),         buffer->get_size());
 
-    memcpy(buffer->get_buffer(), dmx.esds.decoder_config->get_buffer(), dmx.esds.decoder_config->get_size());
+    buffer = frame;
 
   } else if (   dmx.is_video()
              && dmx.codec.is(codec_c::type_e::V_PRORES)
-             && (index.size >= 8)) {
-    m_in->skip(8);
-    index.size -= 8;
-    buffer = memory_c::alloc(index.size);
-
-  } else {
-    buffer = memory_c::alloc(index.size);
-  }
-
-  if (m_in->read(buffer->get_buffer() + buffer_offset, index.size) != index.size) {
-    mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
-           % dmx.pos % dmx.m_index.size() % index.size % index.file_pos);
-    return flush_packetizers();
-  }
+             && (buffer->get_size() >= 8))
+    buffer = memory_c::slice(buffer, 8, buffer->get_size() - 8);
 
   auto duration = dmx.m_use_frame_rate_for_duration ? *dmx.m_use_frame_rate_for_duration : index.duration;
   PTZR(dmx.ptzr)->process(new packet_t(buffer, index.timecode, duration, index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
@@ -1605,6 +1638,178 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
   return flush_packetizers();
 }
 
+memory_cptr
+qtmp4_reader_c::read_sample(qtmp4_demuxer_c &dmx) {
+  if (m_coalesce_reads && dmx.m_pending_reads.empty())
+    read_coalesced(dmx);
+
+  if (!dmx.m_pending_reads.empty()) {
+    auto pending = std::move(dmx.m_pending_reads.front());
+    dmx.m_pending_reads.pop_front();
+
+    // The block stops counting as pending once all of its samples have
+    // been handed out.
+    if (1 == pending.block_size.use_count())
+      m_pending_read_bytes -= *pending.block_size;
+
+    return pending.data;
+  }
+
+  auto &index = dmx.m_index[dmx.pos];
+
+  m_in->setFilePointer(index.file_pos);
+
+  // Avoid reading into an intermediate buffer if the source is
+  // e.g. memory-mapped. Such views are read-only, but packetizers may
+  // modify the data in place (e.g. swapping bytes).
+  auto buffer = m_in->read_view(index.size);
+  buffer->grab();
+
+  return buffer;
+}
+
+/* Reads the next samples of all tracks in file order until the given
+   demuxer has data pending. Samples close to each other are read with
+   a single read; each track is handed views into that block. Returns
+   without data pending for the demuxer if too much data is pending for
+   the other tracks; the demuxer's sample is then read on its own.
+*/
+void
+qtmp4_reader_c::read_coalesced(qtmp4_demuxer_c &dmx) {
+  if (!m_coalesced_read_tracks_selected)
+    select_tracks_for_coalesced_reads();
+
+  // Reading ahead in file order never yields data for tracks whose
+  // samples aren't stored in ascending order.
+  if (!dmx.m_read_coalesced)
+    return;
+
+  // Each track's samples are stored in ascending order. The next
+  // sample in file order is therefore the first one not read yet of
+  // one of the tracks. Samples that have been read on their own in the
+  // meantime have advanced the track's position and are skipped that
+  // way.
+  std::vector<std::size_t> next_samples;
+  for (auto const &entry_dmx : m_demuxers)
+    next_samples.push_back(entry_dmx->pos + entry_dmx->m_pending_reads.size());
+
+  auto find_next = [this, &next_samples]() -> int {
+    auto found = -1;
+
+    for (auto dmx_idx = 0u; dmx_idx < m_demuxers.size(); ++dmx_idx) {
+      auto const &entry_dmx = *m_demuxers[dmx_idx];
+
+      if (!entry_dmx.m_read_coalesced || (next_samples[dmx_idx] >= entry_dmx.m_index.size()))
+        continue;
+
+      if ((-1 == found) || (entry_dmx.m_index[next_samples[dmx_idx]].file_pos < m_demuxers[found]->m_index[next_samples[found]].file_pos))
+        found = dmx_idx;
+    }
+
+    return found;
+  };
+
+  std::vector<std::pair<int, std::size_t>> samples;
+
+  while (m_coalesce_reads && dmx.m_pending_reads.empty()) {
+    auto dmx_idx = find_next();
+    if (-1 == dmx_idx)
+      return;
+
+    if (m_pending_read_bytes >= COALESCED_READ_MAX_PENDING) {
+      mxdebug_if(m_debug_reads, boost::format("Coalesced reads: too much data pending (%1%); reading sample %2% of track %3% on its own\n") % m_pending_read_bytes % dmx.pos % dmx.id);
+      return;
+    }
+
+    auto const &first = m_demuxers[dmx_idx]->m_index[next_samples[dmx_idx]];
+    auto start        = first.file_pos;
+    auto end          = start + first.size;
+
+    samples.clear();
+    samples.emplace_back(dmx_idx, next_samples[dmx_idx]++);
+
+    while (-1 != (dmx_idx = find_next())) {
+      auto const &index = m_demuxers[dmx_idx]->m_index[next_samples[dmx_idx]];
+      auto index_end    = std::max<int64_t>(end, index.file_pos + index.size);
+
+      if (((index.file_pos - end) > COALESCED_READ_MAX_GAP) || ((index_end - start) > COALESCED_READ_MAX_SIZE))
+        break;
+
+      end = index_end;
+      samples.emplace_back(dmx_idx, next_samples[dmx_idx]++);
+    }
+
+    memory_cptr block;
+
+    try {
+      m_in->setFilePointer(start);
+      block = m_in->read_view(end - start);
+
+    } catch (mtx::mm_io::exception &) {
+      // Let the sample-by-sample reading report the problem.
+      mxdebug_if(m_debug_reads, boost::format("Coalesced reads: reading %1% bytes at %2% failed; disabling coalesced reads\n") % (end - start) % start);
+      m_coalesce_reads = false;
+      return;
+    }
+
+    // A block read into a buffer of its own is writable, and the
+    // samples don't overlap. Packetizers can therefore be handed views
+    // into it. Views into memory-mapped files are read-only, though,
+    // and the samples are copied.
+    auto writable   = block->is_free();
+    auto block_size = std::make_shared<int64_t>(end - start);
+
+    if (writable)
+      m_pending_read_bytes += *block_size;
+
+    for (auto const &sample : samples) {
+      auto &sample_dmx  = *m_demuxers[sample.first];
+      auto const &index = sample_dmx.m_index[sample.second];
+
+      if (writable) {
+        sample_dmx.m_pending_reads.emplace_back(memory_c::slice(block, index.file_pos - start, index.size), block_size);
+        continue;
+      }
+
+      sample_dmx.m_pending_reads.emplace_back(memory_c::clone(block->get_buffer() + index.file_pos - start, index.size), std::make_shared<int64_t>(index.size));
+      m_pending_read_bytes += index.size;
+    }
+
+    mxdebug_if(m_debug_reads, boost::format("Coalesced reads: read %1% bytes at %2% for %3% samples; %4% bytes pending\n") % (end - start) % start % samples.size() % m_pending_read_bytes);
+  }
+}
+
+/* Determines the tracks whose samples are read in file order. Tracks
+   whose samples aren't stored in ascending order are left out; they're
+   always read sample by sample.
+*/
+void
+qtmp4_reader_c::select_tracks_for_coalesced_reads() {
+  m_coalesced_read_tracks_selected = true;
+  auto num_tracks                  = 0u;
+
+  for (auto &dmx : m_demuxers) {
+    if ((-1 == dmx->ptzr) || (dmx->pos >= dmx->m_index.size()))
+      continue;
+
+    if (!std::is_sorted(dmx->m_index.begin(), dmx->m_index.end(), [](qt_index_t const &a, qt_index_t const &b) { return a.file_pos < b.file_pos; })) {
+      mxdebug_if(m_debug_reads, boost::format("Coalesced reads: samples of track %1% are not stored in ascending order\n") % dmx->id);
+      continue;
+    }
+
+    dmx->m_read_coalesced = true;
+    ++num_tracks;
+  }
+
+  if (num_tracks < 2) {
+    mxdebug_if(m_debug_reads, boost::format("Coalesced reads: only %1% track(s) can be read in file order; disabling coalesced reads\n") % num_tracks);
+    m_coalesce_reads = false;
+    return;
+  }
+
+  mxdebug_if(m_debug_reads, boost::format("Coalesced reads: reading %1% tracks in file order\n") % num_tracks);
+}
+
 memory_cptr
 qtmp4_reader_c::create_bitmap_info_header(qtmp4_demuxer_c &dmx,
                                           const char *fourcc,
@@ -1883,10 +2088,11 @@ qtmp4_reader_c::get_progress() {
   if (-1 == m_main_dmx)
     return 100;
 
-  auto &dmx       = *m_demuxers[m_main_dmx];
-  auto max_chunks = (0 == dmx.sample_size) ? dmx.sample_table.size() : dmx.chunk_table.size();
+  auto &dmx = *m_demuxers[m_main_dmx];
+  if (dmx.m_index.empty())
+    return 100;
 
-  return 100 * dmx.pos / max_chunks;
+  return 100 * dmx.pos / dmx.m_index.size();
 }
 
 void
@@ -2006,13 +2212,18 @@ qtmp4_reader_c::detect_interleaving() {
 
   if (MAX_INTERLEAVING_BADNESS < badness)
     m_in->enable_buffering(false);
+
+  // Reading the samples of all tracks in file order avoids seeking back
+  // and forth between the tracks' chunks. For badly interleaved files
+  // the amount of data read ahead is limited; see read_coalesced().
+  m_coalesce_reads = !hack_engaged(ENGAGE_NO_QTMP4_COALESCED_READS);
 }
 
 // ----------------------------------------------------------------------
 
 void
 qtmp4_demuxer_c::calculate_frame_rate() {
-  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == frame_offset_table.size()))) {
+  if ((1 == durmap_table.size()) && (0 != durmap_table[0].duration) && ((0 != sample_size) || (0 == num_frame_offsets))) {
     // Constant frame_rate. Let's set the default duration.
     frame_rate.assign(time_scale, static_cast<int64_t>(durmap_table[0].duration));
     mxdebug_if(m_debug_frame_rate, boost::format("calculate_frame_rate: case 1: %1%/%2%\n") % frame_rate.numerator() % frame_rate.denominator());
@@ -2072,96 +2283,39 @@ qtmp4_demuxer_c::to_nsecs(int64_t value,
   return boost::rational_cast<int64_t>(int64_rational_c{value, time_scale_to_use ? *time_scale_to_use : time_scale} * int64_rational_c{1'000'000'000ll, 1});
 }
 
-void
-qtmp4_demuxer_c::calculate_timecodes_constant_sample_size() {
-  int const num_frame_offsets = frame_offset_table.size();
-  auto chunk_index            = 0;
-
-  for (auto const &chunk : chunk_table) {
-    auto frame_offset = chunk_index < num_frame_offsets ? frame_offset_table[chunk_index] : 0;
-
-    timecodes.push_back(to_nsecs(static_cast<uint64_t>(chunk.samples) * duration + frame_offset));
-    durations.push_back(to_nsecs(static_cast<uint64_t>(chunk.size)    * duration));
-    frame_indices.push_back(chunk_index);
-
-    ++chunk_index;
-  }
-}
-
-void
-qtmp4_demuxer_c::calculate_timecodes_variable_sample_size() {
-  auto const num_frame_offsets = frame_offset_table.size();
-  auto const num_samples       = sample_table.size();
-
-  std::vector<int64_t> timecodes_before_offsets;
-
-  timecodes.reserve(num_samples);
-  timecodes_before_offsets.reserve(num_samples);
-  durations.reserve(num_samples);
-  frame_indices.reserve(num_samples);
-
-  for (unsigned int frame = 0; num_samples > frame; ++frame) {
-    auto timecode = to_nsecs(sample_table[frame].pts);
-
-    frame_indices.push_back(frame);
-    timecodes_before_offsets.push_back(timecode);
-    timecodes.push_back(timecode + (frame < num_frame_offsets ? to_nsecs(frame_offset_table[frame]) : 0));
-  }
-
-  int64_t avg_duration = 0, num_good_frames = 0;
-
-  for (unsigned int frame = 0; num_samples > (frame + 1); ++frame) {
-    int64_t diff = timecodes_before_offsets[frame + 1] - timecodes_before_offsets[frame];
-
-    if (0 >= diff)
-      durations.push_back(0);
-    else {
-      ++num_good_frames;
-      avg_duration += diff;
-      durations.push_back(diff);
-    }
-  }
-
-  durations.push_back(0);
-
-  if (num_good_frames) {
-    avg_duration /= num_good_frames;
-    for (auto &duration : durations)
-      if (!duration)
-        duration = avg_duration;
-  }
-}
-
 void
 qtmp4_demuxer_c::calculate_timecodes() {
   if (m_timecodes_calculated)
     return;
 
-  if (0 != sample_size)
-    calculate_timecodes_constant_sample_size();
-  else
-    calculate_timecodes_variable_sample_size();
-
-  if (m_debug_tables) {
-    mxdebug(boost::format("Timestamps for track ID %1%:\n") % id);
-    auto fmt = boost::format("  %1%: pts %2%\n");
-    auto end = std::min<std::size_t>(!m_debug_tables_full ? 20 : std::numeric_limits<std::size_t>::max(), timecodes.size());
-
-    for (auto idx = 0u; idx < end; ++idx)
-      mxdebug(fmt % idx % format_timestamp(timecodes[idx]));
-  }
-
   build_index();
   apply_edit_list();
 
   m_timecodes_calculated = true;
 }
 
+/* Frees the tables the index has been built from once nothing needs
+   them anymore. For files with millions of samples they take up more
+   memory than the index itself.
+*/
 void
-qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
-  for (auto &timecode : timecodes)
-    timecode += delta;
+qtmp4_demuxer_c::release_tables() {
+  auto release = [](auto &table) {
+    table.clear();
+    table.shrink_to_fit();
+  };
+
+  release(sample_table);
+  release(chunk_table);
+  release(chunkmap_table);
+  release(durmap_table);
+  release(keyframe_table);
+  release(raw_frame_offset_table);
+  sample_to_group_tables.clear();
+}
 
+void
+qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
   for (auto &index : m_index)
     index.timecode += delta;
 }
@@ -2271,20 +2425,16 @@ qtmp4_demuxer_c::update_tables() {
     }
   }
 
-  // calc pts/dts offsets
-  for (j = 0; j < raw_frame_offset_table.size(); ++j) {
-    size_t k;
-
-    for (k = 0; k < raw_frame_offset_table[j].count; ++k)
-      frame_offset_table.push_back(raw_frame_offset_table[j].offset);
-  }
+  // The pts/dts offsets are applied from the run-length encoded table
+  // when the index is built.
+  num_frame_offsets = boost::accumulate(raw_frame_offset_table, uint64_t{}, [](uint64_t sum, qt_frame_offset_t const &entry) { return sum + entry.count; });
 
   m_tables_updated = true;
 
   if (!m_debug_tables)
     return true;
 
-  mxdebug(boost::format(" Frame offset table for track ID %1%: %2% entries\n")    % id % frame_offset_table.size());
+  mxdebug(boost::format(" Frame offset table for track ID %1%: %2% entries\n")    % id % num_frame_offsets);
   mxdebug(boost::format(" Sample table contents for track ID %1%: %2% entries\n") % id % sample_table.size());
 
   auto fmt = boost::format("   %1%: pts %2% size %3% pos %4%\n");
@@ -2402,6 +2552,15 @@ qtmp4_demuxer_c::build_index() {
   else
     build_index_chunk_mode();
 
+  if (m_debug_tables) {
+    mxdebug(boost::format("Timestamps for track ID %1%:\n") % id);
+    auto fmt = boost::format("  %1%: pts %2%\n");
+    auto end = std::min<std::size_t>(!m_debug_tables_full ? 20 : std::numeric_limits<std::size_t>::max(), m_index.size());
+
+    for (auto idx = 0u; idx < end; ++idx)
+      mxdebug(fmt % idx % format_timestamp(m_index[idx].timecode));
+  }
+
   mark_key_frames_from_key_frame_table();
   mark_open_gop_random_access_points_as_key_frames();
 
@@ -2418,15 +2577,18 @@ qtmp4_demuxer_c::build_index_constant_sample_size_mode() {
   auto v1_bytes_per_frame    = 1 == v0_audio_version ? get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame)    : 0;
   auto v1_samples_per_packet = 1 == v0_audio_version ? get_uint32_be(&sound_stsd_atom->v1.samples_per_packet) : 0;
 
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < chunk_table.size(); ++frame_idx) {
+  qt_frame_offset_cursor_c frame_offsets{raw_frame_offset_table};
+
+  m_index.reserve(chunk_table.size());
+
+  for (auto const &chunk : chunk_table) {
     uint64_t frame_size;
 
     if (1 != sample_size) {
-      frame_size = chunk_table[frame_idx].size * sample_size;
+      frame_size = chunk.size * sample_size;
 
     } else {
-      frame_size = chunk_table[frame_idx].size;
+      frame_size = chunk.size;
 
       if (is_audio) {
         if ((0 != v1_bytes_per_frame) && (0 != v1_samples_per_packet)) {
@@ -2437,18 +2599,43 @@ qtmp4_demuxer_c::build_index_constant_sample_size_mode() {
       }
     }
 
-    m_index.emplace_back(chunk_table[frame_idx].pos, frame_size, timecodes[frame_idx], durations[frame_idx], false);
+    auto timecode     = to_nsecs(static_cast<uint64_t>(chunk.samples) * duration + frame_offsets.next());
+    auto frame_length = to_nsecs(static_cast<uint64_t>(chunk.size)    * duration);
+
+    m_index.emplace_back(chunk.pos, frame_size, timecode, frame_length, false);
   }
 }
 
 void
 qtmp4_demuxer_c::build_index_chunk_mode() {
-  for (std::size_t frame_idx = 0, num_frames = frame_indices.size(); frame_idx < num_frames; ++frame_idx) {
-    auto act_frame_idx = frame_indices[frame_idx];
-    auto &sample       = sample_table[act_frame_idx];
+  qt_frame_offset_cursor_c frame_offsets{raw_frame_offset_table};
+  auto const num_samples = sample_table.size();
+  int64_t avg_duration   = 0, num_good_frames = 0;
 
-    m_index.emplace_back(sample.pos, sample.size, timecodes[frame_idx], durations[frame_idx], false);
+  m_index.reserve(num_samples);
+
+  for (auto frame_idx = 0u; frame_idx < num_samples; ++frame_idx) {
+    auto const &sample = sample_table[frame_idx];
+    auto timecode      = to_nsecs(sample.pts);
+    auto frame_length  = (frame_idx + 1) < num_samples ? to_nsecs(sample_table[frame_idx + 1].pts) - timecode : 0;
+
+    if (0 >= frame_length)
+      frame_length = 0;
+    else {
+      ++num_good_frames;
+      avg_duration += frame_length;
+    }
+
+    m_index.emplace_back(sample.pos, sample.size, timecode + to_nsecs(frame_offsets.next()), frame_length, false);
   }
+
+  if (!num_good_frames)
+    return;
+
+  avg_duration /= num_good_frames;
+  for (auto &index : m_index)
+    if (!index.duration)
+      index.duration = avg_duration;
 }
 
 void
@@ -139,30 +139,76 @@ struct qt_frame_offset_t {
   }
 };
 
+// Walks the run-length encoded frame offset table sample by sample
+// without expanding it.
+class qt_frame_offset_cursor_c {
+private:
+  std::vector<qt_frame_offset_t> const &m_table;
+  std::size_t m_entry_idx;
+  unsigned int m_num_used;
+
+public:
+  qt_frame_offset_cursor_c(std::vector<qt_frame_offset_t> const &table)
+    : m_table(table)
+    , m_entry_idx{}
+    , m_num_used{}
+  {
+  }
+
+  // Returns the next sample's offset or 0 once the table is exhausted.
+  int64_t next() {
+    while ((m_entry_idx < m_table.size()) && (m_num_used >= m_table[m_entry_idx].count)) {
+      ++m_entry_idx;
+      m_num_used = 0;
+    }
+
+    if (m_entry_idx >= m_table.size())
+      return 0;
+
+    ++m_num_used;
+    return m_table[m_entry_idx].offset;
+  }
+};
+
 struct qt_index_t {
-  int64_t file_pos, size;
-  int64_t timecode, duration;
-  bool    is_keyframe;
+  int64_t  file_pos;
+  int64_t  timecode, duration;
+  uint32_t size;
+  bool     is_keyframe;
 
   qt_index_t()
     : file_pos{}
-    , size{}
     , timecode{}
     , duration{}
+    , size{}
     , is_keyframe{}
   {
   };
 
-  qt_index_t(int64_t p_file_pos, int64_t p_size, int64_t p_timecode, int64_t p_duration, bool p_is_keyframe)
+  qt_index_t(int64_t p_file_pos, uint32_t p_size, int64_t p_timecode, int64_t p_duration, bool p_is_keyframe)
     : file_pos{p_file_pos}
-    , size{p_size}
     , timecode{p_timecode}
     , duration{p_duration}
+    , size{p_size}
     , is_keyframe{p_is_keyframe}
   {
   }
 };
 
+// A sample read as part of a coalesced read. The block it has been
+// read with counts as pending until all of its samples have been
+// handed out.
+struct qt_pending_read_t {
+  memory_cptr data;
+  std::shared_ptr<int64_t> block_size;
+
+  qt_pending_read_t(memory_cptr const &p_data, std::shared_ptr<int64_t> const &p_block_size)
+    : data{p_data}
+    , block_size{p_block_size}
+  {
+  }
+};
+
 struct qt_track_defaults_t {
   unsigned int sample_description_id, sample_duration, sample_size, sample_flags;
 
@@ -237,15 +283,24 @@ struct qtmp4_demuxer_c {
   std::vector<uint32_t> keyframe_table;
   std::vector<qt_editlist_t> editlist_table;
   std::vector<qt_frame_offset_t> raw_frame_offset_table;
-  std::vector<int32_t> frame_offset_table;
+  uint64_t num_frame_offsets{};
   std::vector<qt_random_access_point_t> random_access_point_table;
   std::unordered_map<uint32_t, std::vector<qt_sample_to_group_t> > sample_to_group_tables;
 
-  std::vector<int64_t> timecodes, durations, frame_indices;
-
+  // One entry per sample (per chunk for constant sample sizes). The
+  // index is still built in full as applying edit lists and finding
+  // the global minimum timestamp need all of it; only the tables it's
+  // built from are freed afterwards.
   std::vector<qt_index_t> m_index;
   std::vector<qt_fragment_t> m_fragments;
 
+  // Data of the index entries starting at pos that has already been
+  // read as part of a coalesced read
+  std::deque<qt_pending_read_t> m_pending_reads;
+  // Whether or not the samples are read in file order together with
+  // those of other tracks
+  bool m_read_coalesced{};
+
   int64_rational_c frame_rate;
   boost::optional<int64_t> m_use_frame_rate_for_duration;
 
@@ -321,6 +376,7 @@ struct qtmp4_demuxer_c {
   int64_t to_nsecs(int64_t value, boost::optional<int64_t> time_scale_to_use = boost::none);
   void calculate_timecodes();
   void adjust_timecodes(int64_t delta);
+  void release_tables();
 
   bool update_tables();
   void apply_edit_list();
@@ -378,9 +434,6 @@ private:
   void mark_key_frames_from_key_frame_table();
   void mark_open_gop_random_access_points_as_key_frames();
 
-  void calculate_timecodes_constant_sample_size();
-  void calculate_timecodes_variable_sample_size();
-
   bool parse_esds_atom(mm_mem_io_c &memio, int level);
   uint32_t read_esds_descr_len(mm_mem_io_c &memio);
 };
@@ -456,7 +509,10 @@ private:
 
   bool m_timecodes_calculated;
 
-  debugging_option_c m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_tables_full, m_debug_interleaving, m_debug_resync;
+  bool m_coalesce_reads, m_coalesced_read_tracks_selected;
+  int64_t m_pending_read_bytes;
+
+  debugging_option_c m_debug_chapters, m_debug_headers, m_debug_tables, m_debug_tables_full, m_debug_interleaving, m_debug_resync, m_debug_reads;
 
   friend class qtmp4_demuxer_c;
 
@@ -553,6 +609,9 @@ protected:
   virtual void process_chapter_entries(int level, std::vector<qtmp4_chapter_entry_t> &entries);
 
   virtual void detect_interleaving();
+  virtual void select_tracks_for_coalesced_reads();
+  virtual void read_coalesced(qtmp4_demuxer_c &dmx);
+  virtual memory_cptr read_sample(qtmp4_demuxer_c &dmx);
 
   virtual std::string read_string_atom(qt_atom_t atom, size_t num_skipped);
 };
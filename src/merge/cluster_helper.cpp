@@ -14,7 +14,9 @@
 
 #include "common/common_pch.h"
 
+#include "common/checksums/base.h"
 #include "common/ebml.h"
+#include "common/endian.h"
 #include "common/hacks.h"
 #include "common/math.h"
 #include "common/strings/formatting.h"
@@ -29,6 +31,7 @@
 #include "merge/packet_extensions.h"
 #include "merge/private/cluster_helper.h"
 
+#include <ebml/EbmlCrc32.h>
 #include <matroska/KaxBlock.h>
 #include <matroska/KaxBlockData.h>
 #include <matroska/KaxCuesData.h>
@@ -401,6 +404,10 @@ cluster_helper_c::render() {
   m->timecode_offset       = boost::accumulate(m->packets, m->timecode_offset, [](int64_t a, const packet_cptr &p) { return std::min(a, p->assigned_timecode); });
   int64_t timecode_offset = m->timecode_offset + get_discarded_duration();
 
+  // No frame of the previous cluster references the buffers anymore.
+  m->data_buffers.clear();
+  m->data_buffers.reserve(m->packets.size());
+
   for (auto &pack : m->packets) {
     generic_packetizer_c *source = pack->source;
     bool has_codec_state         = !!pack->codec_state;
@@ -433,8 +440,6 @@ cluster_helper_c::render() {
     min_cl_timecode                        = std::min(pack->assigned_timecode, min_cl_timecode);
     max_cl_timecode                        = std::max(pack->assigned_timecode, max_cl_timecode);
 
-    DataBuffer *data_buffer                = new DataBuffer((binary *)pack->data->get_buffer(), pack->data->get_size());
-
     KaxTrackEntry &track_entry             = static_cast<KaxTrackEntry &>(*source->get_track_entry());
 
     kax_block_blob_c *previous_block_group = !render_group->m_groups.empty() ? render_group->m_groups.back().get() : nullptr;
@@ -460,7 +465,7 @@ cluster_helper_c::render() {
         : pack->has_discard_padding()              ? BLOCK_BLOB_NO_SIMPLE
         :                                            BLOCK_BLOB_ALWAYS_SIMPLE;
 
-      render_group->m_groups.push_back(kax_block_blob_cptr(new kax_block_blob_c(this_block_blob_type)));
+      render_group->m_groups.push_back(create_block_blob(this_block_blob_type));
       new_block_group = render_group->m_groups.back().get();
       m->cluster->AddBlockBlob(new_block_group);
       new_block_group->SetParent(*m->cluster);
@@ -472,16 +477,23 @@ cluster_helper_c::render() {
       if (packet_extension_c::BEFORE_ADDING_TO_CLUSTER_CB == extension->get_type())
         static_cast<before_adding_to_cluster_cb_packet_extension_c *>(extension.get())->get_callback()(pack, timecode_offset);
 
-    // Now put the packet into the cluster.
+    // Now put the packet into the cluster. Block groups own their
+    // frames' DataBuffer objects while simple blocks don't.
+    DataBuffer *data_buffer;
+    if (BLOCK_BLOB_NO_SIMPLE == new_block_group->get_type())
+      data_buffer = new DataBuffer(static_cast<binary *>(pack->data->get_buffer()), pack->data->get_size());
+    else {
+      m->data_buffers.emplace_back(static_cast<binary *>(pack->data->get_buffer()), pack->data->get_size());
+      data_buffer = &m->data_buffers.back();
+    }
+
     render_group->m_more_data = new_block_group->add_frame_auto(track_entry, pack->assigned_timecode - timecode_offset, *data_buffer, lacing_type,
                                                                 pack->has_bref() ? pack->bref - timecode_offset : -1,
                                                                 pack->has_fref() ? pack->fref - timecode_offset : -1);
 
     if (has_codec_state) {
       KaxBlockGroup &bgroup = (KaxBlockGroup &)*new_block_group;
-      KaxCodecState *cstate = new KaxCodecState;
-      bgroup.PushElement(*cstate);
-      cstate->CopyBuffer(pack->codec_state->get_buffer(), pack->codec_state->get_size());
+      bgroup.PushElement(*new kax_codec_state_c{pack->codec_state});
     }
 
     if (-1 == m->first_timecode_in_file)
@@ -513,8 +525,9 @@ cluster_helper_c::render() {
         size_t data_add_idx;
         for (data_add_idx = 0; pack->data_adds.size() > data_add_idx; ++data_add_idx) {
           auto &block_more = AddEmptyChild<KaxBlockMore>(additions);
-          GetChild<KaxBlockAddID     >(block_more).SetValue(data_add_idx + 1);
-          GetChild<KaxBlockAdditional>(block_more).CopyBuffer((binary *)pack->data_adds[data_add_idx]->get_buffer(), pack->data_adds[data_add_idx]->get_size());
+          GetChild<KaxBlockAddID>(block_more).SetValue(data_add_idx + 1);
+          DeleteChildren<KaxBlockAdditional>(block_more);
+          block_more.PushElement(*new kax_block_additional_c{pack->data_adds[data_add_idx]});
         }
       }
 
@@ -549,7 +562,11 @@ cluster_helper_c::render() {
       m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
       m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
 
-      m->cluster->Render(*m->out, cues);
+      if (g_cluster_crc32)
+        render_cluster_with_crc32(cues);
+      else
+        m->cluster->Render(*m->out, cues);
+
       m->bytes_in_file += m->cluster->ElementSize();
 
       if (g_kax_sh_cues)
@@ -559,6 +576,9 @@ cluster_helper_c::render() {
 
       cues_c::get().postprocess_cues(cues, *m->cluster);
 
+      if (g_cluster_crc32)
+        write_cluster_with_crc32();
+
     } else
       m->previous_cluster_tc = -1;
   }
@@ -568,9 +588,77 @@ cluster_helper_c::render() {
 
   m->cluster->delete_non_blocks();
 
+  for (auto &rg : render_groups)
+    recycle_block_blobs(*rg);
+
   return 1;
 }
 
+/* Renders the cluster with a CRC-32 element as its first child into
+   memory and starts calculating the CRC over the rest of the
+   cluster's content on the CRC thread. write_cluster_with_crc32()
+   must be called before anything else is written to the destination
+   file.
+*/
+void
+cluster_helper_c::render_cluster_with_crc32(KaxCues &cues) {
+  // The cluster owns the element from now on; it's deleted along with
+  // the cluster's other non-block children after rendering.
+  auto crc32 = new EbmlCrc32;
+  m->cluster->InsertElement(*crc32, 0);
+
+  m->crc32_buffer.restart(m->out->getFilePointer());
+  m->cluster->Render(m->crc32_buffer, cues);
+
+  m->crc32_cluster_size = m->crc32_buffer.getFilePointer()   - m->crc32_buffer.get_file_offset();
+  m->crc32_value_offset = crc32->GetElementPosition() + crc32->HeadSize() - m->crc32_buffer.get_file_offset();
+
+  if (!m->crc32_thread)
+    m->crc32_thread = std::make_unique<thread_pool_c>(1);
+
+  auto content      = m->crc32_buffer.get_buffer() + m->crc32_value_offset + 4;
+  auto content_size = m->crc32_cluster_size        - m->crc32_value_offset - 4;
+
+  m->crc32_calculation = m->crc32_thread->submit([this, content, content_size]() {
+    m->crc32_value = mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::crc32_ieee_le, content, content_size, 0xffffffff) ^ 0xffffffff;
+  });
+}
+
+void
+cluster_helper_c::write_cluster_with_crc32() {
+  m->crc32_calculation.get();
+
+  auto buffer = m->crc32_buffer.get_buffer();
+  put_uint32_le(buffer + m->crc32_value_offset, m->crc32_value);
+
+  mxdebug_if(m->debug_rendering, boost::format("cluster at %1% size %2% CRC-32 0x%|3$08x|\n") % m->crc32_buffer.get_file_offset() % m->crc32_cluster_size % m->crc32_value);
+
+  m->out->write(buffer, m->crc32_cluster_size);
+}
+
+kax_block_blob_cptr
+cluster_helper_c::create_block_blob(BlockBlobType type) {
+  auto &free_blobs = BLOCK_BLOB_NO_SIMPLE == type ? m->free_block_groups : m->free_simple_blocks;
+
+  if (free_blobs.empty() || (free_blobs.back()->get_type() != type))
+    return std::make_shared<kax_block_blob_c>(type);
+
+  auto blob = free_blobs.back();
+  free_blobs.pop_back();
+
+  return blob;
+}
+
+void
+cluster_helper_c::recycle_block_blobs(render_groups_c &rg) {
+  for (auto &blob : rg.m_groups) {
+    blob->reset();
+    (BLOCK_BLOB_NO_SIMPLE == blob->get_type() ? m->free_block_groups : m->free_simple_blocks).push_back(blob);
+  }
+
+  rg.m_groups.clear();
+}
+
 bool
 cluster_helper_c::add_to_cues_maybe(packet_cptr &pack) {
   auto &source  = *pack->source;
@@ -658,6 +746,12 @@ cluster_helper_c::add_split_point(const split_point_c &split_point) {
     ++m->current_split_point;
 }
 
+std::vector<split_point_c> const &
+cluster_helper_c::get_split_points()
+  const {
+  return m->split_points;
+}
+
 bool
 cluster_helper_c::split_mode_produces_many_files()
   const {
@@ -64,6 +64,7 @@ public:
   void handle_discarded_duration(bool create_new_file, bool previously_discarding);
 
   void add_split_point(split_point_c const &split_point);
+  std::vector<split_point_c> const &get_split_points() const;
   void dump_split_points() const;
   bool splitting() const;
   bool split_mode_produces_many_files() const;
@@ -97,6 +98,12 @@ private:
   void split(packet_cptr &packet);
 
   bool add_to_cues_maybe(packet_cptr &pack);
+
+  void render_cluster_with_crc32(KaxCues &cues);
+  void write_cluster_with_crc32();
+
+  kax_block_blob_cptr create_block_blob(BlockBlobType type);
+  void recycle_block_blobs(render_groups_c &rg);
 };
 
 extern std::unique_ptr<cluster_helper_c> g_cluster_helper;
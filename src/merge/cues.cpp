@@ -13,34 +13,184 @@
 
 #include "common/common_pch.h"
 
+#include <queue>
+
 #include "common/debugging.h"
 #include "common/ebml.h"
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
 #include "common/math.h"
+#include "common/mm_io_x.h"
 #include "merge/cluster_helper.h"
 #include "merge/cues.h"
 #include "merge/generic_packetizer.h"
 #include "merge/libmatroska_extensions.h"
 #include "merge/output_control.h"
 
+namespace {
+
+std::size_t const s_spill_read_buffer_size = 64 * 1024;
+
+using id_timecode_value_t = std::pair<id_timecode_t, uint64_t>;
+
+void
+put_uint(std::vector<unsigned char> &data,
+         uint64_t value) {
+  while (value >= 0x80) {
+    data.push_back((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+
+  data.push_back(value);
+}
+
+void
+put_int(std::vector<unsigned char> &data,
+        int64_t value) {
+  put_uint(data, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+uint64_t
+get_uint(unsigned char const *&ptr) {
+  uint64_t value = 0;
+  auto shift     = 0u;
+
+  while (*ptr & 0x80) {
+    value |= static_cast<uint64_t>(*ptr++ & 0x7f) << shift;
+    shift += 7;
+  }
+
+  return value | (static_cast<uint64_t>(*ptr++) << shift);
+}
+
+int64_t
+get_int(unsigned char const *&ptr) {
+  auto value = get_uint(ptr);
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool
+is_id_timecode_less(id_timecode_value_t const &a,
+                    id_timecode_value_t const &b) {
+  return a.first < b.first;
+}
+
+// Returns the value of the nth entry (counting from 1) for the given
+// track number & timecode. The entries must be sorted stably so that
+// entries with the same key are still in the order they were added.
+boost::optional<uint64_t>
+find_nth_value(std::vector<id_timecode_value_t> const &values,
+               id_timecode_t const &id_timecode,
+               std::size_t nth) {
+  auto range = std::equal_range(values.begin(), values.end(), id_timecode_value_t{ id_timecode, 0 }, is_id_timecode_less);
+
+  if (static_cast<std::size_t>(std::distance(range.first, range.second)) < nth)
+    return boost::none;
+
+  return (range.first + (nth - 1))->second;
+}
+
+void
+sort_by_id_timecode(std::vector<id_timecode_value_t> &values) {
+  if (!std::is_sorted(values.begin(), values.end(), is_id_timecode_less))
+    std::stable_sort(values.begin(), values.end(), is_id_timecode_less);
+}
+
+}
+
+// ----------------------------------------------------------------------
+
+class cues_c::spilled_run_reader_c {
+protected:
+  mm_io_c &m_file;
+  spilled_run_t const &m_run;
+  std::vector<unsigned char> m_buffer;
+  unsigned char const *m_ptr{}, *m_end{};
+  uint64_t m_file_position{}, m_remaining{}, m_last_cluster_position{};
+  cue_point_t m_point{};
+
+public:
+  spilled_run_reader_c(mm_io_c &file,
+                       spilled_run_t const &run)
+    : m_file(file)
+    , m_run(run)
+    , m_file_position{run.m_offset}
+    , m_remaining{run.m_size}
+  {
+  }
+
+  cue_point_t const &get_point() const {
+    return m_point;
+  }
+
+  bool next() {
+    if ((m_ptr == m_end) && !m_remaining)
+      return false;
+
+    // An encoded point is at most 40 bytes long. Keeping more than
+    // that in the buffer means a point is never split across two reads.
+    if ((static_cast<std::size_t>(m_end - m_ptr) < 64) && m_remaining)
+      fill_buffer();
+
+    m_point.timecode          += get_uint(m_ptr);
+    m_point.track_num          = get_uint(m_ptr);
+    m_point.duration           = get_uint(m_ptr);
+    m_last_cluster_position   += get_int(m_ptr);
+    m_point.relative_position  = get_uint(m_ptr);
+    m_point.cluster_position   = m_last_cluster_position;
+
+    for (auto const &adjustment : m_run.m_adjustments)
+      if (m_point.cluster_position >= adjustment.first)
+        m_point.cluster_position += adjustment.second;
+
+    return true;
+  }
+
+protected:
+  void fill_buffer() {
+    auto left_over = static_cast<std::size_t>(m_end - m_ptr);
+    auto to_read   = std::min<uint64_t>(m_remaining, s_spill_read_buffer_size);
+
+    std::vector<unsigned char> buffer(left_over + to_read);
+    if (left_over)
+      std::memcpy(&buffer[0], m_ptr, left_over);
+
+    m_file.setFilePointer(m_file_position);
+    if (m_file.read(&buffer[left_over], to_read) != to_read)
+      throw mtx::mm_io::end_of_file_x{};
+
+    m_file_position += to_read;
+    m_remaining     -= to_read;
+    m_buffer         = std::move(buffer);
+    m_ptr            = &m_buffer[0];
+    m_end            = m_ptr + m_buffer.size();
+  }
+};
+
+// ----------------------------------------------------------------------
+
 cues_cptr cues_c::s_cues;
 
 cues_c::cues_c()
-  : m_num_cue_points_postprocessed{}
+  : m_num_track_points{}
   , m_no_cue_duration{hack_engaged(ENGAGE_NO_CUE_DURATION)}
   , m_no_cue_relative_position{hack_engaged(ENGAGE_NO_CUE_RELATIVE_POSITION)}
   , m_debug_cue_duration{         "cues|cues_cue_duration"}
   , m_debug_cue_relative_position{"cues|cues_cue_relative_position"}
+  , m_debug_spilling{             "cues|cues_spilling"}
 {
 }
 
+cues_c::~cues_c() {
+  remove_spill_file();
+}
+
 void
 cues_c::set_duration_for_id_timecode(uint64_t id,
                                      uint64_t timecode,
                                      uint64_t duration) {
   if (!m_no_cue_duration)
-    m_id_timecode_duration_multimap.insert({ id_timecode_t{id, timecode}, duration });
+    m_id_timecode_durations.emplace_back(id_timecode_t{id, timecode}, duration);
 }
 
 void
@@ -75,12 +225,13 @@ cues_c::add(KaxCuePoint &point) {
 void
 cues_c::write(mm_io_c &out,
               KaxSeekHead &seek_head) {
-  if (!m_points.size() || !g_cue_writing_requested)
+  store_points();
+
+  if ((!m_num_track_points && m_spilled_runs.empty()) || !g_cue_writing_requested)
     return;
 
-  // auto start = mtx::sys::get_current_time_millis();
-  sort();
-  // auto end_sort = mtx::sys::get_current_time_millis();
+  auto points = retrieve_track_points();
+  sort(points);
 
   // Need to write the (empty) cues element so that its position will
   // be set for indexing in g_kax_sh_main. Necessary because there's
@@ -97,10 +248,14 @@ cues_c::write(mm_io_c &out,
 
   // Forcefully write the correct head and copy its content from the
   // temporary storage location.
-  auto total_size = calculate_total_size();
+  auto total_size = uint64_t{};
+  for_each_sorted_point(points, [this, &total_size](cue_point_t const &point) {
+    total_size += calculate_point_size(point);
+  });
+
   write_ebml_element_head(out, EBML_ID(KaxCues), total_size);
 
-  for (auto &point : m_points) {
+  for_each_sorted_point(points, [this, &out](cue_point_t const &point) {
     KaxCuePoint kc_point;
 
     GetChild<KaxCueTime>(kc_point).SetValue(point.timecode / g_timecode_scale);
@@ -120,42 +275,212 @@ cues_c::write(mm_io_c &out,
       GetChild<KaxCueDuration>(positions).SetValue(RND_TIMECODE_SCALE(point.duration) / g_timecode_scale);
 
     kc_point.Render(out);
+  });
+
+  m_codec_state_position_map.clear();
+  remove_spill_file();
+}
+
+bool
+cues_c::is_less(cue_point_t const &a,
+                cue_point_t const &b) {
+  if (a.timecode < b.timecode)
+    return true;
+  if (a.timecode > b.timecode)
+    return false;
+
+  return a.track_num < b.track_num;
+}
+
+void
+cues_c::sort(std::vector<cue_point_t> &points) {
+  std::stable_sort(points.begin(), points.end(), is_less);
+}
+
+void
+cues_c::encode_point(track_points_t &track,
+                     cue_point_t const &point) {
+  put_int(track.m_data,  static_cast<int64_t>(point.timecode         - track.m_last_timecode));
+  put_uint(track.m_data, point.duration);
+  put_int(track.m_data,  static_cast<int64_t>(point.cluster_position - track.m_last_cluster_position));
+  put_uint(track.m_data, point.relative_position);
+
+  track.m_last_timecode         = point.timecode;
+  track.m_last_cluster_position = point.cluster_position;
+}
+
+void
+cues_c::decode_points(uint32_t track_num,
+                      track_points_t const &track,
+                      std::vector<cue_point_t> &points) {
+  auto ptr   = track.m_data.data();
+  auto end   = ptr + track.m_data.size();
+  auto point = cue_point_t{};
+
+  point.track_num = track_num;
+
+  while (ptr < end) {
+    point.timecode          += get_int(ptr);
+    point.duration           = get_uint(ptr);
+    point.cluster_position  += get_int(ptr);
+    point.relative_position  = get_uint(ptr);
+
+    points.push_back(point);
   }
+}
+
+void
+cues_c::store_points() {
+  for (auto const &point : m_points)
+    encode_point(m_track_points[point.track_num], point);
 
+  m_num_track_points += m_points.size();
   m_points.clear();
-  m_codec_state_position_map.clear();
-  m_num_cue_points_postprocessed = 0;
 
-  // auto end_all = mtx::sys::get_current_time_millis();
-  // mxinfo(boost::format("dur sort %1% write %2% total %3%\n") % (end_sort - start) % (end_all - end_sort) % (end_all - start));
+  // The limit refers to the decoded points as they have to be decoded
+  // and sorted before they can be written.
+  if ((m_num_track_points * sizeof(cue_point_t)) > g_cues_memory_limit)
+    spill_points();
+}
+
+std::vector<cue_point_t>
+cues_c::retrieve_track_points() {
+  std::vector<cue_point_t> points;
+  points.reserve(m_num_track_points);
+
+  for (auto const &track : m_track_points)
+    decode_points(track.first, track.second, points);
+
+  m_track_points.clear();
+  m_num_track_points = 0;
+
+  return points;
 }
 
 void
-cues_c::sort() {
-  brng::sort(m_points, [](cue_point_t const &a, cue_point_t const &b) -> bool {
-      if (a.timecode < b.timecode)
-        return true;
-      if (a.timecode > b.timecode)
-        return false;
+cues_c::spill_points() {
+  auto points = retrieve_track_points();
+  sort(points);
+
+  std::vector<unsigned char> data;
+  auto last_point = cue_point_t{};
+
+  for (auto const &point : points) {
+    put_uint(data, point.timecode - last_point.timecode);
+    put_uint(data, point.track_num);
+    put_uint(data, point.duration);
+    put_int(data,  static_cast<int64_t>(point.cluster_position - last_point.cluster_position));
+    put_uint(data, point.relative_position);
+
+    last_point = point;
+  }
+
+  try {
+    if (!m_spill_file) {
+      m_spill_file_name = bfs::temp_directory_path() / bfs::unique_path("mkvmerge-cues-%%%%-%%%%-%%%%-%%%%.tmp");
+      m_spill_file      = mm_file_io_c::open(m_spill_file_name.string(), MODE_CREATE);
+    }
 
-      if (a.track_num < b.track_num)
-        return true;
+    auto run     = spilled_run_t{};
+    m_spill_file->setFilePointer(0, seek_end);
+    run.m_offset = m_spill_file->getFilePointer();
+    run.m_size   = data.size();
 
+    if (m_spill_file->write(&data[0], data.size()) != data.size())
+      throw mtx::mm_io::exception{};
+
+    m_spilled_runs.push_back(run);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The temporary file '%1%' for the cues could not be written: %2%.\n")) % m_spill_file_name.string() % ex);
+  }
+
+  mxdebug_if(m_debug_spilling,
+             boost::format("cues_c::spill_points: %1% points in %2% bytes at %3%, %4% runs\n")
+             % points.size() % data.size() % m_spilled_runs.back().m_offset % m_spilled_runs.size());
+}
+
+void
+cues_c::remove_spill_file() {
+  m_spilled_runs.clear();
+
+  if (!m_spill_file)
+    return;
+
+  m_spill_file.reset();
+
+  boost::system::error_code ec;
+  bfs::remove(m_spill_file_name, ec);
+}
+
+void
+cues_c::for_each_sorted_point(std::vector<cue_point_t> const &points,
+                              std::function<void(cue_point_t const &)> const &worker) {
+  if (m_spilled_runs.empty()) {
+    for (auto const &point : points)
+      worker(point);
+    return;
+  }
+
+  // Merge the points held in memory with all runs in the temporary
+  // file. Source n < number of runs is run n; the last source is the
+  // memory which holds the newest points. Ties are broken by the
+  // source so that earlier points are written first, just like the
+  // stable sort does when nothing has been spilled.
+  using source_point_t = std::pair<cue_point_t, std::size_t>;
+
+  auto is_greater = [](source_point_t const &a, source_point_t const &b) -> bool {
+    if (is_less(a.first, b.first))
       return false;
-    });
+    if (is_less(b.first, a.first))
+      return true;
+    return a.second > b.second;
+  };
+
+  std::priority_queue<source_point_t, std::vector<source_point_t>, decltype(is_greater)> queue{is_greater};
+  std::vector<std::unique_ptr<spilled_run_reader_c> > readers;
+  auto memory_itr    = points.begin();
+  auto memory_source = m_spilled_runs.size();
+
+  for (auto const &run : m_spilled_runs) {
+    readers.emplace_back(std::make_unique<spilled_run_reader_c>(*m_spill_file, run));
+    if (readers.back()->next())
+      queue.push({ readers.back()->get_point(), readers.size() - 1 });
+  }
+
+  if (memory_itr != points.end())
+    queue.push({ *memory_itr++, memory_source });
+
+  try {
+    while (!queue.empty()) {
+      auto source = queue.top().second;
+      worker(queue.top().first);
+      queue.pop();
+
+      if (source == memory_source) {
+        if (memory_itr != points.end())
+          queue.push({ *memory_itr++, memory_source });
+
+      } else if (readers[source]->next())
+        queue.push({ readers[source]->get_point(), source });
+    }
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The temporary file '%1%' for the cues could not be read: %2%.\n")) % m_spill_file_name.string() % ex);
+  }
 }
 
-std::multimap<id_timecode_t, uint64_t>
+std::vector<cues_c::id_timecode_value_t>
 cues_c::calculate_block_positions(KaxCluster &cluster)
   const {
 
-  std::multimap<id_timecode_t, uint64_t> positions;
+  std::vector<id_timecode_value_t> positions;
 
   for (auto child : cluster) {
     auto simple_block = dynamic_cast<KaxSimpleBlock *>(child);
     if (simple_block) {
       simple_block->SetParent(cluster);
-      positions.insert({ id_timecode_t{ simple_block->TrackNum(), simple_block->GlobalTimecode()}, simple_block->GetElementPosition() });
+      positions.emplace_back(id_timecode_t{ simple_block->TrackNum(), simple_block->GlobalTimecode()}, simple_block->GetElementPosition());
       continue;
     }
 
@@ -168,9 +493,11 @@ cues_c::calculate_block_positions(KaxCluster &cluster)
       continue;
 
     block->SetParent(cluster);
-    positions.insert({ id_timecode_t{ block->TrackNum(), block->GlobalTimecode()}, block_group->GetElementPosition() });
+    positions.emplace_back(id_timecode_t{ block->TrackNum(), block->GlobalTimecode()}, block_group->GetElementPosition());
   }
 
+  sort_by_id_timecode(positions);
+
   return positions;
 }
 
@@ -179,71 +506,57 @@ cues_c::postprocess_cues(KaxCues &cues,
                          KaxCluster &cluster) {
   add(cues);
 
-  if (m_no_cue_duration && m_no_cue_relative_position)
-    return;
+  if (!m_no_cue_duration || !m_no_cue_relative_position)
+    postprocess_points(cluster);
 
+  store_points();
+}
+
+void
+cues_c::postprocess_points(KaxCluster &cluster) {
   auto cluster_data_start_pos = cluster.GetElementPosition() + cluster.HeadSize();
   auto block_positions        = calculate_block_positions(cluster);
   std::map<id_timecode_t, size_t> nblocks_processed; //# blocks processed so far with given track #/timecode
 
-  for (auto point = m_points.begin() + m_num_cue_points_postprocessed, end = m_points.end(); point != end; ++point) {
-    nblocks_processed[id_timecode_t{ point->track_num, point->timecode }]++;
+  sort_by_id_timecode(m_id_timecode_durations);
+
+  for (auto &point : m_points) {
+    auto id_timecode   = id_timecode_t{ point.track_num, point.timecode };
+    auto num_processed = ++nblocks_processed[id_timecode];
 
     // Set CueRelativePosition for all cues.
     if (!m_no_cue_relative_position) {
-      auto pair          = block_positions.equal_range({ point->track_num, point->timecode });
-      auto position_itr  = pair.first;
-      auto pos_end       = pair.second;
-      auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
-
-      for (auto i = 0u; ((i + 1) < num_processed) && (position_itr != pos_end); ++i)
-        position_itr++;
-
-      auto relative_position = block_positions.end() != position_itr ? std::max(position_itr->second, cluster_data_start_pos) - cluster_data_start_pos : 0ull;
+      auto position          = find_nth_value(block_positions, id_timecode, num_processed);
+      auto relative_position = position ? std::max(*position, cluster_data_start_pos) - cluster_data_start_pos : 0ull;
 
       assert(relative_position <= static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()));
 
-      point->relative_position = relative_position;
+      point.relative_position = relative_position;
 
       mxdebug_if(m_debug_cue_relative_position,
                  boost::format("cue_relative_position: looking for <%1%:%2%>: cluster_data_start_pos %3% position %4%\n")
-                 % point->track_num % point->timecode % cluster_data_start_pos % relative_position);
+                 % point.track_num % point.timecode % cluster_data_start_pos % relative_position);
     }
 
     // Set CueDuration if the packetizer wants them.
     if (m_no_cue_duration)
       continue;
 
-    auto pair          = m_id_timecode_duration_multimap.equal_range({ point->track_num, point->timecode });
-    auto duration_itr  = pair.first;
-    auto dur_end       = pair.second;
-    auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
-
-    for (auto i = 0u; ((i + 1) < num_processed) && (duration_itr != dur_end); ++i)
-      duration_itr++;
-
-    auto ptzr         = g_packetizers_by_track_num[point->track_num];
+    auto ptzr = g_packetizers_by_track_num[point.track_num];
 
     if (!ptzr || !ptzr->wants_cue_duration())
       continue;
 
-    if (m_id_timecode_duration_multimap.end() != duration_itr)
-      point->duration = duration_itr->second;
+    auto duration = find_nth_value(m_id_timecode_durations, id_timecode, num_processed);
+    if (duration)
+      point.duration = *duration;
 
     mxdebug_if(m_debug_cue_duration,
                boost::format("cue_duration: looking for <%1%:%2%>: %3%\n")
-               % point->track_num % point->timecode % (duration_itr == m_id_timecode_duration_multimap.end() ? static_cast<int64_t>(-1) : duration_itr->second));
+               % point.track_num % point.timecode % (duration ? static_cast<int64_t>(*duration) : static_cast<int64_t>(-1)));
   }
 
-  m_num_cue_points_postprocessed = m_points.size();
-
-  m_id_timecode_duration_multimap.clear();
-}
-
-uint64_t
-cues_c::calculate_total_size()
-  const {
-  return boost::accumulate(m_points, 0ull, [this](uint64_t sum, cue_point_t const &point) { return sum + calculate_point_size(point); });
+  m_id_timecode_durations.clear();
 }
 
 uint64_t
@@ -282,17 +595,34 @@ cues_c::adjust_positions(uint64_t old_position,
                          uint64_t delta) {
   auto s_debug_rerender_track_headers = debugging_option_c{"rerender|rerender_track_headers"};
 
-  if (!delta || (m_points.empty() && m_codec_state_position_map.empty()))
+  if (!delta || (m_points.empty() && !m_num_track_points && m_spilled_runs.empty() && m_codec_state_position_map.empty()))
     return;
 
   mxdebug_if(s_debug_rerender_track_headers,
-             boost::format("[rerender] cues_c::adjust_positions: old_position %1% delta %2% num_points %3% first point's position %4%\n")
-             % old_position % delta % m_points.size() % (!m_points.empty() ? m_points[0].cluster_position : 0));
+             boost::format("[rerender] cues_c::adjust_positions: old_position %1% delta %2% num_points %3% num_spilled_runs %4%\n")
+             % old_position % delta % (m_points.size() + m_num_track_points) % m_spilled_runs.size());
 
   for (auto &point : m_points)
     if (point.cluster_position >= old_position)
       point.cluster_position += delta;
 
+  for (auto &track : m_track_points) {
+    std::vector<cue_point_t> points;
+    decode_points(track.first, track.second, points);
+
+    track.second = track_points_t{};
+
+    for (auto &point : points) {
+      if (point.cluster_position >= old_position)
+        point.cluster_position += delta;
+      encode_point(track.second, point);
+    }
+  }
+
+  // Runs in the temporary file are only adjusted when they're read.
+  for (auto &run : m_spilled_runs)
+    run.m_adjustments.emplace_back(old_position, delta);
+
   for (auto &element : m_codec_state_position_map)
     if (element.second >= old_position)
       element.second += delta;
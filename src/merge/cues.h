@@ -34,19 +34,45 @@ using cues_cptr = std::shared_ptr<cues_c>;
 
 class cues_c {
 protected:
+  // Post-processed cue points of a single track. Each point is stored
+  // as variable-length differences to the track's previous point.
+  struct track_points_t {
+    std::vector<unsigned char> m_data;
+    uint64_t m_last_timecode{}, m_last_cluster_position{};
+  };
+
+  // A run of cue points sorted by timecode and track number that has
+  // been moved to the temporary file. Position adjustments requested
+  // after the run was written are applied while reading it back.
+  struct spilled_run_t {
+    uint64_t m_offset{}, m_size{};
+    std::vector<std::pair<uint64_t, uint64_t> > m_adjustments;
+  };
+
+  class spilled_run_reader_c;
+
+  using id_timecode_value_t = std::pair<id_timecode_t, uint64_t>;
+
+  // Cue points added since the last cluster has been post-processed
   std::vector<cue_point_t> m_points;
-  std::multimap<id_timecode_t, uint64_t> m_id_timecode_duration_multimap;
+  std::map<uint32_t, track_points_t> m_track_points;
+  uint64_t m_num_track_points;
+  std::vector<spilled_run_t> m_spilled_runs;
+  mm_io_cptr m_spill_file;
+  bfs::path m_spill_file_name;
+
+  std::vector<id_timecode_value_t> m_id_timecode_durations;
   std::map<id_timecode_t, uint64_t> m_codec_state_position_map;
 
-  size_t m_num_cue_points_postprocessed;
   bool m_no_cue_duration, m_no_cue_relative_position;
-  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position;
+  debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position, m_debug_spilling;
 
 protected:
   static cues_cptr s_cues;
 
 public:
   cues_c();
+  ~cues_c();
 
   void add(KaxCues &cues);
   void add(KaxCuePoint &point);
@@ -59,11 +85,20 @@ public:
   static cues_c &get();
 
 protected:
-  void sort();
-  std::multimap<id_timecode_t, uint64_t> calculate_block_positions(KaxCluster &cluster) const;
-  uint64_t calculate_total_size() const;
+  void postprocess_points(KaxCluster &cluster);
+  void store_points();
+  void spill_points();
+  void remove_spill_file();
+  std::vector<cue_point_t> retrieve_track_points();
+  void for_each_sorted_point(std::vector<cue_point_t> const &points, std::function<void(cue_point_t const &)> const &worker);
+  std::vector<id_timecode_value_t> calculate_block_positions(KaxCluster &cluster) const;
   uint64_t calculate_point_size(cue_point_t const &point) const;
   uint64_t calculate_bytes_for_uint(uint64_t value) const;
+
+  static void sort(std::vector<cue_point_t> &points);
+  static void encode_point(track_points_t &track, cue_point_t const &point);
+  static void decode_points(uint32_t track_num, track_points_t const &track, std::vector<cue_point_t> &points);
+  static bool is_less(cue_point_t const &a, cue_point_t const &b);
 };
 
 #endif  // MTX_MERGE_CUES_H
@@ -29,6 +29,7 @@
 #include "common/ebml.h"
 #include "common/hacks.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 #include "common/unique_numbers.h"
 #include "common/xml/ebml_tags_converter.h"
 #include "merge/cluster_helper.h"
@@ -1176,6 +1177,36 @@ generic_packetizer_c::fix_headers() {
   m_track_entry->SetGlobalTimecodeScale((int64_t)g_timecode_scale);
 }
 
+/** \brief Number of bytes the track's header may still grow by
+
+   The space reserved after the track headers is sized from the sum of
+   all packetizers' estimates. Packetizers that only know parts of
+   their headers after having parsed some frames should return an
+   upper bound for those parts.
+*/
+int64_t
+generic_packetizer_c::get_header_growth_estimate()
+  const {
+  // Minor changes such as the minimum cache or the default duration
+  auto estimate = int64_t{64};
+
+  // Video elementary streams usually only provide their codec private
+  // data (e.g. parameter sets) once the first frames have been parsed.
+  if (!m_hcodec_private && (track_video == m_htrack_type))
+    estimate += 2048;
+
+  return estimate;
+}
+
+static thread_pool_c *
+get_compression_thread_pool() {
+  // Initialized on first use which may happen on several reader
+  // threads at the same time.
+  static auto s_pool = g_num_compression_threads ? std::make_shared<thread_pool_c>(g_num_compression_threads) : thread_pool_cptr{};
+
+  return s_pool.get();
+}
+
 void
 generic_packetizer_c::compress_packet(packet_t &packet) {
   if (!m_compressor) {
@@ -1193,6 +1224,48 @@ generic_packetizer_c::compress_packet(packet_t &packet) {
   }
 }
 
+/** \brief Compresses a packet on one of the compression threads
+
+   The packet stays in the packet queue while it is being compressed.
+   \c get_packet() waits for its compression to finish before handing
+   it out. As packets are only ever taken from the front of the queue
+   they are released in their original order no matter in which order
+   the threads finish compressing them.
+*/
+void
+generic_packetizer_c::compress_packet_in_background(packet_cptr const &packet) {
+  auto pool = get_compression_thread_pool();
+
+  if (!m_compressor || !pool || !m_compressor->is_thread_safe()) {
+    compress_packet(*packet);
+    return;
+  }
+
+  auto compressor = m_compressor;
+
+  m_pending_compressions.emplace_back(packet.get(), pool->submit([compressor, packet]() {
+    packet->data = compressor->compress(packet->data);
+    for (auto &data_add : packet->data_adds)
+      data_add = compressor->compress(data_add);
+  }));
+}
+
+void
+generic_packetizer_c::wait_for_compression(packet_t &packet) {
+  if (m_pending_compressions.empty() || (m_pending_compressions.front().first != &packet))
+    return;
+
+  auto pending = std::move(m_pending_compressions.front().second);
+  m_pending_compressions.pop_front();
+
+  try {
+    pending.get();
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(m_ti.m_fname, m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
+}
+
 void
 generic_packetizer_c::account_enqueued_bytes(packet_t &packet,
                                              int64_t factor) {
@@ -1303,7 +1376,7 @@ generic_packetizer_c::add_packet2(packet_cptr pack) {
 
   after_packet_timestamped(*pack);
 
-  compress_packet(*pack);
+  compress_packet_in_background(pack);
 }
 
 void
@@ -1321,6 +1394,8 @@ generic_packetizer_c::get_packet() {
   packet_cptr pack = m_packet_queue.front();
   m_packet_queue.pop_front();
 
+  wait_for_compression(*pack);
+
   pack->output_order_timecode = timestamp_c::ns(pack->assigned_timecode - std::max(m_codec_delay.to_ns(0), m_seek_pre_roll.to_ns(0)));
 
   account_enqueued_bytes(*pack, -1);
@@ -1399,26 +1474,8 @@ generic_packetizer_c::apply_factory_short_queueing(packet_cptr_di &p_start) {
   }
 }
 
-struct packet_sorter_t {
-  int m_index;
-  static std::deque<packet_cptr> *m_packet_queue;
-
-  packet_sorter_t(int index)
-    : m_index(index)
-  {
-  }
-
-  bool operator <(const packet_sorter_t &cmp) const {
-    return (*m_packet_queue)[m_index]->timecode < (*m_packet_queue)[cmp.m_index]->timecode;
-  }
-};
-
-std::deque<packet_cptr> *packet_sorter_t::m_packet_queue = nullptr;
-
 void
 generic_packetizer_c::apply_factory_full_queueing(packet_cptr_di &p_start) {
-  packet_sorter_t::m_packet_queue = &m_packet_queue;
-
   while (m_packet_queue.end() != p_start) {
     // Find the next I frame packet.
     packet_cptr_di p_end = p_start + 1;
@@ -1432,25 +1489,29 @@ generic_packetizer_c::apply_factory_full_queueing(packet_cptr_di &p_start) {
 
     // Now sort the frames by their timecode as the factory has to be
     // applied to the packets in the same order as they're timestamped.
-    std::vector<packet_sorter_t> sorter;
+    std::vector<size_t> sorter;
     bool needs_sorting        = false;
     int64_t previous_timecode = 0;
     size_t i                  = distance(m_packet_queue.begin(), p_start);
 
     packet_cptr_di p_current;
     for (p_current = p_start; p_current != p_end; ++i, ++p_current) {
-      sorter.push_back(packet_sorter_t(i));
+      sorter.push_back(i);
       if (m_packet_queue[i]->timecode < previous_timecode)
         needs_sorting = true;
       previous_timecode = m_packet_queue[i]->timecode;
     }
 
+    // Packetizers run on several reader threads in parallel. Therefore
+    // the comparison must only use this packetizer's own queue.
     if (needs_sorting)
-      std::sort(sorter.begin(), sorter.end());
+      std::sort(sorter.begin(), sorter.end(), [this](size_t a, size_t b) {
+        return m_packet_queue[a]->timecode < m_packet_queue[b]->timecode;
+      });
 
     // Finally apply the factory.
     for (i = 0; sorter.size() > i; ++i)
-      apply_factory_once(m_packet_queue[sorter[i].m_index]);
+      apply_factory_once(m_packet_queue[sorter[i]]);
 
     p_start = p_end;
   }
@@ -1540,6 +1601,10 @@ generic_packetizer_c::is_compatible_with(output_compatibility_e compatibility) {
 
 void
 generic_packetizer_c::discard_queued_packets() {
+  for (auto &pending : m_pending_compressions)
+    pending.second.wait();
+
+  m_pending_compressions.clear();
   m_packet_queue.clear();
   m_enqueued_bytes = 0;
 }
@@ -17,6 +17,7 @@
 #include "common/common_pch.h"
 
 #include <deque>
+#include <future>
 
 #include "common/option_with_source.h"
 #include "common/timestamp.h"
@@ -48,6 +49,7 @@ class generic_packetizer_c {
 protected:
   int m_num_packets;
   std::deque<packet_cptr> m_packet_queue, m_deferred_packets;
+  std::deque<std::pair<packet_t *, std::future<void>>> m_pending_compressions;
   int m_next_packet_wo_assigned_timecode;
 
   int64_t m_free_refs, m_next_free_refs, m_enqueued_bytes;
@@ -135,6 +137,7 @@ public:
   }
   virtual void set_headers();
   virtual void fix_headers();
+  virtual int64_t get_header_growth_estimate() const;
   inline int process(packet_t *packet) {
     return process(packet_cptr(packet));
   }
@@ -284,6 +287,8 @@ protected:
   virtual void show_experimental_status_version(std::string const &codec_id);
 
   virtual void compress_packet(packet_t &packet);
+  virtual void compress_packet_in_background(packet_cptr const &packet);
+  virtual void wait_for_compression(packet_t &packet);
   virtual void account_enqueued_bytes(packet_t &packet, int64_t factor);
 };
 
@@ -40,7 +40,13 @@ kax_block_group_c::add_frame(const KaxTrackEntry &track,
                              int64_t past_block,
                              int64_t forw_block,
                              LacingType lacing) {
-  KaxBlock & block = GetChild<KaxBlock>(*this);
+  auto block_ptr = FindChild<KaxBlock>(*this);
+  if (!block_ptr) {
+    block_ptr = new kax_block_c;
+    PushElement(*block_ptr);
+  }
+
+  KaxBlock &block = *block_ptr;
   assert(ParentCluster);
   block.SetParent(*ParentCluster);
 
@@ -71,6 +77,47 @@ kax_block_group_c::add_frame(const KaxTrackEntry &track,
   return result;
 }
 
+void
+kax_block_c::reset() {
+  ReleaseFrames();
+  myBuffers.clear();
+}
+
+// Removes all children but the block itself. The plain KaxBlock that
+// KaxBlockGroup's constructor creates cannot be emptied completely and
+// is deleted as well; add_frame() creates a kax_block_c instead.
+void
+kax_block_group_c::reset() {
+  kax_block_c *block = nullptr;
+
+  for (auto idx = 0u; ListSize() > idx; ++idx) {
+    auto e = (*this)[idx];
+    if (!block && dynamic_cast<kax_block_c *>(e))
+      block = static_cast<kax_block_c *>(e);
+    else
+      delete e;
+  }
+
+  RemoveAll();
+
+  ParentTrack = nullptr;
+
+  if (!block)
+    return;
+
+  block->reset();
+  PushElement(*block);
+}
+
+kax_simple_block_c::~kax_simple_block_c() {
+  reset();
+}
+
+void
+kax_simple_block_c::reset() {
+  myBuffers.clear();
+}
+
 bool
 kax_block_blob_c::add_frame_auto(const KaxTrackEntry &track,
                                  uint64 timecode,
@@ -86,7 +133,7 @@ kax_block_blob_c::add_frame_auto(const KaxTrackEntry &track,
           && (-1 == forw_block))) {
     assert(true == bUseSimpleBlock);
     if (!Block.simpleblock) {
-      Block.simpleblock = new KaxSimpleBlock();
+      Block.simpleblock = new kax_simple_block_c();
       Block.simpleblock->SetParent(*ParentCluster);
     }
 
@@ -112,6 +159,19 @@ kax_block_blob_c::add_frame_auto(const KaxTrackEntry &track,
   return result;
 }
 
+// Prepares a block blob that has been rendered already for being
+// added to another cluster. The block or block group object itself is
+// kept, its frames and all other children are removed.
+void
+kax_block_blob_c::reset() {
+  if (bUseSimpleBlock) {
+    if (Block.simpleblock)
+      static_cast<kax_simple_block_c *>(Block.simpleblock)->reset();
+
+  } else if (Block.group)
+    static_cast<kax_block_group_c *>(Block.group)->reset();
+}
+
 bool
 kax_block_blob_c::replace_simple_by_group() {
   if (BLOCK_BLOB_ALWAYS_SIMPLE == SimpleBlockMode)
@@ -61,14 +61,62 @@ public:
   virtual filepos_t UpdateSize(bool bSaveDefault, bool bForceRender);
 };
 
+// A block that can be re-used for another frame after it has been
+// rendered. ReleaseFrames() only frees the frames but leaves their
+// entries in the frame list which AddFrame() would append to.
+class kax_block_c: public KaxBlock {
+public:
+  kax_block_c(): KaxBlock() {
+  }
+
+  void reset();
+};
+
 class kax_block_group_c: public KaxBlockGroup {
 public:
   kax_block_group_c(): KaxBlockGroup() {
   }
 
   bool add_frame(const KaxTrackEntry &track, uint64 timecode, DataBuffer &buffer, int64_t past_block, int64_t forw_block, LacingType lacing);
+  void reset();
+};
+
+// A simple block that does not own the DataBuffer objects its frames
+// are stored in. They're neither freed on reset() nor on destruction.
+class kax_simple_block_c: public KaxSimpleBlock {
+public:
+  kax_simple_block_c(): KaxSimpleBlock() {
+  }
+  virtual ~kax_simple_block_c();
+
+  void reset();
 };
 
+// A binary element that references the content of a memory_c instead
+// of copying it. The memory is kept alive for as long as the element
+// exists.
+template<typename T>
+class kax_referencing_binary_c: public T {
+protected:
+  memory_cptr m_memory;
+
+public:
+  kax_referencing_binary_c(memory_cptr const &memory)
+    : T()
+    , m_memory{memory}
+  {
+    this->SetBuffer(static_cast<binary const *>(m_memory->get_buffer()), m_memory->get_size());
+  }
+
+  virtual ~kax_referencing_binary_c() {
+    // Keep EbmlBinary's destructor from calling free() on the buffer.
+    this->SetBuffer(nullptr, 0);
+  }
+};
+
+using kax_codec_state_c      = kax_referencing_binary_c<KaxCodecState>;
+using kax_block_additional_c = kax_referencing_binary_c<KaxBlockAdditional>;
+
 class kax_block_blob_c: public KaxBlockBlob {
 public:
   kax_block_blob_c(BlockBlobType type): KaxBlockBlob(type) {
@@ -77,6 +125,12 @@ public:
   bool add_frame_auto(const KaxTrackEntry &track, uint64 timecode, DataBuffer &buffer, LacingType lacing, int64_t past_block, int64_t forw_block);
   void set_block_duration(uint64_t time_length);
   bool replace_simple_by_group();
+
+  BlockBlobType get_type() const {
+    return SimpleBlockMode;
+  }
+
+  void reset();
 };
 using kax_block_blob_cptr = std::shared_ptr<kax_block_blob_c>;
 
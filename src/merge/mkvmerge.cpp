@@ -65,6 +65,7 @@
 #include "merge/generic_reader.h"
 #include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
+#include "merge/split_jobs.h"
 #include "merge/track_info.h"
 
 using namespace libmatroska;
@@ -117,7 +118,11 @@ set_usage() {
                   "                           put at most n milliseconds of data into each\n"
                   "                           cluster.\n");
   usage_text += Y("  --no-cues                Do not write the cue data (the index).\n");
+  usage_text += Y("  --cues-memory-limit <n>  Keep at most n megabytes of cue data in memory\n"
+                  "                           and move the rest to a temporary file\n"
+                  "                           (default: 64).\n");
   usage_text += Y("  --clusters-in-meta-seek  Write meta seek data for clusters.\n");
+  usage_text += Y("  --cluster-crc32          Write a CRC-32 element in each cluster.\n");
   usage_text += Y("  --no-date                Do not write the 'date' field in the segment\n"
                   "                           information headers.\n");
   usage_text += Y("  --disable-lacing         Do not use lacing.\n");
@@ -125,6 +130,12 @@ set_usage() {
   usage_text += Y("  --timecode-scale <n>     Force the timecode scale factor to n.\n");
   usage_text += Y("  --disable-track-statistics-tags\n"
                   "                           Do not write tags with track statistics.\n");
+  usage_text += Y("  --threaded-reading       Run each source file's reader on its own thread.\n");
+  usage_text += Y("  --threaded-writing       Write the destination file on a separate thread.\n");
+  usage_text += Y("  --compression-threads <n>\n"
+                  "                           Compress packets with up to n threads in\n"
+                  "                           parallel (default: 0, compress on the thread\n"
+                  "                           reading the packets).\n");
   usage_text +=   "\n";
   usage_text += Y(" File splitting, linking, appending and concatenating (more global options):\n");
   usage_text += Y("  --split <d[K,M,G]|HH:MM:SS|s>\n"
@@ -147,6 +158,9 @@ set_usage() {
                   "                           Create a new file before each chapter (with 'all')\n"
                   "                           or before chapter numbers A, B etc.\n");
   usage_text += Y("  --split-max-files <n>    Create at most n files.\n");
+  usage_text += Y("  --split-jobs <n>         Create up to n of the destination files in\n"
+                  "                           parallel when splitting a Matroska file by\n"
+                  "                           timestamps, chapters or parts.\n");
   usage_text += Y("  --link                   Link splitted files.\n");
   usage_text += Y("  --link-to-previous <SID> Link the first file to the given SID.\n");
   usage_text += Y("  --link-to-next <SID>     Link the last file to the given SID.\n");
@@ -2259,6 +2273,23 @@ parse_args(std::vector<std::string> args) {
 
       sit++;
 
+    } else if (this_arg == "--split-jobs") {
+      if (no_next_arg)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      if (!parse_number(next_arg, g_num_split_jobs) || !g_num_split_jobs)
+        mxerror(boost::format(Y("Invalid number of jobs in '%1% %2%'.\n")) % this_arg % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--split-job-file-number") {
+      // Only used internally for the processes started by --split-jobs.
+      if (no_next_arg || !parse_number(next_arg, g_split_job_file_number) || (1 > g_split_job_file_number))
+        mxerror(boost::format(Y("Invalid file number in '%1% %2%'.\n")) % this_arg % next_arg);
+
+      g_file_num = g_split_job_file_number;
+      sit++;
+
     } else if (this_arg == "--link") {
       g_no_linking = false;
 
@@ -2293,12 +2324,26 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-cues")
       g_write_cues = false;
 
-    else if (this_arg == "--no-date")
+    else if (this_arg == "--cues-memory-limit") {
+      if (no_next_arg)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      uint64_t megabytes = 0;
+      if (!parse_number(next_arg, megabytes) || !megabytes)
+        mxerror(boost::format(Y("Invalid amount of memory in '%1% %2%'.\n")) % this_arg % next_arg);
+
+      g_cues_memory_limit = megabytes * 1024 * 1024;
+      sit++;
+
+    } else if (this_arg == "--no-date")
       g_write_date = false;
 
     else if (this_arg == "--clusters-in-meta-seek")
       g_write_meta_seek_for_clusters = true;
 
+    else if (this_arg == "--cluster-crc32")
+      g_cluster_crc32 = true;
+
     else if (this_arg == "--disable-lacing")
       g_no_lacing = true;
 
@@ -2308,7 +2353,22 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--disable-track-statistics-tags")
       g_no_track_statistics_tags = true;
 
-    else if (this_arg == "--attachment-description") {
+    else if (this_arg == "--threaded-reading")
+      g_threaded_reading = true;
+
+    else if (this_arg == "--threaded-writing")
+      g_threaded_writing = true;
+
+    else if (this_arg == "--compression-threads") {
+      if (no_next_arg)
+        mxerror(boost::format(Y("'%1%' lacks its argument.\n")) % this_arg);
+
+      if (!parse_number(next_arg, g_num_compression_threads))
+        mxerror(boost::format(Y("Invalid number of threads in '%1% %2%'.\n")) % this_arg % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--attachment-description") {
       if (no_next_arg)
         mxerror(Y("'--attachment-description' lacks the description.\n"));
 
@@ -2952,7 +3012,10 @@ setup(int argc,
   signal(SIGINT, sighandler);
 #endif
 
-  auto args = parse_common_args(command_line_utf8(argc, argv));
+  auto args = command_line_utf8(argc, argv);
+  set_split_jobs_command_line(args);
+
+  args = parse_common_args(args);
 
   g_cluster_helper = std::make_unique<cluster_helper_c>();
 
@@ -2998,6 +3061,14 @@ main(int argc,
 
   g_cluster_helper->dump_split_points();
 
+  if (!g_identifying && (1 < g_num_split_jobs)) {
+    auto exit_code = run_split_jobs();
+    if (exit_code) {
+      mxinfo(boost::format(Y("Multiplexing took %1%.\n")) % create_minutes_seconds_time_string((mtx::sys::get_current_time_millis() - start + 500) / 1000, true));
+      mxexit(*exit_code);
+    }
+  }
+
   try {
     create_next_output_file();
     main_loop();
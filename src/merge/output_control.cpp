@@ -50,6 +50,7 @@
 #include "common/command_line.h"
 #include "common/construct.h"
 #include "common/container.h"
+#include "common/at_scope_exit.h"
 #include "common/date_time.h"
 #include "common/debugging.h"
 #include "common/ebml.h"
@@ -68,6 +69,8 @@
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
 #include "merge/output_control.h"
+#include "merge/reader_worker.h"
+#include "merge/split_jobs.h"
 #include "merge/webm.h"
 
 using namespace libmatroska;
@@ -105,11 +108,16 @@ bool g_write_cues                           = true;
 bool g_cue_writing_requested                = false;
 generic_packetizer_c *g_video_packetizer    = nullptr;
 bool g_write_meta_seek_for_clusters         = false;
+bool g_cluster_crc32                        = false;
 bool g_no_lacing                            = false;
 bool g_no_linking                           = true;
 bool g_use_durations                        = false;
 bool g_no_track_statistics_tags             = false;
 bool g_write_date                           = true;
+bool g_threaded_reading                     = false;
+bool g_threaded_writing                     = false;
+unsigned int g_num_compression_threads      = 0;
+uint64_t g_cues_memory_limit                = 64 * 1024 * 1024;
 
 double g_timecode_scale                     = TIMECODE_SCALE;
 timecode_scale_mode_e g_timecode_scale_mode = TIMECODE_SCALE_MODE_NORMAL;
@@ -171,6 +179,7 @@ static std::unique_ptr<EbmlVoid> s_kax_sh_void;
 static std::unique_ptr<EbmlVoid> s_kax_chapters_void;
 static int64_t s_max_chapter_size           = 0;
 static std::unique_ptr<EbmlVoid> s_void_after_track_headers;
+static int64_t s_track_headers_reserve      = 1024;
 
 static std::vector<std::tuple<timestamp_c, std::string, std::string>> s_additional_chapter_atoms;
 
@@ -187,8 +196,11 @@ static std::unique_ptr<EbmlHead> s_head;
 static std::string s_muxing_app, s_writing_app;
 static boost::posix_time::ptime s_writing_date;
 
-static auto s_required_matroska_version      = 1u;
-static auto s_required_matroska_read_version = 1u;
+// Packetizers on reader worker threads may raise these concurrently.
+static std::atomic<unsigned int> s_required_matroska_version{1}, s_required_matroska_read_version{1};
+
+static std::unordered_map<generic_reader_c *, reader_worker_cptr> s_reader_workers;
+static std::atomic<bool> s_rerender_ebml_head_requested{}, s_rerender_track_headers_requested{};
 
 /** \brief Add a segment family UID to the list if it doesn't exist already.
 
@@ -318,7 +330,9 @@ display_progress(bool is_100percent = false) {
     s_display_reader = determine_display_reader();
 
   bool display_progress  = false;
-  int current_percentage = (s_display_reader->get_progress() + s_display_files_done * 100) / s_display_path_length;
+  auto worker            = s_reader_workers.find(s_display_reader);
+  auto reader_progress   = worker != s_reader_workers.end() ? worker->second->get_progress() : s_display_reader->get_progress();
+  int current_percentage = (reader_progress + s_display_files_done * 100) / s_display_path_length;
   int64_t current_time   = mtx::sys::get_current_time_millis();
 
   if (   (-1 == s_previous_percentage)
@@ -450,11 +464,25 @@ set_timecode_scale() {
   mxdebug_if(debug, boost::format("timecode_scale: %1% max ns per cluster: %2%\n") % g_timecode_scale % g_max_ns_per_cluster);
 }
 
+/** \brief Raises \c value to at least \c required
+
+   Returns whether or not \c value has been changed by this call.
+*/
+static bool
+raise_required_version(std::atomic<unsigned int> &value,
+                       unsigned int required) {
+  auto current = value.load();
+
+  while (current < required)
+    if (value.compare_exchange_weak(current, required))
+      return true;
+
+  return false;
+}
+
 bool
 set_required_matroska_version(unsigned int required_version) {
-  auto previous               = s_required_matroska_version;
-  s_required_matroska_version = std::max(s_required_matroska_version, required_version);
-  auto version_changed        = s_required_matroska_version != previous;
+  auto version_changed = raise_required_version(s_required_matroska_version, required_version);
 
   if (version_changed)
     rerender_ebml_head();
@@ -464,11 +492,8 @@ set_required_matroska_version(unsigned int required_version) {
 
 bool
 set_required_matroska_read_version(unsigned int required_read_version) {
-  auto previous                    = s_required_matroska_read_version;
-  s_required_matroska_read_version = std::max(s_required_matroska_read_version, required_read_version);
-
-  auto read_version_changed        = s_required_matroska_read_version != previous;
-  auto version_changed             = set_required_matroska_version(required_read_version);
+  auto read_version_changed = raise_required_version(s_required_matroska_read_version, required_read_version);
+  auto version_changed      = set_required_matroska_version(required_read_version);
 
   if (read_version_changed && !version_changed)
     rerender_ebml_head();
@@ -488,14 +513,21 @@ render_ebml_head(mm_io_c *out) {
     s_head = std::make_unique<EbmlHead>();
 
   GetChild<EDocType           >(*s_head).SetValue(outputting_webm() ? "webm" : "matroska");
-  GetChild<EDocTypeVersion    >(*s_head).SetValue(s_required_matroska_version);
-  GetChild<EDocTypeReadVersion>(*s_head).SetValue(s_required_matroska_read_version);
+  GetChild<EDocTypeVersion    >(*s_head).SetValue(s_required_matroska_version.load());
+  GetChild<EDocTypeReadVersion>(*s_head).SetValue(s_required_matroska_read_version.load());
 
   s_head->Render(*out, true);
 }
 
 void
 rerender_ebml_head() {
+  // Packetizers running on reader worker threads must not write to
+  // the output file. The main thread will take care of it.
+  if (reader_worker_c::is_worker_thread()) {
+    s_rerender_ebml_head_requested = true;
+    return;
+  }
+
   mm_io_c *out = g_cluster_helper->get_output();
 
   if (!out || !s_head)
@@ -542,6 +574,60 @@ generate_segment_uids() {
   s_seguid_next.generate_random();
 }
 
+static void
+render_void(mm_io_c &out,
+            int64_t new_size) {
+  auto actual_size = new_size;
+
+  s_void_after_track_headers = std::make_unique<EbmlVoid>();
+  s_void_after_track_headers->SetSize(new_size);
+  s_void_after_track_headers->UpdateSize();
+
+  while (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) > new_size)
+    s_void_after_track_headers->SetSize(--actual_size);
+
+  if (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) < new_size)
+    s_void_after_track_headers->SetSizeLength(new_size - actual_size - 1);
+
+  mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] render_void new_size %1% actual_size %2% size_length %3%\n") % new_size % actual_size % (new_size - actual_size - 1));
+
+  s_void_after_track_headers->Render(out);
+}
+
+/** \brief Total size of the void after the track headers
+
+   The void is enlarged so that the data following it starts on a
+   boundary at which the file system can insert space later on if the
+   track headers outgrow it.
+*/
+static int64_t
+calculate_void_after_track_headers_size(mm_io_c &out,
+                                        int64_t min_size) {
+  // The block size depends on the file system; the output must not.
+  if (hack_engaged(ENGAGE_NO_VARIABLE_DATA))
+    return min_size;
+
+  auto alignment = static_cast<int64_t>(out.get_insert_range_alignment());
+  if (!alignment)
+    return min_size;
+
+  auto void_pos       = static_cast<int64_t>(out.getFilePointer());
+  auto data_start_pos = ((void_pos + min_size + alignment - 1) / alignment) * alignment;
+
+  return data_start_pos - void_pos;
+}
+
+static int64_t
+calculate_track_headers_reserve() {
+  auto reserve = int64_t{};
+
+  for (auto &ptzr : g_packetizers)
+    if (ptzr.packetizer)
+      reserve += ptzr.packetizer->get_header_growth_estimate();
+
+  return std::max<int64_t>(reserve, 1024);
+}
+
 /** \brief Render the basic EBML and Matroska headers
 
    Renders the segment information and track headers. Also reserves
@@ -682,11 +768,9 @@ render_headers(mm_io_c *out) {
       g_kax_tracks->Render(*out, false);
       g_kax_sh_main->IndexThis(*g_kax_tracks, *g_kax_segment);
 
-      // Reserve some small amount of space for header changes by the
-      // packetizers.
-      s_void_after_track_headers = std::make_unique<EbmlVoid>();
-      s_void_after_track_headers->SetSize(1024 + full_header_size - g_kax_tracks->ElementSize(false));
-      s_void_after_track_headers->Render(*out);
+      // Reserve some space for header changes by the packetizers.
+      s_track_headers_reserve = calculate_track_headers_reserve();
+      render_void(*out, calculate_void_after_track_headers_size(*out, s_track_headers_reserve + full_header_size - g_kax_tracks->ElementSize(false)));
     }
 
   } catch (...) {
@@ -727,13 +811,42 @@ adjust_cue_and_seekhead_positions(uint64_t data_start_pos,
     adjust_cluster_seekhead_positions(data_start_pos, delta);
 }
 
+/** \brief Inserts space in front of the data via the file system
+
+   render_headers() sizes the void after the track headers so that the
+   data starts on a file system block boundary. As the size of the
+   insertion has to be a multiple of the block size, \c delta may be
+   enlarged.
+*/
+static bool
+insert_space_for_track_headers(uint64_t data_start_pos,
+                               uint64_t &delta) {
+  auto alignment = s_out->get_insert_range_alignment();
+  if (!alignment)
+    return false;
+
+  if (data_start_pos % alignment) {
+    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] insert_space: data_start_pos %1% is not a multiple of the block size %2%\n") % data_start_pos % alignment);
+    return false;
+  }
+
+  auto insert_size = ((delta + alignment - 1) / alignment) * alignment;
+
+  if (!s_out->insert_range(data_start_pos, insert_size)) {
+    mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] insert_space: inserting %1% bytes at %2% failed\n") % insert_size % data_start_pos);
+    return false;
+  }
+
+  mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] insert_space: inserted %1% bytes at %2% for delta %3%\n") % insert_size % data_start_pos % delta);
+
+  delta = insert_size;
+
+  return true;
+}
+
 static void
 relocate_written_data(uint64_t data_start_pos,
                       uint64_t delta) {
-  if (g_cluster_helper->discarding())
-    return;
-
-  auto rel_pos_from_end = s_out->get_size() - s_out->getFilePointer();
   auto const block_size = 1024llu * 1024;
   auto to_relocate      = s_out->get_size() - data_start_pos;
   auto relocated        = 0llu;
@@ -741,8 +854,8 @@ relocate_written_data(uint64_t data_start_pos,
   auto buffer           = af_buffer->get_buffer();
 
   mxdebug_if(s_debug_rerender_track_headers,
-             boost::format("[rerender] relocate_written_data: void pos %1% void size %2% = data_start_pos %3% s_out size %4% delta %5% to_relocate %6% rel_pos_from_end %7%\n")
-             % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % data_start_pos % s_out->get_size() % delta % to_relocate % rel_pos_from_end);
+             boost::format("[rerender] relocate_written_data: void pos %1% void size %2% = data_start_pos %3% s_out size %4% delta %5% to_relocate %6%\n")
+             % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % data_start_pos % s_out->get_size() % delta % to_relocate);
 
   // Extend the file's size. Setting the file pointer to beyond the
   // end and starting to write from there won't work with most of the
@@ -777,6 +890,23 @@ relocate_written_data(uint64_t data_start_pos,
 
     relocated += to_copy;
   }
+}
+
+/** \brief Moves everything written after the track headers back by \c delta bytes
+
+   Space is inserted by the file system if it supports it. Otherwise
+   all the data is copied. \c delta may be enlarged in the former case.
+*/
+static void
+move_written_data(uint64_t data_start_pos,
+                  uint64_t &delta) {
+  if (g_cluster_helper->discarding())
+    return;
+
+  auto rel_pos_from_end = s_out->get_size() - s_out->getFilePointer();
+
+  if (!insert_space_for_track_headers(data_start_pos, delta))
+    relocate_written_data(data_start_pos, delta);
 
   if (s_kax_as) {
     mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender]  re-writing attachments; old position %1% new %2%\n") % s_kax_as->GetElementPosition() % (s_kax_as->GetElementPosition() + delta));
@@ -795,25 +925,6 @@ relocate_written_data(uint64_t data_start_pos,
   adjust_cue_and_seekhead_positions(data_start_pos, delta);
 }
 
-static void
-render_void(int64_t new_size) {
-  auto actual_size = new_size;
-
-  s_void_after_track_headers = std::make_unique<EbmlVoid>();
-  s_void_after_track_headers->SetSize(new_size);
-  s_void_after_track_headers->UpdateSize();
-
-  while (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) > new_size)
-    s_void_after_track_headers->SetSize(--actual_size);
-
-  if (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) < new_size)
-    s_void_after_track_headers->SetSizeLength(new_size - actual_size - 1);
-
-  mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] render_void new_size %1% actual_size %2% size_length %3%\n") % new_size % actual_size % (new_size - actual_size - 1));
-
-  s_void_after_track_headers->Render(*s_out);
-}
-
 static void
 shrink_void_and_rerender_track_headers(int64_t new_void_size) {
   auto old_void_pos           = s_void_after_track_headers->GetElementPosition();
@@ -822,7 +933,7 @@ shrink_void_and_rerender_track_headers(int64_t new_void_size) {
   s_out->setFilePointer(g_kax_tracks->GetElementPosition());
 
   g_kax_tracks->Render(*s_out, false);
-  render_void(new_void_size);
+  render_void(*s_out, new_void_size);
 
   s_out->setFilePointer(0, seek_end);
 
@@ -846,6 +957,13 @@ shrink_void_and_rerender_track_headers(int64_t new_void_size) {
 */
 void
 rerender_track_headers() {
+  if (reader_worker_c::is_worker_thread()) {
+    s_rerender_track_headers_requested = true;
+    return;
+  }
+
+  reader_worker_c::pause_all_c pause;
+
   g_kax_tracks->UpdateSize(false);
 
   auto position_before    = s_out->getFilePointer();
@@ -860,11 +978,16 @@ rerender_track_headers() {
              % new_tracks_end_pos % data_start_pos % data_size % s_void_after_track_headers->GetElementPosition() % s_void_after_track_headers->ElementSize(true) % new_void_size);
 
   if (data_size  && (new_tracks_end_pos >= (data_start_pos - 3))) {
-    auto delta      = 1024 + new_tracks_end_pos - data_start_pos;
-    data_start_pos += delta;
-    new_void_size   = 1024;
+    // The reserved space wasn't enough. Reserve more this time so that
+    // further growth is less likely to require moving data again.
+    s_track_headers_reserve *= 2;
+
+    auto delta = static_cast<uint64_t>(s_track_headers_reserve + new_tracks_end_pos - data_start_pos);
 
-    relocate_written_data(data_start_pos - delta, delta);
+    move_written_data(data_start_pos, delta);
+
+    data_start_pos += delta;
+    new_void_size   = data_start_pos - new_tracks_end_pos;
   }
 
   shrink_void_and_rerender_track_headers(new_void_size);
@@ -1343,15 +1466,17 @@ prepare_tags_for_rendering() {
 */
 void
 create_next_output_file() {
+  reader_worker_c::pause_all_c pause;
+
   auto s_debug = debugging_option_c{"splitting"};
   mxdebug_if(s_debug, boost::format("splitting: Create next destination file; splitting? %1% discarding? %2%\n") % g_cluster_helper->splitting() % g_cluster_helper->discarding());
 
-  auto this_outfile   = g_cluster_helper->split_mode_produces_many_files() ? create_output_name() : g_outfile;
+  auto this_outfile   = g_cluster_helper->split_mode_produces_many_files() || g_split_job_file_number ? create_output_name() : g_outfile;
   g_kax_segment       = std::make_unique<KaxSegment>();
 
   // Open the output file.
   try {
-    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
+    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024, g_threaded_writing) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % this_outfile % ex);
   }
@@ -1492,6 +1617,8 @@ void
 finish_file(bool last_file,
             bool create_new_file,
             bool previously_discarding) {
+  reader_worker_c::pause_all_c pause;
+
   if (g_kax_chapters && !previously_discarding)
     add_chapters_for_current_part();
 
@@ -1953,6 +2080,45 @@ check_and_handle_end_of_input_after_pulling(packetizer_t &ptzr) {
   file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
 }
 
+static reader_worker_c *
+find_reader_worker(packetizer_t const &ptzr) {
+  auto worker = s_reader_workers.find(ptzr.packetizer->m_reader);
+  return worker != s_reader_workers.end() ? worker->second.get() : nullptr;
+}
+
+static void
+start_reader_workers() {
+  if (!g_threaded_reading)
+    return;
+
+  // Appending re-connects packetizers to other readers while
+  // multiplexing. This isn't supported in threaded mode.
+  if (s_appending_files) {
+    mxinfo(Y("Threaded reading is not supported when appending files. Falling back to reading on the main thread.\n"));
+    return;
+  }
+
+  for (auto &file : g_files)
+    if (file->reader->get_num_packetizers())
+      s_reader_workers[file->reader.get()] = std::make_shared<reader_worker_c>(*file->reader);
+}
+
+static void
+stop_reader_workers() {
+  s_reader_workers.clear();
+}
+
+static void
+handle_deferred_rerendering() {
+  if (s_rerender_ebml_head_requested.exchange(false)) {
+    reader_worker_c::pause_all_c pause;
+    rerender_ebml_head();
+  }
+
+  if (s_rerender_track_headers_requested.exchange(false))
+    rerender_track_headers();
+}
+
 static bool
 force_pull_packetizers_of_fully_held_files() {
   std::unordered_map<generic_reader_c *, bool> fully_held_files;
@@ -1969,18 +2135,32 @@ force_pull_packetizers_of_fully_held_files() {
   }
 
   auto force_pulled = false;
-  for (auto &ptzr : g_packetizers)
-    if (fully_held_files[ptzr.packetizer->m_reader] && !ptzr.packetizer->packet_available()) {
-      ptzr.old_status = ptzr.status;
-      ptzr.status     = ptzr.packetizer->read(true);
-      force_pulled    = true;
+  for (auto &ptzr : g_packetizers) {
+    auto worker = find_reader_worker(ptzr);
+
+    if (!fully_held_files[ptzr.packetizer->m_reader] || (worker ? worker->packet_available(ptzr.packetizer) : ptzr.packetizer->packet_available()))
+      continue;
+
+    ptzr.old_status = ptzr.status;
+    force_pulled    = true;
+
+    if (worker) {
+      auto result = worker->force_fetch(ptzr.packetizer, !ptzr.pack);
+      ptzr.status = result.status;
 
       if (!ptzr.pack)
-        ptzr.pack = ptzr.packetizer->get_packet();
+        ptzr.pack = result.packet;
 
-      check_and_handle_end_of_input_after_pulling(ptzr);
+    } else {
+      ptzr.status = ptzr.packetizer->read(true);
+
+      if (!ptzr.pack)
+        ptzr.pack = ptzr.packetizer->get_packet();
     }
 
+    check_and_handle_end_of_input_after_pulling(ptzr);
+  }
+
   return force_pulled;
 }
 
@@ -1992,6 +2172,20 @@ pull_packetizers_for_packets() {
 
     ptzr.old_status = ptzr.status;
 
+    auto worker = find_reader_worker(ptzr);
+    if (worker) {
+      // The worker takes care of forcing the duration on the last
+      // packet itself.
+      if (!ptzr.pack && (FILE_STATUS_DONE_AND_DRY != ptzr.status)) {
+        auto result = worker->fetch(ptzr.packetizer);
+        ptzr.status = result.status;
+        ptzr.pack   = result.packet;
+      }
+
+      check_and_handle_end_of_input_after_pulling(ptzr);
+      continue;
+    }
+
     while (   !ptzr.pack
            && (FILE_STATUS_MOREDATA == ptzr.status)
            && !ptzr.packetizer->packet_available())
@@ -2028,6 +2222,8 @@ select_winning_packetizer() {
 
 static void
 discard_queued_packets() {
+  stop_reader_workers();
+
   for (auto &ptzr : g_packetizers)
     ptzr.packetizer->discard_queued_packets();
 
@@ -2039,9 +2235,16 @@ discard_queued_packets() {
    Requests packets from each packetizer, selects the packet with the
    lowest timecode and hands it over to the cluster helper for
    rendering.  Also displays the progress.
+
+   If threaded reading is active then the readers run on their own
+   worker threads, and this function only fetches the packets they
+   have queued.
 */
 void
 main_loop() {
+  start_reader_workers();
+  at_scope_exit_c stop_workers{[]() { stop_reader_workers(); }};
+
   // Let's go!
   while (1) {
     // Step 1: Make sure a packet is available for each output
@@ -2049,6 +2252,8 @@ main_loop() {
     pull_packetizers_for_packets();
     auto force_pulled = force_pull_packetizers_of_fully_held_files();
 
+    handle_deferred_rerendering();
+
     // Step 2: Pick the packet with the lowest timecode and
     // stuff it into the Matroska file.
     auto winner = select_winning_packetizer();
@@ -2080,6 +2285,9 @@ main_loop() {
       break;
   }
 
+  stop_reader_workers();
+  handle_deferred_rerendering();
+
   // Render all remaining packets (if there are any).
   if (g_cluster_helper && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
@@ -2115,6 +2323,7 @@ cleanup() {
     s_out.reset();
   }
 
+  stop_reader_workers();
   g_cluster_helper.reset();
 
   destroy_readers();
@@ -148,6 +148,7 @@ extern family_uids_c g_segfamily_uids;
 extern kax_info_cptr g_kax_info_chap;
 
 extern bool g_write_meta_seek_for_clusters;
+extern bool g_cluster_crc32;
 
 extern std::string g_chapter_file_name;
 extern std::string g_chapter_language;
@@ -173,6 +174,9 @@ extern generic_packetizer_c *g_video_packetizer;
 
 extern bool g_write_cues, g_cue_writing_requested, g_write_date;
 extern bool g_no_lacing, g_no_linking, g_use_durations, g_no_track_statistics_tags;
+extern bool g_threaded_reading, g_threaded_writing;
+extern unsigned int g_num_compression_threads;
+extern uint64_t g_cues_memory_limit;
 
 extern bool g_identifying;
 extern identification_output_format_e g_identification_output_format;
@@ -15,8 +15,16 @@
 #ifndef MTX_MERGE_PRIVATE_CLUSTER_HELPER_H
 #define MTX_MERGE_PRIVATE_CLUSTER_HELPER_H
 
+#include <future>
+
+#include "common/mm_io.h"
+#include "common/thread_pool.h"
 #include "common/track_statistics.h"
 
+namespace libebml {
+class EbmlCrc32;
+}
+
 class render_groups_c {
 public:
   std::vector<kax_block_blob_cptr> m_groups;
@@ -33,6 +41,44 @@ public:
 };
 using render_groups_cptr = std::shared_ptr<render_groups_c>;
 
+/* Clusters with CRC-32 elements are rendered into this buffer
+   first. It reports positions as if it were the destination file
+   starting at the cluster's position. The positions libmatroska
+   records for the cluster and its blocks, e.g. for the cues, are
+   therefore the same as if the cluster had been rendered to the file
+   directly.
+*/
+class cluster_buffer_io_c: public mm_mem_io_c {
+protected:
+  uint64_t m_file_offset{};
+
+public:
+  cluster_buffer_io_c()
+    : mm_mem_io_c{nullptr, 0, 1024 * 1024}
+  {
+  }
+
+  // Discards the previous cluster's content.
+  void restart(uint64_t file_offset) {
+    m_file_offset = file_offset;
+    m_pos         = 0;
+    m_mem_size    = 0;
+    m_cached_size = -1;
+  }
+
+  uint64_t get_file_offset() const {
+    return m_file_offset;
+  }
+
+  virtual uint64 getFilePointer() {
+    return m_file_offset + mm_mem_io_c::getFilePointer();
+  }
+
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning) {
+    mm_mem_io_c::setFilePointer(seek_beginning == mode ? offset - m_file_offset : offset, mode);
+  }
+};
+
 struct cluster_helper_c::impl_t {
 public:
   std::shared_ptr<kax_cluster_c> cluster;
@@ -60,6 +106,21 @@ public:
 
   std::unordered_map<uint64_t, track_statistics_c> track_statistics;
 
+  // Frames in simple blocks reference these instead of DataBuffer
+  // objects allocated per frame. Rendered block blobs are kept for
+  // being re-used in the following clusters.
+  std::vector<DataBuffer> data_buffers;
+  std::vector<kax_block_blob_cptr> free_simple_blocks, free_block_groups;
+
+  // Only used with --cluster-crc32. The CRC is calculated on a
+  // separate thread while the cues and the meta seek element are
+  // updated for the rendered cluster.
+  cluster_buffer_io_c crc32_buffer;
+  std::unique_ptr<thread_pool_c> crc32_thread;
+  std::future<void> crc32_calculation;
+  std::size_t crc32_value_offset{}, crc32_cluster_size{};
+  uint32_t crc32_value{};
+
   debugging_option_c debug_splitting{"cluster_helper|splitting"}, debug_packets{"cluster_helper|cluster_helper_packets"}, debug_duration{"cluster_helper|cluster_helper_duration"},
     debug_rendering{"cluster_helper|cluster_helper_rendering"}, debug_chapter_generation{"cluster_helper|cluster_helper_chapter_generation"};
 
@@ -12,10 +12,16 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
+
 // #include "common/logger.h"
+#include "common/hacks.h"
+#include "common/mm_mmap_io.h"
 #include "common/mm_mpls_multi_file_io.h"
 #include "common/mm_read_buffer_io.h"
+#include "common/mm_shared_cache_io.h"
 #include "common/strings/formatting.h"
+#include "common/thread_pool.h"
 #include "common/xml/xml.h"
 #include "input/r_aac.h"
 #include "input/r_aac_adif.h"
@@ -69,10 +75,19 @@ file_names_to_paths(const std::vector<std::string> &file_names) {
 }
 
 static mm_io_cptr
-open_input_file(filelist_t &file) {
+open_input_file(filelist_t &file,
+                bool map_file = false) {
   try {
-    if (file.all_names.size() == 1)
+    if (file.all_names.size() == 1) {
+#if !defined(SYS_WINDOWS)
+      // Memory-mapped files don't need an additional read buffer.
+      auto mapped_in = map_file && !hack_engaged(ENGAGE_NO_MEMORY_MAPPED_IO) ? mm_mmap_io_c::open(file.name) : mm_io_cptr{};
+      if (mapped_in)
+        return mapped_in;
+#endif
+
       return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), 1 << 17));
+    }
 
     else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
@@ -116,36 +131,175 @@ do_probe(Tio &io,
 }
 
 static file_type_e
-detect_text_file_formats(filelist_t const &file) {
-  auto text_io = mm_text_io_cptr{};
-  try {
-    text_io        = std::make_shared<mm_text_io_c>(new mm_file_io_c(file.name));
-    auto text_size = text_io->get_size();
-
-    if (do_probe<webvtt_reader_c>(text_io, text_size))
-      return FILE_TYPE_WEBVTT;
-    else if (do_probe<srt_reader_c>(text_io, text_size))
-      return FILE_TYPE_SRT;
-    else if (do_probe<ssa_reader_c>(text_io, text_size))
-      return FILE_TYPE_SSA;
-    else if (do_probe<vobsub_reader_c>(text_io, text_size))
-      return FILE_TYPE_VOBSUB;
-    else if (do_probe<usf_reader_c>(text_io, text_size))
-      return FILE_TYPE_USF;
-
-    // Unsupported text subtitle formats
-    else if (do_probe<microdvd_reader_c>(text_io, text_size))
-      return FILE_TYPE_MICRODVD;
+detect_text_file_formats(mm_shared_cache_io_c::cache_cptr const &cache) {
+  auto text_io   = std::make_shared<mm_text_io_c>(new mm_shared_cache_io_c{cache});
+  auto text_size = text_io->get_size();
+
+  if (do_probe<webvtt_reader_c>(text_io, text_size))
+    return FILE_TYPE_WEBVTT;
+  else if (do_probe<srt_reader_c>(text_io, text_size))
+    return FILE_TYPE_SRT;
+  else if (do_probe<ssa_reader_c>(text_io, text_size))
+    return FILE_TYPE_SSA;
+  else if (do_probe<vobsub_reader_c>(text_io, text_size))
+    return FILE_TYPE_VOBSUB;
+  else if (do_probe<usf_reader_c>(text_io, text_size))
+    return FILE_TYPE_USF;
+
+  // Unsupported text subtitle formats
+  else if (do_probe<microdvd_reader_c>(text_io, text_size))
+    return FILE_TYPE_MICRODVD;
 
-  } catch (mtx::mm_io::exception &ex) {
-    mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file.name % ex);
+  return FILE_TYPE_IS_UNKNOWN;
+}
 
-  } catch (...) {
-    mxerror(boost::format(Y("The source file '%1%' could not be opened successfully, or retrieving its size by seeking to the end did not work.\n")) % file.name);
+/** \brief Runs the \c probe_file functions of several readers concurrently
+
+   All probes read the file through caches shared by all of them so
+   that each part of the file is read only once. The result is the
+   type detected by the first probe in the order they were added that
+   recognized the file, the same one that running them one after the
+   other would yield.
+
+   Probes added with \c add() must not have side effects and must only
+   use global state that is safe to access from several threads. They
+   are run on a thread pool. Probes added with \c add_sequential() are
+   run on the calling thread once all probes added before them haven't
+   recognized the file, and no other probe runs at the same time. This
+   is required for probes that output anything or that exit the
+   program, e.g. by reporting unsupported container formats.
+*/
+class file_type_prober_c {
+protected:
+  struct probe_t {
+    std::function<file_type_e()> m_probe;
+    bool m_concurrent;
+  };
+
+  using probe_itr_t = std::vector<probe_t>::const_iterator;
+
+  mm_shared_cache_io_c::cache_cptr m_cache;
+  int64_t m_size;
+  std::vector<probe_t> m_probes;
+
+public:
+  file_type_prober_c(mm_shared_cache_io_c::cache_cptr const &cache,
+                     int64_t size)
+    : m_cache{cache}
+    , m_size{size}
+  {
   }
 
-  return FILE_TYPE_IS_UNKNOWN;
-}
+  template<typename Treader,
+           typename ...Targs>
+  void
+  add(file_type_e type,
+      Targs ...args) {
+    m_probes.push_back({ create_probe<Treader>(type, args...), true });
+  }
+
+  template<typename Treader,
+           typename ...Targs>
+  void
+  add_sequential(file_type_e type,
+                 Targs ...args) {
+    m_probes.push_back({ create_probe<Treader>(type, args...), false });
+  }
+
+  void
+  add_sequential(std::function<file_type_e()> const &probe) {
+    m_probes.push_back({ probe, false });
+  }
+
+  file_type_e
+  run() {
+    auto begin = m_probes.cbegin();
+
+    while (begin != m_probes.cend()) {
+      auto type = FILE_TYPE_IS_UNKNOWN;
+
+      if (!begin->m_concurrent) {
+        type = begin->m_probe();
+        ++begin;
+
+      } else {
+        auto end = std::find_if(begin, m_probes.cend(), [](probe_t const &probe) { return !probe.m_concurrent; });
+        type     = run_concurrently(begin, end);
+        begin    = end;
+      }
+
+      if (FILE_TYPE_IS_UNKNOWN != type)
+        return type;
+    }
+
+    return FILE_TYPE_IS_UNKNOWN;
+  }
+
+protected:
+  template<typename Treader,
+           typename ...Targs>
+  std::function<file_type_e()>
+  create_probe(file_type_e type,
+               Targs ...args) {
+    auto cache = m_cache;
+    auto size  = m_size;
+
+    return [cache, size, type, args...]() {
+      auto io = std::make_shared<mm_shared_cache_io_c>(cache);
+      return do_probe<Treader>(io, size, args...) ? type : FILE_TYPE_IS_UNKNOWN;
+    };
+  }
+
+  file_type_e
+  run_concurrently(probe_itr_t begin,
+                   probe_itr_t end) {
+    static auto s_pool = std::make_shared<thread_pool_c>(std::max(std::thread::hardware_concurrency(), 2u));
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::vector<std::future<file_type_e>> results;
+
+    for (auto probe = begin; probe != end; ++probe) {
+      auto task = std::make_shared<std::packaged_task<file_type_e()>>([probe = probe->m_probe, cancelled]() {
+        return *cancelled ? FILE_TYPE_IS_UNKNOWN : probe();
+      });
+
+      results.emplace_back(task->get_future());
+      s_pool->submit([task]() { (*task)(); });
+    }
+
+    auto type = FILE_TYPE_IS_UNKNOWN;
+    std::exception_ptr exception;
+
+    try {
+      for (auto &result : results) {
+        type = result.get();
+        if (FILE_TYPE_IS_UNKNOWN != type)
+          break;
+      }
+
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    if ((FILE_TYPE_IS_UNKNOWN == type) && !exception)
+      return type;
+
+    // Lower priority probes still running cannot change the result
+    // anymore. Let them run into the end of the file and wait for
+    // them as they access the source file.
+    *cancelled = true;
+    m_cache->cancel();
+
+    for (auto &result : results)
+      if (result.valid())
+        result.wait();
+
+    if (exception)
+      std::rethrow_exception(exception);
+
+    return type;
+  }
+};
 
 /** \brief Probe the file type
 
@@ -162,72 +316,75 @@ get_file_type_internal(filelist_t &file) {
   if (is_playlist)
     io = file.playlist_mpls_in.get();
 
-  // File types that can be detected unambiguously but are not supported
-  if (do_probe<aac_adif_reader_c>(io, size))
-    return { FILE_TYPE_AAC, size };
-  if (do_probe<asf_reader_c>(io, size))
-    return { FILE_TYPE_ASF, size };
-  if (do_probe<cdxa_reader_c>(io, size))
-    return { FILE_TYPE_CDXA, size };
-  if (do_probe<flv_reader_c>(io, size))
-    return { FILE_TYPE_FLV, size };
-  if (do_probe<hdsub_reader_c>(io, size))
-    return { FILE_TYPE_HDSUB, size };
+  auto cache  = std::make_shared<mm_shared_cache_io_c::cache_c>(*io);
+  auto prober = file_type_prober_c{cache, size};
+
+  // The probes added with add() only read from the file and use
+  // debugging options and constant tables as their only global state.
+
+  // File types that can be detected unambiguously but are not
+  // supported. Their probes report the unsupported type and exit.
+  prober.add_sequential<aac_adif_reader_c>(FILE_TYPE_AAC);
+  prober.add_sequential<asf_reader_c>(FILE_TYPE_ASF);
+  prober.add_sequential<cdxa_reader_c>(FILE_TYPE_CDXA);
+  prober.add<flv_reader_c>(FILE_TYPE_FLV);
+  prober.add_sequential<hdsub_reader_c>(FILE_TYPE_HDSUB);
 
   // File types that can be detected unambiguously
-  if (do_probe<avi_reader_c>(io, size))
-    return { FILE_TYPE_AVI, size };
-  if (do_probe<kax_reader_c>(io, size))
-    return { FILE_TYPE_MATROSKA, size };
-  if (do_probe<wav_reader_c>(io, size))
-    return { FILE_TYPE_WAV, size };
-  if (do_probe<ogm_reader_c>(io, size))
-    return { FILE_TYPE_OGM, size };
-  if (do_probe<hdmv_textst_reader_c>(io, size))
-    return { FILE_TYPE_HDMV_TEXTST, size };
-  if (do_probe<flac_reader_c>(io, size))
-    return { FILE_TYPE_FLAC, size };
-  if (do_probe<pgssup_reader_c>(io, size))
-    return { FILE_TYPE_PGSSUP, size };
-  if (do_probe<real_reader_c>(io, size))
-    return { FILE_TYPE_REAL, size };
-  if (do_probe<qtmp4_reader_c>(io, size))
-    return { FILE_TYPE_QTMP4, size };
-  if (do_probe<tta_reader_c>(io, size))
-    return { FILE_TYPE_TTA, size };
-  if (do_probe<vc1_es_reader_c>(io, size))
-    return { FILE_TYPE_VC1, size };
-  if (do_probe<wavpack_reader_c>(io, size))
-    return { FILE_TYPE_WAVPACK4, size };
-  if (do_probe<ivf_reader_c>(io, size))
-    return { FILE_TYPE_IVF, size };
-  if (do_probe<coreaudio_reader_c>(io, size))
-    return { FILE_TYPE_COREAUDIO, size };
-  if (do_probe<dirac_es_reader_c>(io, size))
-    return { FILE_TYPE_DIRAC, size };
-
-  // All text file types (subtitles).
-  auto type = detect_text_file_formats(file);
-
-  if (FILE_TYPE_IS_UNKNOWN != type)
-    return { type, size };
+  prober.add<avi_reader_c>(FILE_TYPE_AVI);
+  prober.add<kax_reader_c>(FILE_TYPE_MATROSKA);
+  prober.add<wav_reader_c>(FILE_TYPE_WAV);
+  prober.add<ogm_reader_c>(FILE_TYPE_OGM);
+  prober.add<hdmv_textst_reader_c>(FILE_TYPE_HDMV_TEXTST);
+#if defined(HAVE_FLAC_FORMAT_H)
+  prober.add<flac_reader_c>(FILE_TYPE_FLAC);
+#else
+  prober.add_sequential<flac_reader_c>(FILE_TYPE_FLAC);
+#endif
+  prober.add<pgssup_reader_c>(FILE_TYPE_PGSSUP);
+  prober.add<real_reader_c>(FILE_TYPE_REAL);
+  prober.add<qtmp4_reader_c>(FILE_TYPE_QTMP4);
+  prober.add<tta_reader_c>(FILE_TYPE_TTA);
+  prober.add<vc1_es_reader_c>(FILE_TYPE_VC1);
+  prober.add<wavpack_reader_c>(FILE_TYPE_WAVPACK4);
+  prober.add<ivf_reader_c>(FILE_TYPE_IVF);
+  prober.add<coreaudio_reader_c>(FILE_TYPE_COREAUDIO);
+  prober.add<dirac_es_reader_c>(FILE_TYPE_DIRAC);
+
+  // All text file types (subtitles). They're only ever detected on
+  // the first file itself, not on the files referenced by a playlist
+  // or on several concatenated files. The MicroDVD probe reports an
+  // unsupported type and the USF probe opens the file by its name.
+  auto separate_text_file = (io != af_io.get()) || (file.all_names.size() != 1);
+
+  prober.add_sequential([&file, cache, separate_text_file]() {
+    try {
+      if (!separate_text_file)
+        return detect_text_file_formats(cache);
+
+      mm_file_io_c text_file{file.name};
+      return detect_text_file_formats(std::make_shared<mm_shared_cache_io_c::cache_c>(text_file));
+
+    } catch (mtx::mm_io::exception &ex) {
+      mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file.name % ex);
+
+    } catch (...) {
+      mxerror(boost::format(Y("The source file '%1%' could not be opened successfully, or retrieving its size by seeking to the end did not work.\n")) % file.name);
+    }
+
+    return FILE_TYPE_IS_UNKNOWN;
+  });
 
   // File types that are mis-detected sometimes
-  if (do_probe<dts_reader_c>(io, size, true))
-    return { FILE_TYPE_DTS, size };
-  if (do_probe<mtx::mpeg_ts::reader_c>(io, size))
-    return { FILE_TYPE_MPEG_TS, size };
-  if (do_probe<mpeg_ps_reader_c>(io, size))
-    return { FILE_TYPE_MPEG_PS, size };
+  prober.add<dts_reader_c>(FILE_TYPE_DTS, true);
+  prober.add<mtx::mpeg_ts::reader_c>(FILE_TYPE_MPEG_TS);
+  prober.add<mpeg_ps_reader_c>(FILE_TYPE_MPEG_PS);
 
   // Try raw audio formats and require eight consecutive frames at the
   // start of the file.
-  if (do_probe<mp3_reader_c>(io, size, 128 * 1024, 8, true))
-    return { FILE_TYPE_MP3, size };
-  if (do_probe<ac3_reader_c>(io, size, 128 * 1024, 8, true))
-    return { FILE_TYPE_AC3, size };
-  if (do_probe<aac_reader_c>(io, size, 128 * 1024, 8, true))
-    return { FILE_TYPE_AAC, size };
+  prober.add<mp3_reader_c>(FILE_TYPE_MP3, 128 * 1024, 8, true);
+  prober.add<ac3_reader_c>(FILE_TYPE_AC3, 128 * 1024, 8, true);
+  prober.add<aac_reader_c>(FILE_TYPE_AAC, 128 * 1024, 8, true);
 
   // File types which are the same in raw format and in other container formats.
   // Detection requires 20 or more consecutive packets.
@@ -235,39 +392,27 @@ get_file_type_internal(filelist_t &file) {
   static int const s_probe_num_required_consecutive_packets1 = 64;
 
   for (auto probe_size : s_probe_sizes1) {
-    if (do_probe<mp3_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets1))
-      return { FILE_TYPE_MP3, size };
-    if (do_probe<ac3_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets1))
-      return { FILE_TYPE_AC3, size };
-    if (do_probe<aac_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets1))
-      return { FILE_TYPE_AAC, size };
+    prober.add<mp3_reader_c>(FILE_TYPE_MP3, probe_size, s_probe_num_required_consecutive_packets1);
+    prober.add<ac3_reader_c>(FILE_TYPE_AC3, probe_size, s_probe_num_required_consecutive_packets1);
+    prober.add<aac_reader_c>(FILE_TYPE_AAC, probe_size, s_probe_num_required_consecutive_packets1);
   }
 
   // More file types with detection issues.
-  if (do_probe<truehd_reader_c>(io, size))
-    return { FILE_TYPE_TRUEHD, size };
-  if (do_probe<dts_reader_c>(io, size))
-    return { FILE_TYPE_DTS, size };
-  if (do_probe<vobbtn_reader_c>(io, size))
-    return { FILE_TYPE_VOBBTN, size };
+  prober.add<truehd_reader_c>(FILE_TYPE_TRUEHD);
+  prober.add<dts_reader_c>(FILE_TYPE_DTS);
+  prober.add<vobbtn_reader_c>(FILE_TYPE_VOBBTN);
 
   // Try some more of the raw audio formats before trying elementary
   // stream video formats (MPEG 1/2, AVC/h.264, HEVC/h.265; those
   // often enough simply work). However, require that the first frame
   // starts at the beginning of the file.
-  if (do_probe<mp3_reader_c>(io, size, 32 * 1024, 1, true))
-    return { FILE_TYPE_MP3, size };
-  if (do_probe<ac3_reader_c>(io, size, 32 * 1024, 1, true))
-    return { FILE_TYPE_AC3, size };
-  if (do_probe<aac_reader_c>(io, size, 32 * 1024, 1, true))
-    return { FILE_TYPE_AAC, size };
-
-  if (do_probe<mpeg_es_reader_c>(io, size))
-    return { FILE_TYPE_MPEG_ES, size };
-  if (do_probe<avc_es_reader_c>(io, size))
-    return { FILE_TYPE_AVC_ES, size };
-  if (do_probe<hevc_es_reader_c>(io, size))
-    return { FILE_TYPE_HEVC_ES, size };
+  prober.add<mp3_reader_c>(FILE_TYPE_MP3, 32 * 1024, 1, true);
+  prober.add<ac3_reader_c>(FILE_TYPE_AC3, 32 * 1024, 1, true);
+  prober.add<aac_reader_c>(FILE_TYPE_AAC, 32 * 1024, 1, true);
+
+  prober.add<mpeg_es_reader_c>(FILE_TYPE_MPEG_ES);
+  prober.add<avc_es_reader_c>(FILE_TYPE_AVC_ES);
+  prober.add<hevc_es_reader_c>(FILE_TYPE_HEVC_ES);
 
   // File types which are the same in raw format and in other container formats.
   // Detection requires 20 or more consecutive packets.
@@ -275,17 +420,20 @@ get_file_type_internal(filelist_t &file) {
   static int const s_probe_num_required_consecutive_packets2 = 20;
 
   for (auto probe_size : s_probe_sizes2) {
-    if (do_probe<mp3_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets2))
-      return { FILE_TYPE_MP3, size };
-    else if (do_probe<ac3_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets2))
-      return { FILE_TYPE_AC3, size };
-    else if (do_probe<aac_reader_c>(io, size, probe_size, s_probe_num_required_consecutive_packets2))
-      return { FILE_TYPE_AAC, size };
+    prober.add<mp3_reader_c>(FILE_TYPE_MP3, probe_size, s_probe_num_required_consecutive_packets2);
+    prober.add<ac3_reader_c>(FILE_TYPE_AC3, probe_size, s_probe_num_required_consecutive_packets2);
+    prober.add<aac_reader_c>(FILE_TYPE_AAC, probe_size, s_probe_num_required_consecutive_packets2);
   }
 
   // File types that are mis-detected sometimes and that aren't supported
-  if (do_probe<dv_reader_c>(io, size))
-    return { FILE_TYPE_DV, size };
+  prober.add_sequential<dv_reader_c>(FILE_TYPE_DV);
+
+  try {
+    return { prober.run(), size };
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file.name % ex);
+  }
 
   return { FILE_TYPE_IS_UNKNOWN, size };
 }
@@ -313,7 +461,10 @@ create_readers() {
 
   for (auto &file : g_files) {
     try {
-      mm_io_cptr input_file = file->playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file->playlist_mpls_in) : open_input_file(*file);
+      // Mapping a file risks SIGBUS if it is truncated while being
+      // read. Only do so for the readers profiting the most from it.
+      auto map_file         = (FILE_TYPE_QTMP4 == file->type) || (FILE_TYPE_MATROSKA == file->type);
+      mm_io_cptr input_file = file->playlist_mpls_in ? std::static_pointer_cast<mm_io_c>(file->playlist_mpls_in) : open_input_file(*file, map_file);
 
       switch (file->type) {
         case FILE_TYPE_AAC:
@@ -0,0 +1,267 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the threaded reader worker
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "merge/generic_packetizer.h"
+#include "merge/generic_reader.h"
+#include "merge/reader_worker.h"
+
+int64_t reader_worker_c::ms_max_queued_bytes = 64 * 1024 * 1024;
+std::vector<reader_worker_c *> reader_worker_c::ms_workers;
+thread_local bool reader_worker_c::ms_is_worker_thread = false;
+
+static int s_pause_depth = 0;
+
+reader_worker_c::reader_worker_c(generic_reader_c &reader)
+  : m_reader(reader)
+  , m_queued_bytes{}
+  , m_progress{reader.get_progress()}
+  , m_stop{}
+{
+  for (auto ptzr : m_reader.m_reader_packetizers)
+    m_tracks.emplace_back(ptzr);
+
+  ms_workers.push_back(this);
+
+  m_thread = std::thread{[this]() { run(); }};
+}
+
+reader_worker_c::~reader_worker_c() {
+  stop();
+
+  brng::remove_erase(ms_workers, this);
+}
+
+void
+reader_worker_c::stop() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_work_available.notify_all();
+
+  if (!m_thread.joinable())
+    return;
+
+  // mxerror() called by a reader or packetizer exits the program from
+  // the worker thread itself, stopping the worker on its own thread.
+  if (m_thread.get_id() == std::this_thread::get_id())
+    m_thread.detach();
+  else
+    m_thread.join();
+}
+
+void
+reader_worker_c::set_max_queued_bytes(int64_t max_queued_bytes) {
+  ms_max_queued_bytes = max_queued_bytes;
+}
+
+bool
+reader_worker_c::is_worker_thread() {
+  return ms_is_worker_thread;
+}
+
+int
+reader_worker_c::get_progress()
+  const {
+  return m_progress;
+}
+
+reader_worker_c::track_t &
+reader_worker_c::find_track(generic_packetizer_c *packetizer) {
+  for (auto &track : m_tracks)
+    if (track.m_packetizer == packetizer)
+      return track;
+
+  throw std::invalid_argument{"packetizer not handled by this reader worker"};
+}
+
+reader_worker_c::track_t *
+reader_worker_c::select_track_to_read() {
+  for (auto &track : m_tracks)
+    if (track.m_force_requested)
+      return &track;
+
+  for (auto &track : m_tracks)
+    if (track.m_requested && track.m_packets.empty() && (FILE_STATUS_MOREDATA == track.m_status))
+      return &track;
+
+  if (m_queued_bytes >= ms_max_queued_bytes)
+    return nullptr;
+
+  // Read ahead for the track with the fewest packets queued so that
+  // all tracks have something to offer when the main thread asks.
+  track_t *winner = nullptr;
+  for (auto &track : m_tracks)
+    if (   (FILE_STATUS_MOREDATA == track.m_status)
+        && (!winner || (track.m_packets.size() < winner->m_packets.size())))
+      winner = &track;
+
+  return winner;
+}
+
+void
+reader_worker_c::run() {
+  ms_is_worker_thread = true;
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (!m_stop) {
+    auto track = select_track_to_read();
+
+    if (!track)
+      m_work_available.wait(lock);
+    else
+      read_one(*track, track->m_force_requested, lock);
+  }
+}
+
+void
+reader_worker_c::read_one(track_t &track,
+                          bool force,
+                          std::unique_lock<std::mutex> &lock) {
+  auto old_status = track.m_status;
+  auto status     = old_status;
+  auto progress   = 0;
+  std::exception_ptr exception;
+  std::vector<std::pair<track_t *, packet_cptr>> packets;
+
+  lock.unlock();
+
+  {
+    std::lock_guard<std::mutex> processing_lock{m_processing_mutex};
+
+    try {
+      status = track.m_packetizer->read(force);
+
+      if (!force && (FILE_STATUS_MOREDATA != status) && (FILE_STATUS_MOREDATA == old_status))
+        track.m_packetizer->force_duration_on_last_packet();
+
+      // Reading for one track may have produced packets for any of
+      // the reader's tracks.
+      for (auto &other_track : m_tracks)
+        while (other_track.m_packetizer->packet_available())
+          packets.emplace_back(&other_track, other_track.m_packetizer->get_packet());
+
+      progress = m_reader.get_progress();
+
+    } catch (...) {
+      exception = std::current_exception();
+    }
+  }
+
+  lock.lock();
+
+  for (auto &packet : packets) {
+    m_queued_bytes += packet.second->calculate_uncompressed_size();
+    packet.first->m_packets.push_back(packet.second);
+  }
+
+  track.m_status          = status;
+  track.m_force_requested = false;
+  m_progress              = progress;
+
+  if (exception) {
+    m_exception = exception;
+    m_stop      = true;
+  }
+
+  m_data_available.notify_all();
+}
+
+reader_worker_c::result_t
+reader_worker_c::wait_for_packet(track_t &track,
+                                 bool forced,
+                                 bool take_packet,
+                                 std::unique_lock<std::mutex> &lock) {
+  m_data_available.wait(lock, [this, &track, forced]() {
+    if (m_exception)
+      return true;
+    if (forced)
+      return !track.m_force_requested;
+    return !track.m_packets.empty() || (FILE_STATUS_MOREDATA != track.m_status);
+  });
+
+  track.m_requested = false;
+
+  if (m_exception)
+    std::rethrow_exception(m_exception);
+
+  auto result = result_t{ track.m_status, {} };
+
+  if (take_packet && !track.m_packets.empty()) {
+    result.packet = track.m_packets.front();
+    track.m_packets.pop_front();
+
+    m_queued_bytes -= result.packet->calculate_uncompressed_size();
+    m_work_available.notify_one();
+  }
+
+  return result;
+}
+
+reader_worker_c::result_t
+reader_worker_c::fetch(generic_packetizer_c *packetizer) {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  auto &track = find_track(packetizer);
+
+  if (FILE_STATUS_HOLDING == track.m_status)
+    track.m_status = FILE_STATUS_MOREDATA;
+
+  if (track.m_packets.empty()) {
+    track.m_requested = true;
+    m_work_available.notify_one();
+  }
+
+  return wait_for_packet(track, false, true, lock);
+}
+
+reader_worker_c::result_t
+reader_worker_c::force_fetch(generic_packetizer_c *packetizer,
+                             bool take_packet) {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  auto &track             = find_track(packetizer);
+  track.m_force_requested = true;
+  m_work_available.notify_one();
+
+  return wait_for_packet(track, true, take_packet, lock);
+}
+
+bool
+reader_worker_c::packet_available(generic_packetizer_c *packetizer) {
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  return !find_track(packetizer).m_packets.empty();
+}
+
+reader_worker_c::pause_all_c::pause_all_c() {
+  if (reader_worker_c::is_worker_thread())
+    return;
+
+  if (0 == s_pause_depth++)
+    for (auto worker : ms_workers)
+      worker->m_processing_mutex.lock();
+}
+
+reader_worker_c::pause_all_c::~pause_all_c() {
+  if (reader_worker_c::is_worker_thread())
+    return;
+
+  if (0 == --s_pause_depth)
+    for (auto worker : ms_workers)
+      worker->m_processing_mutex.unlock();
+}
@@ -0,0 +1,122 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the threaded reader worker
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_READER_WORKER_H
+#define MTX_MERGE_READER_WORKER_H
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "merge/file_status.h"
+#include "merge/packet.h"
+
+class generic_packetizer_c;
+class generic_reader_c;
+
+/** \brief Runs a reader and all of its packetizers on their own thread
+
+   In threaded reading mode each reader gets a worker. Only the worker
+   thread calls the reader's and its packetizers' \c read() functions
+   and takes packets from the packetizers' queues. The packets are
+   moved into a per-track queue from which the main thread fetches
+   them for interleaving and rendering. The packets in each queue are
+   ordered the same way the packetizer has output them.
+
+   The worker keeps reading ahead as long as the number of bytes
+   queued for all of its tracks stays below a limit. Tracks the main
+   thread is waiting for are always read regardless of the limit.
+*/
+class reader_worker_c {
+public:
+  struct result_t {
+    file_status_e status;
+    packet_cptr packet;
+  };
+
+protected:
+  struct track_t {
+    generic_packetizer_c *m_packetizer;
+    file_status_e m_status;
+    std::deque<packet_cptr> m_packets;
+    bool m_requested, m_force_requested;
+
+    track_t(generic_packetizer_c *packetizer)
+      : m_packetizer{packetizer}
+      , m_status{FILE_STATUS_MOREDATA}
+      , m_requested{}
+      , m_force_requested{}
+    {
+    }
+  };
+
+  generic_reader_c &m_reader;
+  std::vector<track_t> m_tracks;
+  int64_t m_queued_bytes;
+  std::atomic<int> m_progress;
+  bool m_stop;
+  std::exception_ptr m_exception;
+
+  std::mutex m_mutex, m_processing_mutex;
+  std::condition_variable m_work_available, m_data_available;
+  std::thread m_thread;
+
+protected:
+  static int64_t ms_max_queued_bytes;
+  static std::vector<reader_worker_c *> ms_workers;
+  static thread_local bool ms_is_worker_thread;
+
+public:
+  reader_worker_c(generic_reader_c &reader);
+  ~reader_worker_c();
+
+  result_t fetch(generic_packetizer_c *packetizer);
+  result_t force_fetch(generic_packetizer_c *packetizer, bool take_packet);
+  bool packet_available(generic_packetizer_c *packetizer);
+  int get_progress() const;
+  void stop();
+
+public:
+  static void set_max_queued_bytes(int64_t max_queued_bytes);
+  static bool is_worker_thread();
+
+  /** \brief Suspends all workers for the lifetime of the object
+
+     The main thread must create such an object before accessing any
+     state that the packetizers may modify while reading, e.g. when
+     re-rendering the track headers or when creating a new output
+     file during splitting. Each worker finishes the \c read() call
+     it is currently executing before being suspended.
+  */
+  class pause_all_c {
+  public:
+    pause_all_c();
+    ~pause_all_c();
+  };
+
+protected:
+  void run();
+  void read_one(track_t &track, bool force, std::unique_lock<std::mutex> &lock);
+  track_t *select_track_to_read();
+  track_t &find_track(generic_packetizer_c *packetizer);
+  result_t wait_for_packet(track_t &track, bool forced, bool take_packet, std::unique_lock<std::mutex> &lock);
+};
+
+using reader_worker_cptr = std::shared_ptr<reader_worker_c>;
+
+#endif  // MTX_MERGE_READER_WORKER_H
@@ -0,0 +1,350 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   creating the files of a split in parallel
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/command_line.h"
+#include "common/fs_sys_helpers.h"
+#include "common/json.h"
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/split_point.h"
+#include "common/strings/formatting.h"
+#include "common/thread_pool.h"
+#include "merge/cluster_helper.h"
+#include "merge/filelist.h"
+#include "merge/output_control.h"
+#include "merge/split_jobs.h"
+
+unsigned int g_num_split_jobs = 0;
+int g_split_job_file_number   = 0;
+
+namespace {
+
+struct split_job_t {
+  int m_file_number{}, m_exit_code{};
+  std::string m_file_name;
+  std::vector<std::pair<int64_t, int64_t>> m_ranges;
+  bfs::path m_options_file_name, m_log_file_name;
+};
+
+std::vector<std::string> s_command_line;
+debugging_option_c s_debug{"split_jobs"};
+
+std::string
+get_reason_for_not_running_split_jobs() {
+  auto const &split_points = g_cluster_helper->get_split_points();
+
+  if (split_points.empty())
+    return Y("no splitting mode was selected");
+
+  auto type = split_points.front().m_type;
+  if (   ((split_point_c::timecode != type) && (split_point_c::parts != type))
+      || brng::find_if(split_points, [type](split_point_c const &point) { return point.m_type != type; }) != split_points.end())
+    return Y("it is only supported when splitting by timestamps, chapters or parts");
+
+  if (split_point_c::timecode == type)
+    for (auto idx = 1u; idx < split_points.size(); ++idx)
+      if (split_points[idx].m_point <= split_points[idx - 1].m_point)
+        return Y("the split points are not in ascending order");
+
+  if (!g_no_linking)
+    return Y("the destination files are to be linked");
+
+  if ((g_files.size() != 1) || !g_append_mapping.empty())
+    return Y("it is only supported with a single source file");
+
+  if (FILE_TYPE_MATROSKA != g_files.front()->type)
+    return Y("the source file is not a Matroska file");
+
+  if (chapter_generation_mode_e::none != g_cluster_helper->get_chapter_generation_mode())
+    return Y("chapters are to be generated");
+
+  return {};
+}
+
+/* Determines the ranges of the source file each destination file is
+   made of. These are exactly the ranges the sequential run would put
+   into that file.
+*/
+std::vector<split_job_t>
+create_jobs() {
+  auto const &split_points = g_cluster_helper->get_split_points();
+  auto const max_timestamp = std::numeric_limits<int64_t>::max();
+  std::vector<split_job_t> jobs;
+
+  auto add_range = [&jobs](int64_t start, int64_t end, bool create_new_file) {
+    if (create_new_file || jobs.empty()) {
+      jobs.emplace_back();
+      jobs.back().m_file_number = jobs.size();
+    }
+
+    jobs.back().m_ranges.emplace_back(start, end);
+  };
+
+  if (split_point_c::timecode == split_points.front().m_type) {
+    auto start = int64_t{};
+
+    for (auto const &split_point : split_points) {
+      add_range(start, split_point.m_point, true);
+      start = split_point.m_point;
+    }
+
+    add_range(start, max_timestamp, true);
+
+  } else {
+    for (auto idx = 0u; idx < split_points.size(); ++idx)
+      if (!split_points[idx].m_discard)
+        add_range(split_points[idx].m_point, (idx + 1) < split_points.size() ? split_points[idx + 1].m_point : max_timestamp, split_points[idx].m_create_new_file);
+  }
+
+  // Once the maximum number of files has been reached no split point
+  // is acted upon anymore. The last file therefore contains
+  // everything from its start onwards.
+  if (jobs.size() > static_cast<std::size_t>(g_split_max_num_files)) {
+    jobs.resize(g_split_max_num_files);
+    jobs.back().m_ranges = { { jobs.back().m_ranges.front().first, max_timestamp } };
+  }
+
+  auto previous_file_num = g_file_num;
+
+  for (auto &job : jobs) {
+    g_file_num      = job.m_file_number;
+    job.m_file_name = create_output_name();
+  }
+
+  g_file_num = previous_file_num;
+
+  return jobs;
+}
+
+std::string
+format_parts_argument(split_job_t const &job) {
+  std::string argument = "parts:";
+
+  for (auto const &range : job.m_ranges) {
+    if (&range != &job.m_ranges.front())
+      argument += ",+";
+
+    argument += (boost::format("%1%ns-") % range.first).str();
+    if (range.second != std::numeric_limits<int64_t>::max())
+      argument += (boost::format("%1%ns") % range.second).str();
+  }
+
+  return argument;
+}
+
+std::vector<std::string>
+create_job_args(split_job_t const &job) {
+  static std::vector<std::string> const s_options_with_argument{ "--split", "--split-max-files", "--split-jobs", "--split-job-file-number", "--redirect-output", "-r", "--output-charset" };
+  static std::vector<std::string> const s_options_without_argument{ "-q", "--quiet", "-v", "--verbose", "--gui-mode" };
+
+  std::vector<std::string> args;
+
+  for (auto idx = 0u; idx < s_command_line.size(); ++idx) {
+    auto const &arg = s_command_line[idx];
+
+    if (brng::find(s_options_with_argument, arg) != s_options_with_argument.end())
+      ++idx;
+
+    else if (brng::find(s_options_without_argument, arg) == s_options_without_argument.end())
+      args.push_back(arg);
+  }
+
+  args.insert(args.end(), {
+    "--quiet",
+    "--output-charset",         "UTF-8",
+    "--redirect-output",        job.m_log_file_name.string(),
+    "--split",                  format_parts_argument(job),
+    "--split-job-file-number",  to_string(job.m_file_number),
+  });
+
+  return args;
+}
+
+std::string
+quote_for_command_line(std::string const &arg) {
+#if defined(SYS_WINDOWS)
+  // File names on Windows cannot contain double quotes.
+  return "\"" + arg + "\"";
+#else
+  return "'" + balg::replace_all_copy(arg, "'", "'\\''") + "'";
+#endif
+}
+
+void
+run_job(split_job_t &job,
+        bfs::path const &executable) {
+  auto command = quote_for_command_line(executable.string()) + " " + quote_for_command_line("@" + job.m_options_file_name.string());
+
+  mxdebug_if(s_debug, boost::format("split_jobs: starting job %1%: %2%\n") % job.m_file_number % command);
+
+  job.m_exit_code = mtx::sys::system(command);
+
+  mxdebug_if(s_debug, boost::format("split_jobs: job %1% finished with exit code %2%\n") % job.m_file_number % job.m_exit_code);
+}
+
+/* The jobs run with their output redirected to a log file. Only errors
+   and warnings end up there as they're run with --quiet.
+*/
+void
+relay_job_output(split_job_t const &job) {
+  try {
+    mm_text_io_c log{new mm_file_io_c{job.m_log_file_name.string()}};
+    std::string line;
+
+    while (log.getline2(line)) {
+      if (line.empty())
+        continue;
+
+      auto level = MXMSG_INFO;
+
+      for (auto const &prefix_and_level : std::vector<std::pair<std::string, unsigned int>>{ { Y("Error:"), MXMSG_ERROR }, { Y("Warning:"), MXMSG_WARNING } })
+        if (balg::starts_with(line, prefix_and_level.first)) {
+          level = prefix_and_level.second;
+          line.erase(0, prefix_and_level.first.length());
+          balg::trim_left(line);
+          break;
+        }
+
+      mxmsg(level, line + "\n");
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  }
+}
+
+void
+display_progress(std::size_t num_done,
+                 std::size_t num_jobs) {
+  auto percentage = num_done * 100 / num_jobs;
+
+  if (g_gui_mode)
+    mxinfo(boost::format("#GUI#progress %1%%%\n") % percentage);
+  else
+    mxinfo(boost::format(Y("Progress: %1%%%%2%")) % percentage % "\r");
+}
+
+}
+
+void
+set_split_jobs_command_line(std::vector<std::string> const &args) {
+  s_command_line = args;
+}
+
+/** \brief Creates the destination files with one process per file
+
+   Returns \c boost::none if the current options don't allow creating
+   the files in parallel; the caller must multiplex sequentially in
+   that case. Otherwise the exit code mkvmerge should exit with is
+   returned: the highest exit code of all the jobs.
+*/
+boost::optional<int>
+run_split_jobs() {
+  auto reason = get_reason_for_not_running_split_jobs();
+  if (!reason.empty()) {
+    mxwarn(boost::format(Y("The destination files will be created one after the other as '--split-jobs' cannot be used: %1%.\n")) % reason);
+    return boost::none;
+  }
+
+  auto jobs = create_jobs();
+  if (jobs.size() < 2)
+    return boost::none;
+
+  auto temp_dir = bfs::temp_directory_path() / bfs::unique_path("mkvmerge-split-jobs-%%%%-%%%%-%%%%-%%%%");
+  boost::system::error_code ec;
+  bfs::create_directories(temp_dir, ec);
+  if (ec)
+    mxerror(boost::format(Y("The temporary directory '%1%' could not be created: %2%.\n")) % temp_dir.string() % ec.message());
+
+  for (auto &job : jobs) {
+    job.m_options_file_name = temp_dir / (boost::format("job-%1%.json") % job.m_file_number).str();
+    job.m_log_file_name     = temp_dir / (boost::format("job-%1%.txt")  % job.m_file_number).str();
+
+    try {
+      mm_file_io_c options{job.m_options_file_name.string(), MODE_CREATE};
+      options.write(mtx::json::dump(nlohmann::json(create_job_args(job))));
+
+    } catch (mtx::mm_io::exception &ex) {
+      bfs::remove_all(temp_dir, ec);
+      mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % job.m_options_file_name.string() % ex);
+    }
+  }
+
+  // The jobs get all options via their option files. Options from the
+  // environment would therefore be applied twice.
+  for (auto const &variable : std::vector<std::string>{ "MKVTOOLNIX", "MTX", balg::to_upper_copy(get_program_name()) })
+    mtx::sys::set_environment_variable(variable + "_OPTIONS", "");
+
+#if defined(SYS_WINDOWS)
+  auto executable = mtx::sys::get_installation_path() / "mkvmerge.exe";
+#else
+  auto executable = mtx::sys::get_installation_path() / "mkvmerge";
+#endif
+
+  auto num_threads = std::min<std::size_t>(std::max(g_num_split_jobs, 1u), jobs.size());
+
+  mxinfo(boost::format(Y("Creating %1% destination files with up to %2% jobs in parallel.\n")) % jobs.size() % num_threads);
+
+  std::vector<std::future<void>> results;
+  thread_pool_c pool{static_cast<unsigned int>(num_threads)};
+
+  for (auto &job : jobs)
+    results.emplace_back(pool.submit([&job, &executable]() { run_job(job, executable); }));
+
+  auto exit_code = 0;
+
+  for (auto idx = 0u; idx < jobs.size(); ++idx) {
+    results[idx].get();
+
+    auto const &job = jobs[idx];
+
+    relay_job_output(job);
+
+    if ((job.m_exit_code < 0) || (job.m_exit_code >= 2)) {
+      mxmsg(MXMSG_ERROR, (boost::format(Y("The destination file '%1%' could not be created.\n")) % job.m_file_name).str());
+      exit_code = 2;
+
+    } else {
+      if (verbose)
+        mxinfo(boost::format(Y("The file '%1%' has been written.\n")) % job.m_file_name);
+      exit_code = std::max(exit_code, job.m_exit_code);
+    }
+
+    display_progress(idx + 1, jobs.size());
+  }
+
+  mxinfo("\n");
+
+  bfs::remove_all(temp_dir, ec);
+
+  return exit_code;
+}
+
+/** \brief The position a reader in a split job can start reading at
+
+   Everything in front of the first range kept by the current job is
+   discarded anyway. Returns an invalid timestamp if this process is not
+   a split job or if the job's first range starts at the beginning.
+*/
+timestamp_c
+get_split_job_seek_timestamp() {
+  if (!g_split_job_file_number)
+    return {};
+
+  for (auto const &split_point : g_cluster_helper->get_split_points())
+    if (!split_point.m_discard)
+      return split_point.m_point > 0 ? timestamp_c::ns(split_point.m_point) : timestamp_c{};
+
+  return {};
+}
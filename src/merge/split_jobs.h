@@ -0,0 +1,43 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   definitions for creating the files of a split in parallel
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_SPLIT_JOBS_H
+#define MTX_MERGE_SPLIT_JOBS_H
+
+#include "common/common_pch.h"
+
+#include "common/timestamp.h"
+
+/** \brief Creating the destination files of a split with several processes
+
+   When splitting a single Matroska source file by timestamps, chapters
+   or parts each destination file only depends on a range of the
+   source file. With \c --split-jobs mkvmerge doesn't multiplex itself
+   but starts one mkvmerge process per destination file, at most \c
+   g_num_split_jobs of them at the same time. Each of them is run with
+   the original options, a \c --split \c parts: argument covering
+   only the ranges of its destination file and the internal option \c
+   --split-job-file-number. The Matroska reader of such a job starts
+   reading at the cue point before the job's first range instead of
+   at the start of the file.
+*/
+
+extern unsigned int g_num_split_jobs;
+extern int g_split_job_file_number;
+
+void set_split_jobs_command_line(std::vector<std::string> const &args);
+boost::optional<int> run_split_jobs();
+
+timestamp_c get_split_job_seek_timestamp();
+
+#endif  // MTX_MERGE_SPLIT_JOBS_H
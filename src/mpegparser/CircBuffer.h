@@ -90,6 +90,16 @@ public:
     return read_ptr;
   }
 
+  //Number of bytes that can be read from GetReadPtr() before the buffer wraps
+  uint32_t GetContiguousLength(){
+    return std::min(bytes_in_buf, bytes_before_wrap_read());
+  }
+
+  //Where the data continues after the buffer has wrapped
+  const binary* GetWrapPtr(){
+    return m_buf;
+  }
+
   binary& operator[](unsigned int i){
     if(i > bytes_in_buf){
       return read_ptr[0];
@@ -22,6 +22,8 @@
 
 #include "common/common_pch.h"
 
+#include "common/mpeg.h"
+
 #include "MPEGVideoBuffer.h"
 #include <cstring>
 
@@ -37,34 +39,62 @@ MPEG2PictureHeader::MPEG2PictureHeader() {
   memset(this, 0, sizeof(*this));
 }
 
+static bool IsWantedStartCode(binary code){
+  switch(code){
+    case MPEG_VIDEO_SEQUENCE_START_CODE:
+    case MPEG_VIDEO_GOP_START_CODE:
+    case MPEG_VIDEO_PICTURE_START_CODE:
+      return true;
+  }
+  return false;
+}
+
+//Searches a contiguous area for a wanted start code whose four bytes
+//all lie within it. Returns the offset from begin or -1.
+static int32_t FindStartCodeInArea(const binary* begin, uint32_t startPos, uint32_t length){
+  const binary* end = begin + length;
+  const binary* pos = begin + startPos;
+
+  while(true){
+    pos = mtx::mpeg::find_start_code(pos, end);
+    if((end - pos) < 4)
+      return -1;
+    if(IsWantedStartCode(pos[3]))
+      return pos - begin;
+    pos += 3;
+  }
+}
+
 int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
-  //How many bytes can we look through?
-  uint32_t window = myBuffer->GetLength() - startPos;
+  CircBuffer& buf = *myBuffer;
+  uint32_t length = buf.GetLength();
 
-  if(window < 4) //Make sure we have enough bytes to search.
+  if((length < 4) || (startPos > (length - 4))) //Make sure we have enough bytes to search.
     return -1;
 
-  for(unsigned int i = startPos; i < (startPos + window - 3); i++){
-    CircBuffer& buf = *myBuffer;
-    binary a,b,c,d;
-    a = buf[i];
-    b = buf[i+1];
-    c = buf[i+2];
-    d = buf[i+3];
-    if((a == 0x00) && (b == 0x00) && (c == 0x01)){
-      switch(d){
-        case MPEG_VIDEO_SEQUENCE_START_CODE:
-        case MPEG_VIDEO_GOP_START_CODE:
-        case MPEG_VIDEO_PICTURE_START_CODE:
-          return i;  //Return our position if we found
-          //one of the codes we want
+  //The data consists of up to two contiguous parts, one before and
+  //one after the point where the buffer wraps. Only the few start
+  //codes spanning the wrap point have to be checked byte by byte.
+  uint32_t head = buf.GetContiguousLength();
 
-      }
-    }
+  if(startPos < head){
+    int32_t found = FindStartCodeInArea(buf.GetReadPtr(), startPos, head);
+    if(found != -1)
+      return found;
   }
 
-  //If we get here we have no _wanted_ start code found.
-  return -1;
+  if(head == length)
+    return -1;
+
+  for(uint32_t i = std::max(startPos, head < 3 ? 0 : head - 3); (i < head) && (i <= (length - 4)); i++)
+    if((buf[i] == 0x00) && (buf[i+1] == 0x00) && (buf[i+2] == 0x01) && IsWantedStartCode(buf[i+3]))
+      return i;
+
+  startPos = std::max(startPos, head);
+  int32_t found = FindStartCodeInArea(buf.GetWrapPtr(), startPos - head, length - head);
+
+  //If we get here without a result we have no _wanted_ start code found.
+  return found == -1 ? -1 : found + head;
 }
 
 void MPEGVideoBuffer::UpdateState(){
@@ -74,6 +74,15 @@ hevc_es_video_packetizer_c::set_headers() {
   m_track_entry->EnableLacing(false);
 }
 
+int64_t
+hevc_es_video_packetizer_c::get_header_growth_estimate()
+  const {
+  // The HEVCC contains all VPS, SPS and PPS plus the SEI NALUs
+  // found before the first frame and can be considerably larger than
+  // other codecs' private data.
+  return generic_packetizer_c::get_header_growth_estimate() + (m_hcodec_private ? 0 : 6144);
+}
+
 void
 hevc_es_video_packetizer_c::set_container_default_field_duration(int64_t default_duration) {
   m_parser.set_container_default_duration(default_duration);
@@ -10,6 +10,8 @@
 
 #include "common/common_pch.h"
 
+#include <thread>
+
 #include <matroska/KaxChapters.h>
 #include <matroska/KaxTag.h>
 #include <matroska/KaxTags.h>
@@ -24,14 +26,18 @@
 options_c::options_c()
   : m_show_progress(false)
   , m_parse_mode(kax_analyzer_c::parse_mode_fast)
+  , m_num_batch_jobs(std::max(std::thread::hardware_concurrency(), 1u))
 {
 }
 
 void
 options_c::validate() {
-  if (m_file_name.empty())
+  if (m_file_name.empty() && m_batch_file_name.empty())
     mxerror(Y("No file name given.\n"));
 
+  if (!m_file_name.empty() && !m_batch_file_name.empty())
+    mxerror(Y("A file name cannot be given together with '--batch'.\n"));
+
   if (!has_changes())
     mxerror(Y("Nothing to do.\n"));
 
@@ -125,12 +131,16 @@ options_c::dump_info()
   const
 {
   mxinfo(boost::format("options:\n"
-                       "  file_name:     %1%\n"
-                       "  show_progress: %2%\n"
-                       "  parse_mode:    %3%\n")
+                       "  file_name:       %1%\n"
+                       "  show_progress:   %2%\n"
+                       "  parse_mode:      %3%\n"
+                       "  batch_file_name: %4%\n"
+                       "  num_batch_jobs:  %5%\n")
          % m_file_name
          % m_show_progress
-         % static_cast<int>(m_parse_mode));
+         % static_cast<int>(m_parse_mode)
+         % m_batch_file_name
+         % m_num_batch_jobs);
 
   for (auto &target : m_targets)
     target->dump_info();
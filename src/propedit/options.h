@@ -21,10 +21,12 @@
 
 class options_c {
 public:
-  std::string m_file_name;
+  std::string m_file_name, m_batch_file_name;
   std::vector<target_cptr> m_targets;
   bool m_show_progress;
   kax_analyzer_c::parse_mode_e m_parse_mode;
+  unsigned int m_num_batch_jobs;
+  std::vector<std::string> m_batch_args;
 
 public:
   options_c();
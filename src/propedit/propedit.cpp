@@ -16,12 +16,45 @@
 #include <matroska/KaxTracks.h>
 
 #include "common/command_line.h"
+#include "common/json.h"
 #include "common/list_utils.h"
 #include "common/mm_io_x.h"
+#include "common/strings/editing.h"
+#include "common/thread_pool.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
 #include "propedit/propedit_cli_parser.h"
 
+namespace {
+
+class batch_error_x: public mtx::exception {
+protected:
+  std::string m_message;
+
+public:
+  batch_error_x(std::string const &message)
+    : m_message{message}
+  {
+  }
+
+  virtual const char *what() const throw() {
+    return m_message.c_str();
+  }
+};
+
+struct batch_result_t {
+  std::string m_file_name, m_error;
+  std::vector<std::string> m_warnings;
+  bool m_modified{};
+};
+using batch_result_cptr = std::shared_ptr<batch_result_t>;
+
+// The result of the batch job the current thread is working on, if
+// any. Messages are collected in it instead of being output directly.
+thread_local batch_result_t *tl_batch_result = nullptr;
+
+}
+
 static void
 display_update_element_result(const EbmlCallbacks &callbacks,
                               kax_analyzer_c::update_element_result_e result) {
@@ -105,8 +138,8 @@ write_changes(options_cptr &options,
   }
 }
 
-static void
-run(options_cptr &options) {
+static bool
+process_file(options_cptr &options) {
   console_kax_analyzer_cptr analyzer;
 
   try {
@@ -147,17 +180,179 @@ run(options_cptr &options) {
 
   options->execute(*analyzer);
 
-  if (has_content_been_modified(options)) {
-    mxinfo(Y("The changes are written to the file.\n"));
+  if (!has_content_been_modified(options)) {
+    mxinfo(Y("No changes were made.\n"));
+    return false;
+  }
 
-    write_changes(options, analyzer.get());
+  mxinfo(Y("The changes are written to the file.\n"));
 
-    mxinfo(Y("Done.\n"));
+  write_changes(options, analyzer.get());
 
-  } else
-    mxinfo(Y("No changes were made.\n"));
+  mxinfo(Y("Done.\n"));
 
-  mxexit();
+  return true;
+}
+
+static void
+batch_message_handler(unsigned int level,
+                      std::string const &message) {
+  if (tl_batch_result) {
+    if (MXMSG_ERROR == level)
+      throw batch_error_x{message};
+
+    if (MXMSG_WARNING == level)
+      tl_batch_result->m_warnings.push_back(message);
+
+    return;
+  }
+
+  if ((MXMSG_WARNING == level) && g_suppress_warnings)
+    return;
+
+  mxmsg(level, message);
+
+  if (MXMSG_WARNING == level)
+    g_warning_issued = true;
+
+  else if (MXMSG_ERROR == level)
+    mxexit(2);
+}
+
+static std::vector<std::string>
+read_batch_file_names(std::string const &batch_file_name) {
+  std::vector<std::string> lines;
+
+  try {
+    mm_text_io_c in{new mm_file_io_c{batch_file_name}};
+    std::string line;
+
+    while (in.getline2(line))
+      lines.push_back(line);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % batch_file_name % ex);
+  }
+
+  auto first_line = std::find_if(lines.begin(), lines.end(), [](std::string const &line) { return line.find_first_not_of(" \t") != std::string::npos; });
+  if ((first_line == lines.end()) || ((*first_line)[first_line->find_first_not_of(" \t")] != '[')) {
+    boost::remove_erase_if(lines, [](std::string const &line) { return line.empty() || (line[0] == '#'); });
+    return lines;
+  }
+
+  // JSON job files contain an array of file names.
+  std::vector<std::string> file_names;
+
+  try {
+    auto json = mtx::json::parse(boost::join(lines, "\n"));
+    for (auto const &file_name : json)
+      file_names.push_back(file_name.get<std::string>());
+
+  } catch (std::exception &ex) {
+    mxerror(boost::format(Y("The batch file '%1%' is not a valid JSON array of file names: %2%\n")) % batch_file_name % ex.what());
+  }
+
+  return file_names;
+}
+
+static void
+run_batch_job(batch_result_t &result,
+              std::function<void()> const &job) {
+  tl_batch_result = &result;
+
+  try {
+    job();
+
+  } catch (batch_error_x &ex) {
+    result.m_error = ex.what();
+  } catch (mtx::mm_io::exception &ex) {
+    result.m_error = ex.error();
+  } catch (std::exception &ex) {
+    result.m_error = ex.what();
+  } catch (...) {
+    result.m_error = Y("An unknown error occured.");
+  }
+
+  tl_batch_result = nullptr;
+}
+
+static void
+report_batch_result(batch_result_t const &result) {
+  for (auto const &warning : result.m_warnings)
+    mxwarn_fn(result.m_file_name, chomp(warning) + "\n");
+
+  if (!result.m_error.empty())
+    mxmsg(MXMSG_ERROR, (boost::format(Y("'%1%': %2%")) % result.m_file_name % chomp(result.m_error)).str() + "\n");
+
+  else
+    mxinfo_fn(result.m_file_name, result.m_modified ? Y("The changes have been written to the file.\n") : Y("No changes were made.\n"));
+}
+
+/** \brief Applies the same actions to all files of a batch
+
+   The actions for each file are parsed from the arguments left over
+   from the command line in the main thread. The files themselves are
+   analyzed and modified on a pool of worker threads; the size of the
+   pool limits the number of files open at the same time. Results are
+   reported in the order the files are listed in.
+*/
+static void
+run_batch(options_cptr const &batch_options) {
+  auto file_names = read_batch_file_names(batch_options->m_batch_file_name);
+  if (file_names.empty())
+    mxerror(boost::format(Y("The batch file '%1%' does not contain any file names.\n")) % batch_options->m_batch_file_name);
+
+  for (auto level : std::vector<unsigned int>{ MXMSG_INFO, MXMSG_WARNING, MXMSG_ERROR })
+    set_mxmsg_handler(level, batch_message_handler);
+
+  auto num_jobs    = std::min<std::size_t>(batch_options->m_num_batch_jobs, file_names.size());
+  auto max_pending = num_jobs * 4;
+  auto num_failed  = 0u;
+  auto num_changed = 0u;
+  auto next_file   = file_names.begin();
+
+  thread_pool_c pool{static_cast<unsigned int>(num_jobs)};
+  std::deque<std::pair<batch_result_cptr, std::future<void>>> pending;
+
+  while ((next_file != file_names.end()) || !pending.empty()) {
+    while ((next_file != file_names.end()) && (pending.size() < max_pending)) {
+      auto result         = std::make_shared<batch_result_t>();
+      result->m_file_name = *next_file++;
+      auto options        = options_cptr{};
+
+      run_batch_job(*result, [&options, &batch_options, &result]() {
+        auto args = batch_options->m_batch_args;
+        args.push_back(result->m_file_name);
+
+        options                  = propedit_cli_parser_c{args}.run();
+        options->m_show_progress = false;
+      });
+
+      auto future = !result->m_error.empty() ? std::future<void>{} : pool.submit([options, result]() mutable {
+        run_batch_job(*result, [&options, &result]() { result->m_modified = process_file(options); });
+      });
+
+      pending.emplace_back(result, std::move(future));
+    }
+
+    auto &job = pending.front();
+    if (job.second.valid())
+      job.second.get();
+
+    report_batch_result(*job.first);
+
+    if (!job.first->m_error.empty())
+      ++num_failed;
+    else if (job.first->m_modified)
+      ++num_changed;
+
+    pending.pop_front();
+  }
+
+  mxinfo(boost::format(Y("%1% file(s) processed: %2% modified, %3% unchanged, %4% failed.\n")) % file_names.size() % num_changed % (file_names.size() - num_changed - num_failed) % num_failed);
+
+  if (num_failed)
+    mxexit(2);
 }
 
 static
@@ -184,7 +379,10 @@ main(int argc,
     options->dump_info();
   }
 
-  run(options);
+  if (options->m_batch_file_name.empty())
+    process_file(options);
+  else
+    run_batch(options);
 
   mxexit();
 }
@@ -14,6 +14,7 @@
 #include "common/common_pch.h"
 
 #include "common/ebml.h"
+#include "common/kax_analyzer_cache.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "common/translation.h"
@@ -35,6 +36,22 @@ propedit_cli_parser_c::set_parse_mode() {
   }
 }
 
+void
+propedit_cli_parser_c::set_analyzer_cache() {
+  mtx::kax_analyzer_cache::set_directory(m_next_arg);
+}
+
+void
+propedit_cli_parser_c::set_batch_file_name() {
+  m_options->m_batch_file_name = m_next_arg;
+}
+
+void
+propedit_cli_parser_c::set_num_batch_jobs() {
+  if (!parse_number(m_next_arg, m_options->m_num_batch_jobs) || !m_options->m_num_batch_jobs)
+    mxerror(boost::format(Y("Invalid number of jobs in '%1% %2%'.\n")) % m_current_arg % m_next_arg);
+}
+
 void
 propedit_cli_parser_c::add_target() {
   try {
@@ -208,6 +225,9 @@ propedit_cli_parser_c::init_parser() {
   add_section_header(YT("Options"));
   OPT("l|list-property-names",      list_property_names, YT("List all valid property names and exit"));
   OPT("p|parse-mode=<mode>",        set_parse_mode,      YT("Sets the Matroska parser mode to 'fast' (default) or 'full'"));
+  OPT("analyzer-cache=<directory>", set_analyzer_cache,  YT("Store the layout of analyzed files in 'directory' and re-use it for files that haven't been changed since"));
+  OPT("batch=<file-list>",          set_batch_file_name, YT("Apply the actions to all files listed in 'file-list' instead of to a single file"));
+  OPT("jobs=<n>",                   set_num_batch_jobs,  YT("Process up to 'n' files from the '--batch' list at the same time (default: number of CPUs)"));
 
   add_section_header(YT("Actions for handling properties"));
   OPT("e|edit=<selector>",          add_target,          YT("Sets the Matroska file section that all following add/set/delete "
@@ -286,5 +306,40 @@ propedit_cli_parser_c::run() {
   m_options->options_parsed();
   m_options->validate();
 
+  if (!m_options->m_batch_file_name.empty())
+    m_options->m_batch_args = get_batch_job_args();
+
   return m_options;
 }
+
+/** \brief Arguments the actions for each file of a batch are parsed from
+
+   The common options have already been removed from \c m_args by
+   \c parse_args(). The options controlling the batch itself are
+   removed as well, leaving only the actions.
+*/
+std::vector<std::string>
+propedit_cli_parser_c::get_batch_job_args()
+  const {
+  static std::vector<std::string> const s_batch_options{ "--batch", "--jobs", "--analyzer-cache" };
+
+  std::vector<std::string> args;
+
+  for (auto idx = 0u, num_args = static_cast<unsigned int>(m_args.size()); idx < num_args; ++idx) {
+    auto option_it = m_option_map.find(m_args[idx]);
+    auto needs_arg = (option_it != m_option_map.end()) && option_it->second.m_needs_arg && ((idx + 1) < num_args);
+    auto keep      = brng::find(s_batch_options, m_args[idx]) == s_batch_options.end();
+
+    if (keep)
+      args.push_back(m_args[idx]);
+
+    if (!needs_arg)
+      continue;
+
+    ++idx;
+    if (keep)
+      args.push_back(m_args[idx]);
+  }
+
+  return args;
+}
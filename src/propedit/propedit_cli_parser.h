@@ -37,6 +37,9 @@ protected:
   void add_tags();
   void add_chapters();
   void set_parse_mode();
+  void set_analyzer_cache();
+  void set_batch_file_name();
+  void set_num_batch_jobs();
   void set_file_name();
 
   void set_attachment_name();
@@ -52,6 +55,8 @@ protected:
 
   void handle_track_statistics_tags();
 
+  std::vector<std::string> get_batch_job_args() const;
+
   std::map<property_element_c::ebml_type_e, const char *> &get_ebml_type_abbrev_map();
 };
 
@@ -0,0 +1,297 @@
+/*
+   bit_reader_benchmark - A tool for benchmarking the bit reader
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/bit_cursor.h"
+#include "common/command_line.h"
+#include "common/mm_io_x.h"
+#include "common/mpeg.h"
+#include "common/strings/parsing.h"
+
+class cli_options_c {
+public:
+  std::string m_file_name;
+  unsigned int m_iterations{100};
+  bool m_hevc{};
+};
+
+static void
+show_help() {
+  mxinfo("bit_reader_benchmark [options] input_file_name\n"
+         "\n"
+         "Splits an AVC/h.264 or HEVC/h.265 elementary stream into NALUs and\n"
+         "measures how long reading the slice headers bit by bit takes. The\n"
+         "bit reader MKVToolNix used to have is compared to the current one.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  -i, --iterations num   Read all slice headers this many times (default: 100)\n"
+         "  --hevc                 The file contains HEVC/h.265 instead of AVC/h.264\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("bit_reader_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if (arg == "--hevc")
+      options.m_hevc = true;
+
+    else if ((arg == "-i") || (arg == "--iterations")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      if (!parse_number(next_arg, options.m_iterations) || !options.m_iterations)
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    } else if (!options.m_file_name.empty())
+      mxerror(Y("More than one source file was given.\n"));
+
+    else
+      options.m_file_name = arg;
+  }
+
+  if (options.m_file_name.empty())
+    mxerror(Y("No file name given\n"));
+
+  return options;
+}
+
+// The implementation as it was before the bit reader kept a 64-bit
+// cache. It serves as the baseline and for verifying the results. The
+// only change is that Exp-Golomb codes are calculated with 64 bits.
+class reference_bit_reader_c {
+private:
+  const unsigned char *m_end_of_data;
+  const unsigned char *m_byte_position;
+  std::size_t m_bits_valid;
+
+public:
+  reference_bit_reader_c(unsigned char const *data, std::size_t len)
+    : m_end_of_data{data + len}
+    , m_byte_position{data}
+    , m_bits_valid{len ? 8u : 0u}
+  {
+  }
+
+  uint64_t get_bits(std::size_t n) {
+    uint64_t r = 0;
+
+    while (n > 0) {
+      if (m_byte_position >= m_end_of_data)
+        throw mtx::mm_io::end_of_file_x();
+
+      std::size_t b = 8; // number of bits to extract from the current byte
+      if (b > n)
+        b = n;
+      if (b > m_bits_valid)
+        b = m_bits_valid;
+
+      std::size_t rshift = m_bits_valid - b;
+
+      r <<= b;
+      r  |= ((*m_byte_position) >> rshift) & (0xff >> (8 - b));
+
+      m_bits_valid -= b;
+      if (0 == m_bits_valid) {
+        m_bits_valid     = 8;
+        m_byte_position += 1;
+      }
+
+      n -= b;
+    }
+
+    return r;
+  }
+
+  int get_bit() {
+    return get_bits(1);
+  }
+
+  uint64_t get_unsigned_golomb() {
+    int n = 0;
+
+    while (get_bit() == 0)
+      ++n;
+
+    if (n > 63)
+      throw mtx::mm_io::end_of_file_x();
+
+    auto bits = get_bits(n);
+
+    return (uint64_t{1} << n) - 1 + bits;
+  }
+
+  int64_t get_signed_golomb() {
+    int64_t v = get_unsigned_golomb();
+    return v & 1 ? (v + 1) / 2 : -(v / 2);
+  }
+};
+
+static std::vector<memory_cptr>
+extract_slice_headers(memory_cptr const &data,
+                      bool hevc) {
+  // Only the beginning of each slice is kept. That's where the slice
+  // header is located.
+  auto const max_header_size  = 32u;
+  auto const nalu_header_size = hevc ? 2u : 1u;
+  std::vector<memory_cptr> slice_headers;
+
+  auto begin = data->get_buffer();
+  auto end   = begin + data->get_size();
+  auto start = mtx::mpeg::find_start_code(begin, end);
+
+  while (start != end) {
+    auto next      = mtx::mpeg::find_start_code(start + 3, end);
+    auto nalu      = start + 3;
+    auto nalu_size = static_cast<std::size_t>(next - nalu);
+    start          = next;
+
+    if (nalu_size <= nalu_header_size)
+      continue;
+
+    auto type     = hevc ? (nalu[0] >> 1) & 0x3f : nalu[0] & 0x1f;
+    auto is_slice = hevc ? (type <= 9) || ((type >= 16) && (type <= 21)) : (type == 1) || (type == 5);
+
+    if (!is_slice)
+      continue;
+
+    auto rbsp = mtx::mpeg::nalu_to_rbsp(memory_c::clone(nalu + nalu_header_size, std::min<std::size_t>(nalu_size - nalu_header_size, max_header_size + 8)));
+    rbsp->set_size(std::min<std::size_t>(rbsp->get_size(), max_header_size));
+    slice_headers.emplace_back(rbsp);
+  }
+
+  return slice_headers;
+}
+
+// Reads the header the way slice headers are parsed: Exp-Golomb codes
+// mixed with flags and short fixed-size fields.
+template<typename Treader>
+static uint64_t
+read_slice_header(memory_c const &header) {
+  Treader r{header.get_buffer(), header.get_size()};
+  uint64_t checksum = 0;
+
+  try {
+    while (true) {
+      checksum = checksum * 31 + r.get_unsigned_golomb();
+      checksum = checksum * 31 + r.get_unsigned_golomb();
+      checksum = checksum * 31 + r.get_bit();
+      checksum = checksum * 31 + r.get_bits(4);
+      checksum = checksum * 31 + r.get_signed_golomb();
+      checksum = checksum * 31 + r.get_bits(2);
+    }
+  } catch (mtx::mm_io::end_of_file_x &) {
+  }
+
+  return checksum;
+}
+
+template<typename Treader>
+static uint64_t
+read_all_slice_headers(std::vector<memory_cptr> const &slice_headers) {
+  uint64_t checksum = 0;
+
+  for (auto const &header : slice_headers)
+    checksum += read_slice_header<Treader>(*header);
+
+  return checksum;
+}
+
+template<typename Tfunc>
+static void
+run_benchmark(std::string const &name,
+              unsigned int iterations,
+              std::size_t num_headers,
+              Tfunc const &func) {
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto iteration = 0u; iteration < iterations; ++iteration)
+    func();
+
+  auto elapsed   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  auto per_slice = num_headers ? static_cast<double>(elapsed) / iterations / num_headers : 0.0;
+
+  mxinfo(boost::format("%|1$-30s| %|2$10.3f| ms  %|3$10.1f| ns/slice\n") % name % (elapsed / 1000000.0) % per_slice);
+}
+
+static void
+benchmark(cli_options_c const &options) {
+  auto in   = mm_file_io_c{options.m_file_name};
+  auto data = memory_c::alloc(in.get_size());
+  if (in.read(data, data->get_size()) != data->get_size())
+    mxerror("Could not read the file.\n");
+
+  auto slice_headers = extract_slice_headers(data, options.m_hevc);
+  auto total_size    = boost::accumulate(slice_headers, uint64_t{}, [](uint64_t sum, memory_cptr const &header) { return sum + header->get_size(); });
+
+  if (read_all_slice_headers<bit_reader_c>(slice_headers) != read_all_slice_headers<reference_bit_reader_c>(slice_headers))
+    mxerror("bit_reader_c: result differs from the reference implementation\n");
+
+  mxinfo(boost::format("%1% slice headers with %2% bytes, %3% iterations\n\n") % slice_headers.size() % total_size % options.m_iterations);
+
+  auto sink = uint64_t{};
+
+  run_benchmark("bit reader (reference)", options.m_iterations, slice_headers.size(), [&slice_headers, &sink]() {
+    sink += read_all_slice_headers<reference_bit_reader_c>(slice_headers);
+  });
+
+  run_benchmark("bit reader (current)", options.m_iterations, slice_headers.size(), [&slice_headers, &sink]() {
+    sink += read_all_slice_headers<bit_reader_c>(slice_headers);
+  });
+
+  // Keep the compiler from optimizing the reads away.
+  if (!sink)
+    mxinfo("\n");
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("bit_reader_benchmark", argv[0]);
+
+  auto args    = command_line_utf8(argc, argv);
+  auto options = parse_args(args);
+
+  try {
+    benchmark(options);
+  } catch (mtx::mm_io::exception &) {
+    mxerror(Y("File not found\n"));
+  }
+
+  mxexit();
+}
@@ -10,6 +10,8 @@
 
 #include "common/common_pch.h"
 
+#include <chrono>
+
 #include "common/bswap.h"
 #include "common/checksums/crc.h"
 #include "common/command_line.h"
@@ -24,7 +26,8 @@ public:
   mtx::checksum::algorithm_e m_algorithm{mtx::checksum::algorithm_e::adler32};
   size_t m_chunk_size{4096};
   uint64_t m_initial_value{}, m_xor_result{};
-  bool m_result_in_le{};
+  bool m_result_in_le{}, m_benchmark{};
+  unsigned int m_iterations{10};
 };
 
 static void
@@ -60,6 +63,13 @@ setup_help_and_version_info() {
          "  --result-in-le         Output the result in Little Endian (default:\n"
          "                         Big Endian)\n"
          "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  -b, --benchmark        Measure the throughput of all algorithms instead\n"
+         "                         of outputting a checksum. The file is optional;\n"
+         "                         64 MB of generated data are used without one.\n"
+         "  -i, --iterations num   Process the data this many times (default: 10)\n"
+         "\n"
          "General options:\n"
          "\n"
          "  -h, --help             This help text\n"
@@ -132,6 +142,20 @@ parse_args(std::vector<std::string> &args) {
     } else if (arg == "--result-in-le")
       options.m_result_in_le = true;
 
+    else if ((arg == "-b") || (arg == "--benchmark"))
+      options.m_benchmark = true;
+
+    else if ((arg == "-i") || (arg == "--iterations")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      if (!parse_number(next_arg, options.m_iterations) || !options.m_iterations)
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    }
+
     else if (!options.m_file_name.empty())
       mxerror("More than one source file was given.\n");
 
@@ -139,7 +163,7 @@ parse_args(std::vector<std::string> &args) {
       options.m_file_name = arg;
   }
 
-  if (options.m_file_name.empty())
+  if (options.m_file_name.empty() && !options.m_benchmark)
     mxerror("No file name given\n");
 
   return options;
@@ -186,6 +210,64 @@ parse_file(cli_options_c const &options) {
   mxinfo(boost::format("%1%  %2%\n") % output % options.m_file_name);
 }
 
+static memory_cptr
+read_or_generate_benchmark_data(cli_options_c const &options) {
+  if (!options.m_file_name.empty()) {
+    auto in   = mm_file_io_c{options.m_file_name};
+    auto data = memory_c::alloc(in.get_size());
+    if (in.read(data, data->get_size()) != data->get_size())
+      mxerror("Could not read the file.\n");
+
+    return data;
+  }
+
+  auto data  = memory_c::alloc(64 * 1024 * 1024);
+  auto ptr   = data->get_buffer();
+  auto state = uint32_t{1};
+
+  for (auto idx = 0u, size = static_cast<unsigned int>(data->get_size()); idx < size; ++idx) {
+    state    = state * 1103515245u + 12345u;
+    ptr[idx] = state >> 24;
+  }
+
+  return data;
+}
+
+static void
+benchmark(cli_options_c const &options) {
+  static std::vector<std::pair<std::string, mtx::checksum::algorithm_e>> const s_algorithms{
+    { "Adler32",            mtx::checksum::algorithm_e::adler32       },
+    { "CRC-8 ATM",          mtx::checksum::algorithm_e::crc8_atm      },
+    { "CRC-16 ANSI",        mtx::checksum::algorithm_e::crc16_ansi    },
+    { "CRC-16 CCITT",       mtx::checksum::algorithm_e::crc16_ccitt   },
+    { "CRC-32 IEEE",        mtx::checksum::algorithm_e::crc32_ieee    },
+    { "CRC-32 IEEE LE",     mtx::checksum::algorithm_e::crc32_ieee_le },
+    { "MD5",                mtx::checksum::algorithm_e::md5           },
+  };
+
+  auto data       = read_or_generate_benchmark_data(options);
+  auto total_size = data->get_size();
+  auto chunk_size = !options.m_chunk_size ? total_size : std::min<std::size_t>(total_size, options.m_chunk_size);
+
+  mxinfo(boost::format("%1% bytes in chunks of %2% bytes, %3% iterations\n\n") % total_size % chunk_size % options.m_iterations);
+
+  for (auto const &algorithm : s_algorithms) {
+    auto worker = mtx::checksum::for_algorithm(algorithm.second);
+    auto start  = std::chrono::steady_clock::now();
+
+    for (auto iteration = 0u; iteration < options.m_iterations; ++iteration)
+      for (auto offset = std::size_t{}; offset < total_size; offset += chunk_size)
+        worker->add(data->get_buffer() + offset, std::min(chunk_size, total_size - offset));
+
+    worker->finish();
+
+    auto elapsed    = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    auto throughput = elapsed ? static_cast<double>(total_size) * options.m_iterations / elapsed : 0.0;
+
+    mxinfo(boost::format("%|1$-20s| %|2$10.3f| ms  %|3$10.1f| MB/s\n") % algorithm.first % (elapsed / 1000.0) % throughput);
+  }
+}
+
 int
 main(int argc,
      char **argv) {
@@ -199,7 +281,10 @@ main(int argc,
   auto options = parse_args(args);
 
   try {
-    parse_file(options);
+    if (options.m_benchmark)
+      benchmark(options);
+    else
+      parse_file(options);
   } catch (mtx::mm_io::exception &) {
     mxerror("File not found\n");
   }
@@ -0,0 +1,245 @@
+/*
+   pcm_benchmark - A tool for benchmarking the PCM byte swapping and repacking
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/bswap.h"
+#include "common/command_line.h"
+#include "common/endian.h"
+#include "common/pcm.h"
+#include "common/strings/parsing.h"
+
+class cli_options_c {
+public:
+  unsigned int m_hours{3}, m_sampling_frequency{48000}, m_channels{8}, m_bits_per_sample{24};
+};
+
+static void
+show_help() {
+  mxinfo("pcm_benchmark [options]\n"
+         "\n"
+         "Measures how long byte-swapping a big endian PCM track and removing\n"
+         "the padding channel from Blu-ray PCM takes. The track is processed\n"
+         "in packets of 5 ms the way the PCM packetizer and the Blu-ray PCM\n"
+         "channel removal receive them. The implementations MKVToolNix used\n"
+         "to have are compared to the current ones.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  -d, --duration hours   Length of the track in hours (default: 3)\n"
+         "  -f, --frequency freq   Sampling frequency (default: 48000)\n"
+         "  -c, --channels num     Number of channels including the padding\n"
+         "                         channel (default: 8)\n"
+         "  -b, --bits num         Bits per sample: 16, 24 or 32 (default: 24)\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("pcm_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+    auto value    = static_cast<unsigned int *>(nullptr);
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if ((arg == "-d") || (arg == "--duration"))
+      value = &options.m_hours;
+
+    else if ((arg == "-f") || (arg == "--frequency"))
+      value = &options.m_sampling_frequency;
+
+    else if ((arg == "-c") || (arg == "--channels"))
+      value = &options.m_channels;
+
+    else if ((arg == "-b") || (arg == "--bits"))
+      value = &options.m_bits_per_sample;
+
+    else
+      mxerror(boost::format("Unknown option: %1%\n") % arg);
+
+    if (!value)
+      continue;
+
+    if (next_arg.empty())
+      mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+    if (!parse_number(next_arg, *value) || !*value)
+      mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+    ++current;
+  }
+
+  if ((options.m_bits_per_sample != 16) && (options.m_bits_per_sample != 24) && (options.m_bits_per_sample != 32))
+    mxerror("Only 16, 24 and 32 bits per sample are supported.\n");
+
+  if (options.m_channels < 2)
+    mxerror("At least two channels are required.\n");
+
+  return options;
+}
+
+// The implementations as they were before they were vectorized. They
+// serve as the baseline and for verifying the results.
+static void
+reference_bswap_buffer(unsigned char const *src,
+                       unsigned char *dst,
+                       std::size_t num_bytes,
+                       std::size_t word_length) {
+  for (std::size_t idx = 0; idx < num_bytes; idx += word_length)
+    put_uint_le(&dst[idx], get_uint_be(&src[idx], word_length), word_length);
+}
+
+static std::size_t
+reference_remove_trailing_channels(unsigned char *buffer,
+                                   std::size_t num_bytes,
+                                   std::size_t bytes_per_channel,
+                                   std::size_t num_input_channels,
+                                   std::size_t num_output_channels) {
+  auto end_ptr                    = buffer + num_bytes;
+  auto input_ptr                  = buffer;
+  auto output_ptr                 = buffer;
+  auto input_bytes_per_iteration  = bytes_per_channel * num_input_channels;
+  auto output_bytes_per_iteration = bytes_per_channel * num_output_channels;
+
+  while ((input_ptr + input_bytes_per_iteration) <= end_ptr) {
+    if (input_ptr != output_ptr)
+      std::memmove(output_ptr, input_ptr, output_bytes_per_iteration);
+
+    input_ptr  += input_bytes_per_iteration;
+    output_ptr += output_bytes_per_iteration;
+  }
+
+  return output_ptr - buffer;
+}
+
+template<typename Tfunc>
+static void
+run_benchmark(std::string const &name,
+              uint64_t total_size,
+              Tfunc const &func) {
+  auto start = std::chrono::steady_clock::now();
+
+  func();
+
+  auto elapsed    = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  auto throughput = elapsed ? static_cast<double>(total_size) / elapsed : 0.0;
+
+  mxinfo(boost::format("%|1$-30s| %|2$10.3f| ms  %|3$10.1f| MB/s\n") % name % (elapsed / 1000.0) % throughput);
+}
+
+static void
+benchmark(cli_options_c const &options) {
+  auto bytes_per_sample  = options.m_bits_per_sample / 8;
+  auto frame_size        = bytes_per_sample * options.m_channels;
+  auto packet_size       = frame_size * options.m_sampling_frequency / 200;
+  auto packets_per_hour  = uint64_t{3600} * 200;
+  auto num_packets       = packets_per_hour * options.m_hours;
+  auto total_size        = num_packets * packet_size;
+
+  // One second of noise is re-used for all packets.
+  auto source = memory_c::alloc(packet_size * 200);
+  auto work   = memory_c::alloc(packet_size);
+  auto check  = memory_c::alloc(packet_size);
+  auto state  = uint32_t{1};
+
+  for (auto idx = 0u, size = static_cast<unsigned int>(source->get_size()); idx < size; ++idx) {
+    state                     = state * 1103515245u + 12345u;
+    source->get_buffer()[idx] = state >> 24;
+  }
+
+  auto packet = [&source, packet_size](uint64_t idx) {
+    return source->get_buffer() + (idx % 200) * packet_size;
+  };
+
+  for (auto idx = 0u; idx < 200; ++idx) {
+    reference_bswap_buffer(packet(idx), check->get_buffer(), packet_size, bytes_per_sample);
+    mtx::bswap_buffer(packet(idx), work->get_buffer(), packet_size, bytes_per_sample);
+    if (*work != *check)
+      mxerror("bswap_buffer(): result differs from the reference implementation\n");
+
+    std::memcpy(check->get_buffer(), packet(idx), packet_size);
+    std::memcpy(work->get_buffer(),  packet(idx), packet_size);
+    auto reference_size = reference_remove_trailing_channels(check->get_buffer(), packet_size, bytes_per_sample, options.m_channels, options.m_channels - 1);
+    auto size           = mtx::pcm::remove_trailing_channels(work->get_buffer(),  packet_size, bytes_per_sample, options.m_channels, options.m_channels - 1);
+    if ((size != reference_size) || std::memcmp(work->get_buffer(), check->get_buffer(), size))
+      mxerror("remove_trailing_channels(): result differs from the reference implementation\n");
+  }
+
+  mxinfo(boost::format("%1% hours of %2% Hz, %3% channels, %4% bits per sample: %5% packets with %6% bytes, %7% bytes\n\n")
+         % options.m_hours % options.m_sampling_frequency % options.m_channels % options.m_bits_per_sample % num_packets % packet_size % total_size);
+
+  // Both the PCM packetizer and the extractor swap in place.
+  auto work_ptr = work->get_buffer();
+
+  run_benchmark("bswap_buffer (reference)", total_size, [&]() {
+    for (auto idx = uint64_t{}; idx < num_packets; ++idx)
+      reference_bswap_buffer(work_ptr, work_ptr, packet_size, bytes_per_sample);
+  });
+
+  run_benchmark("bswap_buffer", total_size, [&]() {
+    for (auto idx = uint64_t{}; idx < num_packets; ++idx)
+      mtx::bswap_buffer(work_ptr, work_ptr, packet_size, bytes_per_sample);
+  });
+
+  // Removing channels destroys the packet; each packet is copied
+  // first for both implementations.
+  run_benchmark("copy only", total_size, [&]() {
+    for (auto idx = uint64_t{}; idx < num_packets; ++idx)
+      std::memcpy(work_ptr, packet(idx), packet_size);
+  });
+
+  run_benchmark("remove channel (reference)", total_size, [&]() {
+    for (auto idx = uint64_t{}; idx < num_packets; ++idx) {
+      std::memcpy(work_ptr, packet(idx), packet_size);
+      reference_remove_trailing_channels(work_ptr, packet_size, bytes_per_sample, options.m_channels, options.m_channels - 1);
+    }
+  });
+
+  run_benchmark("remove channel", total_size, [&]() {
+    for (auto idx = uint64_t{}; idx < num_packets; ++idx) {
+      std::memcpy(work_ptr, packet(idx), packet_size);
+      mtx::pcm::remove_trailing_channels(work_ptr, packet_size, bytes_per_sample, options.m_channels, options.m_channels - 1);
+    }
+  });
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("pcm_benchmark", argv[0]);
+
+  auto args    = command_line_utf8(argc, argv);
+  auto options = parse_args(args);
+
+  benchmark(options);
+
+  mxexit();
+}
@@ -0,0 +1,245 @@
+/*
+   rbsp_benchmark - A tool for benchmarking the NALU/RBSP conversion
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/command_line.h"
+#include "common/mm_io_x.h"
+#include "common/mpeg.h"
+#include "common/strings/parsing.h"
+
+class cli_options_c {
+public:
+  std::string m_file_name;
+  unsigned int m_iterations{10};
+};
+
+static void
+show_help() {
+  mxinfo("rbsp_benchmark [options] input_file_name\n"
+         "\n"
+         "Splits an AVC/h.264 or HEVC/h.265 elementary stream into NALUs and\n"
+         "measures how long converting all of them to RBSPs and back takes. The\n"
+         "byte-by-byte implementation MKVToolNix used to have is compared to the\n"
+         "current one both allocating a new buffer per NALU and reusing a buffer.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  -i, --iterations num   Convert all NALUs this many times (default: 10)\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("rbsp_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if ((arg == "-i") || (arg == "--iterations")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      if (!parse_number(next_arg, options.m_iterations) || !options.m_iterations)
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    } else if (!options.m_file_name.empty())
+      mxerror(Y("More than one source file was given.\n"));
+
+    else
+      options.m_file_name = arg;
+  }
+
+  if (options.m_file_name.empty())
+    mxerror(Y("No file name given\n"));
+
+  return options;
+}
+
+// The implementations as they were before the conversion was
+// vectorized. They serve as the baseline and for verifying the
+// results.
+static memory_cptr
+reference_nalu_to_rbsp(memory_cptr const &buffer) {
+  int pos, size = buffer->get_size();
+  mm_mem_io_c d(nullptr, size, 100);
+  unsigned char *b = buffer->get_buffer();
+
+  for (pos = 0; pos < size; ++pos) {
+    if (   ((pos + 2) < size)
+        && (0 == b[pos])
+        && (0 == b[pos + 1])
+        && (3 == b[pos + 2])) {
+      d.write_uint8(0);
+      d.write_uint8(0);
+      pos += 2;
+
+    } else
+      d.write_uint8(b[pos]);
+  }
+
+  return std::make_shared<memory_c>(d.get_and_lock_buffer(), d.getFilePointer(), true);
+}
+
+static memory_cptr
+reference_rbsp_to_nalu(memory_cptr const &buffer) {
+  int pos, size = buffer->get_size();
+  mm_mem_io_c d(nullptr, size, 100);
+  unsigned char *b = buffer->get_buffer();
+
+  for (pos = 0; pos < size; ++pos) {
+    if (   ((pos + 2) < size)
+        && (0 == b[pos])
+        && (0 == b[pos + 1])
+        && (3 >= b[pos + 2])) {
+      d.write_uint8(0);
+      d.write_uint8(0);
+      d.write_uint8(3);
+      ++pos;
+
+    } else
+      d.write_uint8(b[pos]);
+  }
+
+  return std::make_shared<memory_c>(d.get_and_lock_buffer(), d.getFilePointer(), true);
+}
+
+static std::vector<memory_cptr>
+split_into_nalus(memory_cptr const &data) {
+  std::vector<memory_cptr> nalus;
+
+  auto begin = data->get_buffer();
+  auto end   = begin + data->get_size();
+  auto start = mtx::mpeg::find_start_code(begin, end);
+
+  while (start != end) {
+    auto next = mtx::mpeg::find_start_code(start + 3, end);
+    nalus.emplace_back(memory_c::clone(start + 3, next - start - 3));
+    mtx::mpeg::remove_trailing_zero_bytes(*nalus.back());
+    start = next;
+  }
+
+  return nalus;
+}
+
+template<typename Tfunc>
+static void
+run_benchmark(std::string const &name,
+              unsigned int iterations,
+              uint64_t total_size,
+              Tfunc const &func) {
+  auto start = std::chrono::steady_clock::now();
+
+  for (auto iteration = 0u; iteration < iterations; ++iteration)
+    func();
+
+  auto elapsed    = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  auto throughput = elapsed ? static_cast<double>(total_size) * iterations / elapsed : 0.0;
+
+  mxinfo(boost::format("%|1$-30s| %|2$10.3f| ms  %|3$10.1f| MB/s\n") % name % (elapsed / 1000.0) % throughput);
+}
+
+static void
+benchmark(cli_options_c const &options) {
+  auto in    = mm_file_io_c{options.m_file_name};
+  auto data  = memory_c::alloc(in.get_size());
+  if (in.read(data, data->get_size()) != data->get_size())
+    mxerror("Could not read the file.\n");
+
+  auto nalus      = split_into_nalus(data);
+  auto total_size = uint64_t{};
+  std::vector<memory_cptr> rbsps;
+
+  for (auto const &nalu : nalus) {
+    total_size += nalu->get_size();
+    rbsps.emplace_back(reference_nalu_to_rbsp(nalu));
+
+    auto converted = mtx::mpeg::nalu_to_rbsp(nalu);
+    if (*converted != *rbsps.back())
+      mxerror("nalu_to_rbsp(): result differs from the reference implementation\n");
+
+    if (*mtx::mpeg::rbsp_to_nalu(rbsps.back()) != *reference_rbsp_to_nalu(rbsps.back()))
+      mxerror("rbsp_to_nalu(): result differs from the reference implementation\n");
+  }
+
+  mxinfo(boost::format("%1% NALUs with %2% bytes, %3% iterations\n\n") % nalus.size() % total_size % options.m_iterations);
+
+  memory_c reusable;
+
+  run_benchmark("nalu_to_rbsp (reference)", options.m_iterations, total_size, [&nalus]() {
+    for (auto const &nalu : nalus)
+      reference_nalu_to_rbsp(nalu);
+  });
+
+  run_benchmark("nalu_to_rbsp (allocating)", options.m_iterations, total_size, [&nalus]() {
+    for (auto const &nalu : nalus)
+      mtx::mpeg::nalu_to_rbsp(nalu);
+  });
+
+  run_benchmark("nalu_to_rbsp (reusing buffer)", options.m_iterations, total_size, [&nalus, &reusable]() {
+    for (auto const &nalu : nalus)
+      mtx::mpeg::nalu_to_rbsp(nalu->get_buffer(), nalu->get_size(), reusable);
+  });
+
+  run_benchmark("rbsp_to_nalu (reference)", options.m_iterations, total_size, [&rbsps]() {
+    for (auto const &rbsp : rbsps)
+      reference_rbsp_to_nalu(rbsp);
+  });
+
+  run_benchmark("rbsp_to_nalu (allocating)", options.m_iterations, total_size, [&rbsps]() {
+    for (auto const &rbsp : rbsps)
+      mtx::mpeg::rbsp_to_nalu(rbsp);
+  });
+
+  run_benchmark("rbsp_to_nalu (reusing buffer)", options.m_iterations, total_size, [&rbsps, &reusable]() {
+    for (auto const &rbsp : rbsps)
+      mtx::mpeg::rbsp_to_nalu(rbsp->get_buffer(), rbsp->get_size(), reusable);
+  });
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("rbsp_benchmark", argv[0]);
+
+  auto args    = command_line_utf8(argc, argv);
+  auto options = parse_args(args);
+
+  try {
+    benchmark(options);
+  } catch (mtx::mm_io::exception &) {
+    mxerror(Y("File not found\n"));
+  }
+
+  mxexit();
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/ruby -w
+
+# T_601cluster_crc32
+describe "mkvmerge / CRC-32 elements in clusters; mkvinfo / verifying them"
+
+source = "data/avi/v-h264-aac.avi"
+
+# Returns the cue points as "time/track/cluster number". Fails if a cue
+# point doesn't refer to the start of a cluster.
+def cue_points_with_cluster_numbers file_name
+  segment_data_start = nil
+  clusters           = []
+  cue_points         = []
+  cue_time           = nil
+  cue_track          = nil
+
+  info("-v -v #{file_name}", :output => :return).first.each do |line|
+    if %r{\+ Segment, size \d+ at (\d+)}.match(line)
+      # mkvmerge writes the segment's size with eight bytes.
+      segment_data_start = $1.to_i + 12
+    elsif %r{\+ Cluster at (\d+)}.match(line)
+      clusters << $1.to_i
+    elsif %r{\+ Cue time: ([\d.]+)s}.match(line)
+      cue_time = $1
+    elsif %r{\+ Cue track: (\d+)}.match(line)
+      cue_track = $1
+    elsif %r{\+ Cue cluster position: (\d+)}.match(line)
+      cue_points << [ cue_time, cue_track, segment_data_start + $1.to_i ]
+    end
+  end
+
+  cue_points.map do |time, track, position|
+    cluster_number = clusters.index(position)
+    self.error "The cue point at #{time}s for track #{track} doesn't refer to a cluster" if !cluster_number
+    "#{time}/#{track}/#{cluster_number}"
+  end
+end
+
+test "verifying the CRC-32 elements" do
+  merge "--cluster-crc32 #{source}"
+  output, _ = info("--verify-crc #{tmp}", :output => :return)
+  clean_tmp
+
+  %r{ 0 of them are damaged}.match(output.join('')) ? :ok : :bad
+end
+
+test "cue points with and without CRC-32 elements" do
+  with_crc32    = tmp_name
+  without_crc32 = tmp_name
+
+  merge "--cluster-crc32 #{source}", :output => with_crc32
+  merge source,                      :output => without_crc32
+
+  cue_points = [ with_crc32, without_crc32 ].map { |file_name| cue_points_with_cluster_numbers file_name }
+
+  self.error "No cue points were written" if cue_points.first.empty?
+
+  cue_points.first == cue_points.last ? :ok : :bad
+end
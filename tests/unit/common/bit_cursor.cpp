@@ -111,6 +111,44 @@ TEST(BitReader, GetSignedGolomb) {
   EXPECT_EQ(13, b.get_bit_position());
 }
 
+TEST(BitReader, GetGolombAcrossWords) {
+  unsigned char value[32];
+  std::memset(value, 0, 32);
+
+  // Codes of increasing length so that they straddle the boundaries
+  // of the 64-bit words the reader loads.
+  auto w = bit_writer_c{value, 32};
+  for (auto n = 0u; n < 16; ++n) {
+    w.put_bits(n, 0);
+    w.put_bit(1);
+    w.put_bits(n, n);
+  }
+
+  auto b = bit_reader_c{value, 32};
+  for (auto n = 0u; n < 16; ++n)
+    EXPECT_EQ((1u << n) - 1 + n, b.get_unsigned_golomb());
+
+  EXPECT_EQ(16 * 16, b.get_bit_position());
+  EXPECT_FALSE(b.eof());
+}
+
+TEST(BitReader, GetBitsAcrossWords) {
+  unsigned char value[24];
+  for (auto idx = 0u; idx < 24; ++idx)
+    value[idx] = (idx % 16) * 0x11;
+
+  auto b = bit_reader_c{value, 24};
+
+  EXPECT_EQ(0x0,                 b.get_bits(4));
+  EXPECT_EQ(0x011223344556677ull, b.get_bits(60));
+  EXPECT_EQ(0x8899aabbccddeefull, b.get_bits(60));
+  EXPECT_EQ(0xf,                  b.get_bits(4));
+  EXPECT_EQ(0x001122334455667ull, b.get_bits(60));
+  EXPECT_EQ(4, b.get_remaining_bits());
+  EXPECT_THROW(b.get_bits(5), mtx::mm_io::end_of_file_x);
+  EXPECT_TRUE(b.eof());
+}
+
 TEST(BitReader, PeekBits) {
   unsigned char value[4];
   put_uint32_be(value, 0xf7234a81);
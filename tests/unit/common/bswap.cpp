@@ -0,0 +1,98 @@
+#include "common/common_pch.h"
+
+#include "common/bswap.h"
+#include "common/pcm.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<unsigned char>
+create_data(std::size_t size) {
+  std::vector<unsigned char> data(size);
+
+  for (auto idx = 0u; idx < size; ++idx)
+    data[idx] = (idx * 13 + 7) & 0xff;
+
+  return data;
+}
+
+TEST(BSwap, BufferAllWordLengths) {
+  // Sizes beyond the ones handled by the vectorized code
+  for (auto word_length : std::vector<std::size_t>{ 1, 2, 3, 4, 5, 8 })
+    for (auto num_words = 0u; num_words < 100; ++num_words) {
+      auto num_bytes = num_words * word_length;
+      auto src       = create_data(num_bytes);
+      auto expected  = src;
+      auto dst       = std::vector<unsigned char>(num_bytes);
+
+      for (auto idx = 0u; idx < num_bytes; idx += word_length)
+        std::reverse(&expected[idx], &expected[idx + word_length]);
+
+      mtx::bswap_buffer(src.data(), dst.data(), num_bytes, word_length);
+      EXPECT_EQ(expected, dst);
+
+      mtx::bswap_buffer(src.data(), src.data(), num_bytes, word_length);
+      EXPECT_EQ(expected, src);
+    }
+}
+
+TEST(BSwap, BufferInvalidSize) {
+  unsigned char buffer[5];
+
+  EXPECT_THROW(mtx::bswap_buffer(buffer, buffer, 5, 2), std::invalid_argument);
+  EXPECT_NO_THROW(mtx::bswap_buffer(buffer, buffer, 4, 2));
+}
+
+TEST(PCM, RemoveTrailingChannels) {
+  for (auto bytes_per_channel : std::vector<std::size_t>{ 2, 3 })
+    for (auto num_input_channels : std::vector<std::size_t>{ 2, 4, 6, 8 })
+      for (auto num_bytes = 0u; num_bytes < 300; num_bytes += 5) {
+        auto data              = create_data(num_bytes);
+        auto input_frame_size  = bytes_per_channel * num_input_channels;
+        auto output_frame_size = input_frame_size - bytes_per_channel;
+        auto expected          = std::vector<unsigned char>{};
+
+        for (auto frame = 0u; ((frame + 1) * input_frame_size) <= num_bytes; ++frame)
+          expected.insert(expected.end(), &data[frame * input_frame_size], &data[frame * input_frame_size + output_frame_size]);
+
+        auto size = mtx::pcm::remove_trailing_channels(data.data(), num_bytes, bytes_per_channel, num_input_channels, num_input_channels - 1);
+        data.resize(size);
+
+        EXPECT_EQ(expected, data);
+      }
+}
+
+TEST(PCM, RemoveTrailingChannelsBluRayLayouts) {
+  // 24-bit samples with five and seven channels: frames of 18 and 24
+  // bytes are reduced to 15 and 21 bytes.
+  for (auto num_input_channels : std::vector<std::size_t>{ 6, 8 })
+    for (auto num_frames : std::vector<std::size_t>{ 0, 1, 2, 3, 7, 64, 1001 })
+      for (auto extra_bytes : std::vector<std::size_t>{ 0, 5 }) {
+        auto input_frame_size  = 3 * num_input_channels;
+        auto output_frame_size = input_frame_size - 3;
+        auto num_bytes         = num_frames * input_frame_size + extra_bytes;
+        auto data              = create_data(num_bytes);
+        auto expected          = std::vector<unsigned char>{};
+
+        for (auto frame = 0u; frame < num_frames; ++frame)
+          expected.insert(expected.end(), &data[frame * input_frame_size], &data[frame * input_frame_size + output_frame_size]);
+
+        auto size = mtx::pcm::remove_trailing_channels(data.data(), num_bytes, 3, num_input_channels, num_input_channels - 1);
+
+        EXPECT_EQ(num_frames * output_frame_size, size);
+
+        data.resize(size);
+
+        EXPECT_EQ(expected, data);
+      }
+}
+
+TEST(PCM, RemoveTrailingChannelsNothingToRemove) {
+  auto data = create_data(100);
+
+  EXPECT_EQ(96u, mtx::pcm::remove_trailing_channels(data.data(), 100, 3, 2, 2));
+  EXPECT_EQ(create_data(100), data);
+}
+
+}
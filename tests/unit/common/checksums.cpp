@@ -71,6 +71,7 @@ public:
 TEST_F(ChecksumTest, OneTwoThree) {
   auto ptr  = reinterpret_cast<unsigned char const *>(m_onetwothree.c_str());
 
+  EXPECT_EQ(0x091e01de, mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::adler32,       ptr, m_onetwothree.length(),          0));
   EXPECT_EQ(0xf4,       mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::crc8_atm,      ptr, m_onetwothree.length(),          0));
   EXPECT_EQ(0xe8fe,     mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::crc16_ansi,    ptr, m_onetwothree.length(),          0));
   EXPECT_EQ(0xc331,     mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::crc16_ccitt,   ptr, m_onetwothree.length(),          0));
@@ -81,6 +82,7 @@ TEST_F(ChecksumTest, OneTwoThree) {
 }
 
 TEST_F(ChecksumTest, FileAllInOne) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, m_data->get_size()));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, m_data->get_size()));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, m_data->get_size()));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, m_data->get_size()));
@@ -90,6 +92,7 @@ TEST_F(ChecksumTest, FileAllInOne) {
 }
 
 TEST_F(ChecksumTest, FileChunked37) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, 37));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, 37));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, 37));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, 37));
@@ -99,6 +102,7 @@ TEST_F(ChecksumTest, FileChunked37) {
 }
 
 TEST_F(ChecksumTest, FileChunked63) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, 63));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, 63));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, 63));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, 63));
@@ -108,6 +112,7 @@ TEST_F(ChecksumTest, FileChunked63) {
 }
 
 TEST_F(ChecksumTest, FileChunked64) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, 64));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, 64));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, 64));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, 64));
@@ -117,6 +122,7 @@ TEST_F(ChecksumTest, FileChunked64) {
 }
 
 TEST_F(ChecksumTest, FileChunked65) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, 65));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, 65));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, 65));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, 65));
@@ -126,6 +132,7 @@ TEST_F(ChecksumTest, FileChunked65) {
 }
 
 TEST_F(ChecksumTest, FileChunked1000) {
+  EXPECT_EQ(0x1dcb8444,   calculate_int(mtx::checksum::algorithm_e::adler32,                0, 1000));
   EXPECT_EQ(0xab,         calculate_int(mtx::checksum::algorithm_e::crc8_atm,               0, 1000));
   EXPECT_EQ(0x18fe,       calculate_int(mtx::checksum::algorithm_e::crc16_ansi,             0, 1000));
   EXPECT_EQ(0x218f,       calculate_int(mtx::checksum::algorithm_e::crc16_ccitt,            0, 1000));
@@ -134,4 +141,30 @@ TEST_F(ChecksumTest, FileChunked1000) {
   EXPECT_EQ(*m_data_md5, *calculate_bin(mtx::checksum::algorithm_e::md5,                       1000));
 }
 
+TEST_F(ChecksumTest, LargeBuffer) {
+  // Large enough for the vectorized implementations and for the
+  // deferred modulo reduction of Adler-32.
+  auto data = memory_c::alloc(1000003);
+  auto ptr  = data->get_buffer();
+  auto size = data->get_size();
+
+  for (auto idx = 0u; idx < size; ++idx)
+    ptr[idx] = (idx * 7 + (idx >> 8)) & 0xff;
+
+  for (auto algorithm : { mtx::checksum::algorithm_e::adler32, mtx::checksum::algorithm_e::crc8_atm, mtx::checksum::algorithm_e::crc16_ansi, mtx::checksum::algorithm_e::crc16_ccitt,
+                          mtx::checksum::algorithm_e::crc32_ieee, mtx::checksum::algorithm_e::crc32_ieee_le }) {
+    auto worker = mtx::checksum::for_algorithm(algorithm, 0xffffffff);
+
+    for (auto offset = 0u, chunk_size = 1u; offset < size; offset += chunk_size, chunk_size = chunk_size * 3 + 1)
+      worker->add(ptr + offset, std::min<size_t>(chunk_size, size - offset));
+
+    worker->finish();
+
+    EXPECT_EQ(mtx::checksum::calculate_as_uint(algorithm, ptr, size, 0xffffffff), dynamic_cast<mtx::checksum::uint_result_c &>(*worker).get_result_as_uint());
+  }
+
+  EXPECT_EQ(0xc884f4b3, mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::adler32,       ptr, size,          0));
+  EXPECT_EQ(0xdc5c3edb, mtx::checksum::calculate_as_uint(mtx::checksum::algorithm_e::crc32_ieee_le, ptr, size, 0xffffffff));
+}
+
 }
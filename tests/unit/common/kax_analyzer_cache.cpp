@@ -0,0 +1,58 @@
+#include "common/common_pch.h"
+
+#include <matroska/KaxCluster.h>
+#include <matroska/KaxInfo.h>
+
+#include "common/kax_analyzer_cache.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(KaxAnalyzerCache, StoreAndLoad) {
+  auto directory = bfs::temp_directory_path() / bfs::unique_path("mtx-kax-analyzer-cache-%%%%-%%%%");
+  auto file_name = (directory / "file.mkv").string();
+
+  mtx::kax_analyzer_cache::set_directory(directory);
+
+  EXPECT_FALSE(!!mtx::kax_analyzer_cache::load(file_name));
+
+  auto entry                = mtx::kax_analyzer_cache::entry_t{};
+  entry.m_file_name         = bfs::absolute(file_name).string();
+  entry.m_segment_uid       = "00112233445566778899aabbccddeeff";
+  entry.m_file_size         = 123456789012ull;
+  entry.m_segment_position  = 40;
+  entry.m_modification_time = 1500000000;
+  entry.m_parsed_fully      = true;
+  entry.m_data.push_back(kax_analyzer_data_c::create(EBML_ID(KaxInfo),    52,    100));
+  entry.m_data.push_back(kax_analyzer_data_c::create(EBML_ID(KaxCluster), 152, 20000, false));
+
+  mtx::kax_analyzer_cache::store(entry);
+
+  auto loaded = mtx::kax_analyzer_cache::load(file_name);
+
+  ASSERT_TRUE(!!loaded);
+  EXPECT_EQ(entry.m_file_name,         loaded->m_file_name);
+  EXPECT_EQ(entry.m_segment_uid,       loaded->m_segment_uid);
+  EXPECT_EQ(entry.m_file_size,         loaded->m_file_size);
+  EXPECT_EQ(entry.m_segment_position,  loaded->m_segment_position);
+  EXPECT_EQ(entry.m_modification_time, loaded->m_modification_time);
+  EXPECT_TRUE(loaded->m_parsed_fully);
+
+  ASSERT_EQ(2u, loaded->m_data.size());
+  EXPECT_TRUE(EBML_ID(KaxInfo)    == loaded->m_data[0]->m_id);
+  EXPECT_TRUE(EBML_ID(KaxCluster) == loaded->m_data[1]->m_id);
+  EXPECT_EQ(152u,   loaded->m_data[1]->m_pos);
+  EXPECT_EQ(20000,  loaded->m_data[1]->m_size);
+  EXPECT_FALSE(loaded->m_data[1]->m_size_known);
+
+  EXPECT_FALSE(!!mtx::kax_analyzer_cache::load((directory / "other.mkv").string()));
+
+  mtx::kax_analyzer_cache::set_directory({});
+  EXPECT_FALSE(!!mtx::kax_analyzer_cache::load(file_name));
+
+  boost::system::error_code ec;
+  bfs::remove_all(directory, ec);
+}
+
+}
@@ -0,0 +1,113 @@
+#include "common/common_pch.h"
+
+#include "common/kax_block_scanner.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(KaxBlockScanner, SimpleBlocks) {
+  unsigned char const data[] = {
+    0xe7, 0x82, 0x03, 0xe8,                                   // ClusterTimecode 1000
+    0xa3, 0x86, 0x81, 0xff, 0xf6, 0x80, 0x01, 0x02,           // SimpleBlock track 1, -10, keyframe, no lacing
+    0xec, 0x81, 0x00,                                         // Void
+    0xa3, 0x86, 0x82, 0x00, 0x05, 0x01, 0x03, 0x04,           // SimpleBlock track 2, 5, discardable
+    0xa3, 0x8b, 0x81, 0x00, 0x14, 0x02, 0x02, 0x01, 0x02, 0x0a, 0x0b, 0x0c, 0x0d, // Xiph lacing: 1 + 2 + 1 bytes
+  };
+
+  kax_block_scanner_c scanner;
+
+  ASSERT_TRUE(scanner.scan(data, sizeof(data)));
+  EXPECT_EQ(1000u, scanner.get_cluster_timecode());
+
+  auto &blocks = scanner.get_blocks();
+  ASSERT_EQ(3u, blocks.size());
+
+  EXPECT_TRUE(blocks[0].m_simple_block);
+  EXPECT_EQ(1u, blocks[0].m_track_number);
+  EXPECT_EQ(-10, blocks[0].m_timecode);
+  EXPECT_TRUE(blocks[0].m_keyframe);
+  EXPECT_FALSE(blocks[0].m_discardable);
+  ASSERT_EQ(1u, blocks[0].m_frames.size());
+  EXPECT_EQ(2u, blocks[0].m_frames[0]->get_size());
+  EXPECT_EQ(0x02, blocks[0].m_frames[0]->get_buffer()[1]);
+
+  EXPECT_EQ(2u, blocks[1].m_track_number);
+  EXPECT_FALSE(blocks[1].m_keyframe);
+  EXPECT_TRUE(blocks[1].m_discardable);
+
+  ASSERT_EQ(3u, blocks[2].m_frames.size());
+  EXPECT_EQ(1u, blocks[2].m_frames[0]->get_size());
+  EXPECT_EQ(2u, blocks[2].m_frames[1]->get_size());
+  EXPECT_EQ(1u, blocks[2].m_frames[2]->get_size());
+  EXPECT_EQ(0x0d, blocks[2].m_frames[2]->get_buffer()[0]);
+}
+
+TEST(KaxBlockScanner, EbmlAndFixedLacing) {
+  unsigned char const data[] = {
+    0xa3, 0x8b, 0x81, 0x00, 0x00, 0x06, 0x02, 0x82, 0xbe, 0x01, 0x02, 0x03, 0x04, // EBML lacing: 2 + 1 + 1 bytes
+    0xa3, 0x8b, 0x81, 0x00, 0x00, 0x04, 0x02, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, // fixed lacing: 3 * 2 bytes
+  };
+
+  kax_block_scanner_c scanner;
+
+  ASSERT_TRUE(scanner.scan(data, sizeof(data)));
+
+  auto &blocks = scanner.get_blocks();
+  ASSERT_EQ(2u, blocks.size());
+
+  ASSERT_EQ(3u, blocks[0].m_frames.size());
+  EXPECT_EQ(2u, blocks[0].m_frames[0]->get_size());
+  EXPECT_EQ(1u, blocks[0].m_frames[1]->get_size());
+  EXPECT_EQ(1u, blocks[0].m_frames[2]->get_size());
+
+  ASSERT_EQ(3u, blocks[1].m_frames.size());
+  EXPECT_EQ(2u, blocks[1].m_frames[2]->get_size());
+  EXPECT_EQ(0x05, blocks[1].m_frames[2]->get_buffer()[0]);
+}
+
+TEST(KaxBlockScanner, BlockGroupsAndTrackFilter) {
+  unsigned char const data[] = {
+    0xa0, 0x92,                                     // BlockGroup
+    0xfb, 0x81, 0xfe,                               //   ReferenceBlock -2
+    0xa1, 0x85, 0x82, 0x00, 0x07, 0x00, 0xaa,       //   Block track 2, 7
+    0x9b, 0x82, 0x01, 0x00,                         //   BlockDuration 256
+    0x75, 0xa2, 0x81, 0x10,                         //   DiscardPadding 16
+    0xa0, 0x88,                                     // BlockGroup
+    0xa1, 0x86, 0x81, 0x00, 0x00, 0x00, 0x01, 0x02, //   Block track 1
+  };
+
+  kax_block_scanner_c scanner;
+  scanner.set_track_filter([](uint64_t track_number) { return track_number == 2; });
+
+  ASSERT_TRUE(scanner.scan(data, sizeof(data)));
+
+  auto &blocks = scanner.get_blocks();
+  ASSERT_EQ(1u, blocks.size());
+
+  EXPECT_FALSE(blocks[0].m_simple_block);
+  EXPECT_EQ(2u, blocks[0].m_track_number);
+  EXPECT_EQ(7, blocks[0].m_timecode);
+  ASSERT_TRUE(!!blocks[0].m_duration);
+  EXPECT_EQ(256u, *blocks[0].m_duration);
+  ASSERT_TRUE(!!blocks[0].m_discard_padding);
+  EXPECT_EQ(16, *blocks[0].m_discard_padding);
+  ASSERT_EQ(1u, blocks[0].m_references.size());
+  EXPECT_EQ(-2, blocks[0].m_references[0]);
+  ASSERT_EQ(1u, blocks[0].m_frames.size());
+  EXPECT_EQ(0xaa, blocks[0].m_frames[0]->get_buffer()[0]);
+}
+
+TEST(KaxBlockScanner, InvalidData) {
+  unsigned char const truncated[]    = { 0xa3, 0x88, 0x81, 0x00, 0x00, 0x00 };
+  unsigned char const bad_lacing[]   = { 0xa3, 0x88, 0x81, 0x00, 0x00, 0x04, 0x01, 0x01, 0x02, 0x03 };
+  unsigned char const unknown_size[] = { 0xa3, 0xff, 0x81, 0x00, 0x00, 0x00 };
+
+  kax_block_scanner_c scanner;
+
+  EXPECT_FALSE(scanner.scan(truncated,    sizeof(truncated)));
+  EXPECT_FALSE(scanner.scan(bad_lacing,   sizeof(bad_lacing)));
+  EXPECT_FALSE(scanner.scan(unknown_size, sizeof(unknown_size)));
+}
+
+}
@@ -0,0 +1,70 @@
+#include "common/common_pch.h"
+
+#include "common/memory.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(Memory, PoolRecyclesBuffers) {
+  unsigned char *first{};
+
+  {
+    auto mem = memory_c::alloc(3000);
+    first    = mem->get_buffer();
+  }
+
+  // Same size class (4096 bytes), therefore the same buffer.
+  auto mem = memory_c::alloc(2500);
+
+  ASSERT_EQ(first, mem->get_buffer());
+  ASSERT_EQ(2500u, mem->get_size());
+}
+
+TEST(Memory, ResizeKeepsContent) {
+  auto mem = memory_c::clone(std::string{"Hello"});
+  auto buffer = mem->get_buffer();
+
+  mem->add(reinterpret_cast<unsigned char const *>(" world"), 6);
+
+  ASSERT_EQ(buffer, mem->get_buffer());
+  ASSERT_EQ(std::string{"Hello world"}, mem->to_string());
+
+  mem->resize(100000);
+  memset(mem->get_buffer() + 11, 0, 100000 - 11);
+  mem->resize(5);
+
+  ASSERT_EQ(std::string{"Hello"}, mem->to_string());
+}
+
+TEST(Memory, GrabCopiesOnce) {
+  unsigned char data[] = { 1, 2, 3, 4 };
+  auto mem = std::make_shared<memory_c>(data, 4, false);
+
+  mem->set_offset(1);
+  mem->grab();
+
+  ASSERT_TRUE(mem->is_free());
+  ASSERT_NE(data + 1, mem->get_buffer());
+  ASSERT_EQ(3u, mem->get_size());
+  ASSERT_EQ(2, mem->get_buffer()[0]);
+
+  auto buffer = mem->get_buffer();
+  mem->grab();
+
+  ASSERT_EQ(buffer, mem->get_buffer());
+}
+
+TEST(Memory, SliceKeepsBufferAlive) {
+  auto mem    = memory_c::clone(std::string{"Hello world"});
+  auto buffer = mem->get_buffer();
+  auto view   = memory_c::slice(mem, 6, 5);
+
+  mem.reset();
+
+  ASSERT_EQ(buffer + 6, view->get_buffer());
+  ASSERT_EQ(std::string{"world"}, view->to_string());
+  ASSERT_FALSE(view->is_free());
+}
+
+}
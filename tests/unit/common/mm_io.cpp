@@ -4,6 +4,7 @@
 #include "tests/unit/util.h"
 
 #include "common/mm_io_x.h"
+#include "common/mm_shared_cache_io.h"
 
 namespace {
 
@@ -16,4 +17,110 @@ TEST(MmIo, Slurp) {
   ASSERT_THROW(mm_file_io_c::slurp("doesnotexist"), mtx::mm_io::exception);
 }
 
+TEST(MmIo, SharedCache) {
+  std::string content{"0123456789abcdefghij"};
+  mm_mem_io_c source{reinterpret_cast<unsigned char const *>(content.c_str()), content.size()};
+  auto cache = std::make_shared<mm_shared_cache_io_c::cache_c>(source, 8);
+
+  mm_shared_cache_io_c io1{cache}, io2{cache};
+  std::string buffer;
+
+  EXPECT_EQ(20, io1.get_size());
+
+  // Reads spanning chunk boundaries
+  EXPECT_EQ(12u, io1.read(buffer, 12));
+  EXPECT_EQ(std::string{"0123456789ab"}, buffer);
+
+  // Independent positions
+  io2.setFilePointer(-5, seek_end);
+  EXPECT_EQ(5u, io2.read(buffer, 10));
+  EXPECT_EQ(std::string{"fghij"}, buffer);
+  EXPECT_TRUE(io2.eof());
+  EXPECT_EQ(12u, io1.getFilePointer());
+
+  // Seeking beyond the end positions at the end
+  io1.setFilePointer(100);
+  EXPECT_EQ(20u, io1.getFilePointer());
+  EXPECT_THROW(io1.setFilePointer(-1), mtx::mm_io::seek_x);
+
+  // After cancelling only chunks already read are available.
+  cache = std::make_shared<mm_shared_cache_io_c::cache_c>(source, 8);
+  mm_shared_cache_io_c io3{cache};
+
+  EXPECT_EQ(5u, io3.read(buffer, 5));
+  cache->cancel();
+  io3.setFilePointer(0);
+  EXPECT_EQ(8u, io3.read(buffer, 20));
+  EXPECT_TRUE(io3.eof());
+}
+
+TEST(MmIo, InsertRange) {
+  auto file_name = (bfs::temp_directory_path() / bfs::unique_path("mtx-mm-io-insert-range-%%%%-%%%%")).string();
+
+  {
+    mm_file_io_c file{file_name, MODE_CREATE};
+
+    // Not all file systems support inserting space.
+    auto alignment = file.get_insert_range_alignment();
+    auto content   = std::string(alignment, 'a') + std::string(alignment, 'b');
+
+    file.write(content.c_str(), content.size());
+
+    if (alignment && file.insert_range(alignment, alignment)) {
+      std::string buffer;
+
+      EXPECT_EQ(3 * alignment, file.get_size());
+
+      file.setFilePointer(0);
+      EXPECT_EQ(3 * alignment, file.read(buffer, 3 * alignment));
+      EXPECT_EQ(std::string(alignment, 'a') + std::string(alignment, '\0') + std::string(alignment, 'b'), buffer);
+    }
+  }
+
+  boost::system::error_code ec;
+  bfs::remove(file_name, ec);
+}
+
+TEST(MmIo, TextLines) {
+  std::string content{"\xef\xbb\xbf" "first\r\nsecond\r\n\r\n" + std::string(200000, 'x') + "\r\nlast"};
+  mm_mem_io_c source{reinterpret_cast<unsigned char const *>(content.c_str()), content.size()};
+  mm_text_io_c in{&source, false};
+  std::string line;
+
+  EXPECT_EQ(BO_UTF8, in.get_byte_order());
+
+  ASSERT_TRUE(in.getline2(line));
+  EXPECT_EQ(std::string{"first"}, line);
+  EXPECT_EQ(10u, in.getFilePointer());
+
+  ASSERT_TRUE(in.getline2(line));
+  EXPECT_EQ(std::string{"second"}, line);
+  ASSERT_TRUE(in.getline2(line));
+  EXPECT_EQ(std::string{}, line);
+
+  // Lines spanning several read-ahead buffers
+  ASSERT_TRUE(in.getline2(line));
+  EXPECT_EQ(200000u, line.length());
+
+  ASSERT_TRUE(in.getline2(line));
+  EXPECT_EQ(std::string{"last"}, line);
+  EXPECT_FALSE(in.getline2(line));
+
+  // Rewinding skips the byte order marker.
+  in.setFilePointer(0);
+  EXPECT_EQ(3u, in.getFilePointer());
+  EXPECT_EQ(std::string{"fir"}, in.getline(3));
+  EXPECT_EQ(std::string{"st"}, in.getline());
+}
+
+TEST(MmIo, TextInvalidUTF8) {
+  std::string content{"\xef\xbb\xbf" "ok\nnot \x80k\n"};
+  mm_mem_io_c source{reinterpret_cast<unsigned char const *>(content.c_str()), content.size()};
+  mm_text_io_c in{&source, false};
+  std::string line;
+
+  EXPECT_TRUE(in.getline2(line));
+  EXPECT_THROW(in.getline(), mtx::mm_io::text::invalid_utf8_char_x);
+}
+
 }
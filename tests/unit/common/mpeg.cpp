@@ -0,0 +1,89 @@
+#include "common/common_pch.h"
+
+#include "common/mpeg.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::ptrdiff_t
+find(std::vector<unsigned char> const &buffer,
+     std::size_t start = 0) {
+  auto begin = buffer.data();
+  auto end   = begin + buffer.size();
+
+  return mtx::mpeg::find_start_code(begin + start, end) - begin;
+}
+
+TEST(MPEG, FindStartCodeShortBuffers) {
+  EXPECT_EQ(0, find({}));
+  EXPECT_EQ(1, find({ 0x00 }));
+  EXPECT_EQ(2, find({ 0x00, 0x00 }));
+  EXPECT_EQ(0, find({ 0x00, 0x00, 0x01 }));
+  EXPECT_EQ(3, find({ 0x00, 0x01, 0x00 }));
+  EXPECT_EQ(1, find({ 0x00, 0x00, 0x00, 0x01 }));
+  EXPECT_EQ(4, find({ 0x00, 0x00, 0x02, 0x01 }));
+}
+
+TEST(MPEG, FindStartCodeStartOffset) {
+  std::vector<unsigned char> buffer{ 0x00, 0x00, 0x01, 0x09, 0x00, 0x00, 0x01, 0x67 };
+
+  EXPECT_EQ(0, find(buffer, 0));
+  EXPECT_EQ(4, find(buffer, 1));
+  EXPECT_EQ(4, find(buffer, 4));
+  EXPECT_EQ(8, find(buffer, 5));
+}
+
+TEST(MPEG, FindStartCodeAllPositions) {
+  // Exercise every position relative to the vectorized block sizes,
+  // including start codes spanning the blocks' boundaries.
+  for (auto size = 3u; size <= 100; ++size) {
+    for (auto pos = 0u; pos <= (size - 3); ++pos) {
+      std::vector<unsigned char> buffer(size, 0xff);
+      buffer[pos]     = 0x00;
+      buffer[pos + 1] = 0x00;
+      buffer[pos + 2] = 0x01;
+
+      EXPECT_EQ(static_cast<std::ptrdiff_t>(pos), find(buffer)) << "size " << size << " pos " << pos;
+    }
+
+    std::vector<unsigned char> no_start_code(size, 0x00);
+    no_start_code.back() = 0x02;
+    EXPECT_EQ(static_cast<std::ptrdiff_t>(size), find(no_start_code)) << "size " << size;
+  }
+}
+
+TEST(MPEG, NALUToRBSP) {
+  memory_c dest;
+
+  auto convert = [&dest](std::vector<unsigned char> const &src) {
+    auto size = mtx::mpeg::nalu_to_rbsp(src.data(), src.size(), dest);
+    return std::vector<unsigned char>(dest.get_buffer(), dest.get_buffer() + size);
+  };
+
+  EXPECT_EQ((std::vector<unsigned char>{ }),                                  convert({ }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00 }),                      convert({ 0x00, 0x00 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00 }),                      convert({ 0x00, 0x00, 0x03 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x01 }),                convert({ 0x00, 0x00, 0x03, 0x01 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x00, 0x00 }),          convert({ 0x00, 0x00, 0x03, 0x00, 0x00, 0x03 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x03, 0x00 }),          convert({ 0x00, 0x00, 0x03, 0x03, 0x00 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x42, 0x00, 0x03, 0x00, 0x00, 0x02 }), convert({ 0x42, 0x00, 0x03, 0x00, 0x00, 0x03, 0x02 }));
+}
+
+TEST(MPEG, RBSPToNALU) {
+  memory_c dest;
+
+  auto convert = [&dest](std::vector<unsigned char> const &src) {
+    auto size = mtx::mpeg::rbsp_to_nalu(src.data(), src.size(), dest);
+    return std::vector<unsigned char>(dest.get_buffer(), dest.get_buffer() + size);
+  };
+
+  EXPECT_EQ((std::vector<unsigned char>{ }),                                              convert({ }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00 }),                                  convert({ 0x00, 0x00 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x03, 0x01 }),                      convert({ 0x00, 0x00, 0x01 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x04 }),                            convert({ 0x00, 0x00, 0x04 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00 }),    convert({ 0x00, 0x00, 0x00, 0x00, 0x00 }));
+  EXPECT_EQ((std::vector<unsigned char>{ 0x42, 0x00, 0x00, 0x03, 0x03, 0x42 }),          convert({ 0x42, 0x00, 0x00, 0x03, 0x42 }));
+}
+
+}
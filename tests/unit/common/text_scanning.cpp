@@ -0,0 +1,56 @@
+#include "common/common_pch.h"
+
+#include "common/text_scanning.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::ptrdiff_t
+find_line_break(std::string const &text) {
+  auto begin = reinterpret_cast<unsigned char const *>(text.data());
+  return mtx::text::find_line_break(begin, begin + text.length()) - begin;
+}
+
+std::ptrdiff_t
+find_invalid(std::string const &text) {
+  auto begin = reinterpret_cast<unsigned char const *>(text.data());
+  return mtx::text::find_invalid_utf8_lead_byte(begin, begin + text.length()) - begin;
+}
+
+TEST(TextScanning, FindLineBreak) {
+  EXPECT_EQ(0, find_line_break(""));
+  EXPECT_EQ(3, find_line_break("abc"));
+  EXPECT_EQ(3, find_line_break("abc\ndef"));
+  EXPECT_EQ(3, find_line_break("abc\r\ndef"));
+
+  // Positions beyond the sizes handled by the vectorized code
+  for (auto position : std::vector<std::size_t>{ 15, 16, 17, 31, 32, 33, 63, 100 }) {
+    auto text                     = std::string(128, 'x');
+    text[position]                = '\r';
+    text[std::min<std::size_t>(position + 1, 127)] = '\n';
+
+    EXPECT_EQ(static_cast<std::ptrdiff_t>(position), find_line_break(text));
+  }
+
+  EXPECT_EQ(128, find_line_break(std::string(128, 'x')));
+}
+
+TEST(TextScanning, FindInvalidUTF8LeadByte) {
+  EXPECT_EQ(0,  find_invalid(""));
+  EXPECT_EQ(12, find_invalid("chunky bacon"));
+  EXPECT_EQ(10, find_invalid("K\xc3\xa4se \xe2\x82\xac" "12"));
+  EXPECT_EQ(1,  find_invalid("a\x80"));
+  EXPECT_EQ(2,  find_invalid("ab\xff"));
+
+  // A sequence cut off at the end is fine.
+  EXPECT_EQ(3,  find_invalid("ab\xe2"));
+
+  auto text = std::string(100, 'x') + "\xc3\xa4" + std::string(40, 'y');
+  EXPECT_EQ(static_cast<std::ptrdiff_t>(text.length()), find_invalid(text));
+
+  text[120] = '\xbf';
+  EXPECT_EQ(120, find_invalid(text));
+}
+
+}
@@ -0,0 +1,58 @@
+#include "common/common_pch.h"
+
+#include <atomic>
+
+#include "common/thread_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(ThreadPool, RunsAllJobs) {
+  std::atomic<int> sum{0};
+  std::vector<std::future<void>> futures;
+
+  {
+    thread_pool_c pool{4};
+
+    EXPECT_EQ(4u, pool.get_num_threads());
+
+    for (auto idx = 1; idx <= 100; ++idx)
+      futures.emplace_back(pool.submit([&sum, idx]() { sum += idx; }));
+
+    for (auto &future : futures)
+      future.get();
+  }
+
+  EXPECT_EQ(5050, sum);
+}
+
+TEST(ThreadPool, AtLeastOneThread) {
+  thread_pool_c pool{0};
+
+  EXPECT_EQ(1u, pool.get_num_threads());
+}
+
+TEST(ThreadPool, PropagatesExceptions) {
+  thread_pool_c pool{2};
+
+  auto future = pool.submit([]() { throw std::runtime_error{"failed"}; });
+
+  EXPECT_THROW(future.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, FinishesQueuedJobsOnDestruction) {
+  std::atomic<int> num_run{0};
+  std::vector<std::future<void>> futures;
+
+  {
+    thread_pool_c pool{1};
+
+    for (auto idx = 0; idx < 20; ++idx)
+      futures.emplace_back(pool.submit([&num_run]() { ++num_run; }));
+  }
+
+  EXPECT_EQ(20, num_run);
+}
+
+}
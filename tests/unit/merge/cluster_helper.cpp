@@ -0,0 +1,53 @@
+#include "common/common_pch.h"
+
+#include "merge/cluster_helper.h"
+#include "merge/generic_packetizer.h"
+#include "merge/libmatroska_extensions.h"
+#include "merge/private/cluster_helper.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(ClusterBufferIo, FilePositions) {
+  cluster_buffer_io_c buffer;
+  std::string content;
+
+  buffer.restart(1000);
+  EXPECT_EQ(1000u, buffer.get_file_offset());
+  EXPECT_EQ(1000u, buffer.getFilePointer());
+
+  buffer.write(std::string{"abcdef"});
+  EXPECT_EQ(1006u, buffer.getFilePointer());
+  EXPECT_EQ(6u,    buffer.get_size());
+
+  // Positions are absolute positions in the destination file.
+  buffer.setFilePointer(1002);
+  EXPECT_EQ(1002u, buffer.getFilePointer());
+
+  buffer.write(std::string{"XY"});
+  EXPECT_EQ(1004u, buffer.getFilePointer());
+
+  buffer.setFilePointer(-1, seek_current);
+  EXPECT_EQ(1003u, buffer.getFilePointer());
+
+  buffer.setFilePointer(0, seek_end);
+  EXPECT_EQ(1006u, buffer.getFilePointer());
+
+  EXPECT_EQ(std::string{"abXYef"}, std::string(reinterpret_cast<char const *>(buffer.get_buffer()), 6));
+
+  // The next cluster starts with an empty buffer.
+  buffer.restart(5000);
+  EXPECT_EQ(5000u, buffer.getFilePointer());
+  EXPECT_EQ(0u,    buffer.get_size());
+
+  buffer.write(std::string{"gh"});
+  buffer.setFilePointer(0, seek_end);
+  EXPECT_EQ(5002u, buffer.getFilePointer());
+
+  buffer.setFilePointer(5000);
+  EXPECT_EQ(2u, buffer.read(content, 10));
+  EXPECT_EQ(std::string{"gh"}, content);
+}
+
+}
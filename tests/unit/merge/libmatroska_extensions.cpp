@@ -0,0 +1,69 @@
+#include "common/common_pch.h"
+
+#include <matroska/KaxCues.h>
+#include <matroska/KaxTracks.h>
+
+#include "common/ebml.h"
+#include "common/mm_io.h"
+#include "merge/libmatroska_extensions.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int64_t const s_timecode_scale = 1000000;
+
+class BlockGroupRecycling: public ::testing::Test {
+protected:
+  KaxTrackEntry m_track;
+  KaxCues m_cues;
+
+  virtual void SetUp() {
+    GetChild<KaxTrackNumber>(m_track).SetValue(1);
+    m_track.SetGlobalTimecodeScale(s_timecode_scale);
+    m_track.EnableLacing(false);
+  }
+
+  std::string
+  render_cluster(kax_block_blob_c &blob,
+                 int64_t timecode,
+                 std::string const &content) {
+    kax_cluster_c cluster;
+    cluster.SetPreviousTimecode(timecode - 1, s_timecode_scale);
+
+    blob.SetParent(cluster);
+    cluster.AddBlockBlob(&blob);
+
+    auto buffer = new DataBuffer(reinterpret_cast<binary *>(const_cast<char *>(content.c_str())), content.length());
+    blob.add_frame_auto(m_track, timecode, *buffer, LACING_NONE, timecode - 40 * s_timecode_scale, -1);
+    blob.set_block_duration(40 * s_timecode_scale);
+
+    cluster.set_min_timecode(timecode);
+    cluster.set_max_timecode(timecode);
+
+    mm_mem_io_c out{nullptr, 0, 1024};
+    cluster.Render(out, m_cues);
+    cluster.delete_non_blocks();
+
+    return std::string{reinterpret_cast<char const *>(out.get_buffer()), static_cast<std::string::size_type>(out.getFilePointer())};
+  }
+};
+
+TEST_F(BlockGroupRecycling, RenderingInSeveralClusters) {
+  kax_block_blob_c recycled{BLOCK_BLOB_NO_SIMPLE};
+
+  for (auto idx = 1; 4 > idx; ++idx) {
+    auto timecode      = idx * 1000 * s_timecode_scale;
+    auto content       = std::string(idx * 10, 'a' + idx);
+    kax_block_blob_c fresh{BLOCK_BLOB_NO_SIMPLE};
+
+    auto from_recycled = render_cluster(recycled, timecode, content);
+    auto from_fresh    = render_cluster(fresh,    timecode, content);
+
+    EXPECT_EQ(from_fresh, from_recycled);
+
+    recycled.reset();
+  }
+}
+
+}